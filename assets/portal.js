@@ -0,0 +1,54 @@
+// Portal script. Every statement ends with ';' so lines can be joined.
+
+// Copies a clicked SSID into the form
+function c(l) {
+  document.getElementById('s').value = l.innerText || l.textContent;
+  document.getElementById('p').focus();
+}
+
+function toggleTheme() {
+  fetch('/theme-toggle', {method: 'POST'}).then(() => { location.reload(); });
+}
+
+// Polls /scan.json and redraws the list while a scan is running
+function r() {
+  fetch('/scan.json').then(x => x.json()).then(d => {
+    var e = document.getElementById('aps');
+    if (!e) return;
+    if (d.aps.length || !d.scanning) {
+      e.innerHTML = '';
+      d.aps.forEach(a => {
+        var v = document.createElement('div'), l = document.createElement('a'), q = document.createElement('span');
+        l.href = '#p';
+        l.onclick = function() { c(this); };
+        l.textContent = a.ssid;
+        q.className = 'q' + (a.auth ? ' l' : '');
+        q.textContent = a.q + '%';
+        v.appendChild(l);
+        v.append('\u00a0');
+        v.appendChild(q);
+        e.appendChild(v);
+      });
+      if (!d.aps.length) e.textContent = 'No networks found. Refresh to scan again.';
+    }
+    if (d.scanning) setTimeout(r, 2000);
+  });
+}
+
+// Polls /api/status after the credentials were saved and shows the outcome
+function w() {
+  fetch('/api/status').then(x => x.json()).then(d => {
+    var e = document.getElementById('st');
+    if (d.result < 0) {
+      setTimeout(w, 1000);
+      return;
+    }
+    if (d.result == 0) {
+      e.textContent = 'Connected to ' + d.ssid + ' with address ' + d.ip + '. The setup network will now close.';
+    } else {
+      // Indexed by wm_connect_result_t; anything newer reads as a failure
+      var m = ['', 'The connection timed out.', 'Wrong password.', 'Network not found.', 'The connection failed.', 'No connection was attempted.'][d.result];
+      e.innerHTML = (m || 'The connection failed.') + ' <a href="/wifi">Try again</a>';
+    }
+  }).catch(() => { setTimeout(w, 1000); });
+}
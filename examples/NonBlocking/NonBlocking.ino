@@ -0,0 +1,40 @@
+#include <WiFi.h>
+#include <SimpleWiFiManager.h>
+
+SimpleWiFiManager wifiManager;
+
+unsigned long lastSample = 0;
+
+void setup() {
+  Serial.begin(115200);
+
+  wifiManager.setWebUITitle("WiFiManager NonBlocking");
+  // WiFi接続試行のタイムアウトを10秒に設定
+  wifiManager.setConnectTimeout(10);
+  // process() 1回あたりにポータル処理へ割り当てる時間(ms)
+  wifiManager.setProcessBudget(5);
+
+  WiFi.mode(WIFI_STA);
+  WiFi.begin();
+  if (WiFi.waitForConnectResult() != WL_CONNECTED) {
+    // 接続できなければ設定ポータルを開始し、loop()はそのまま動かし続ける
+    Serial.println("Starting config portal");
+    wifiManager.startConfigPortalAsync("AutoConnectAP");
+  }
+}
+
+void loop() {
+  // ポータルが動作中の間だけ処理される
+  if (wifiManager.isConfigPortalActive()) {
+    if (!wifiManager.process()) {
+      Serial.print("Portal closed, WiFi ");
+      Serial.println(WiFi.status() == WL_CONNECTED ? "connected" : "not connected");
+    }
+  }
+
+  // ポータル動作中もアプリケーションの処理は止まらない
+  if (millis() - lastSample > 1000) {
+    lastSample = millis();
+    Serial.println("sampling sensor...");
+  }
+}
@@ -0,0 +1,9 @@
+// Built by the Makefile with a WM_FEATURE_* value the library objects were not
+// built with. It must fail to link (see wififeatures.h).
+
+#include "SimpleWiFiManager.h"
+
+int main() {
+    SimpleWiFiManager wm;
+    return 0;
+}
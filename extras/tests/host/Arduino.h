@@ -0,0 +1,155 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the parts of the ESP32 Arduino core the library uses.
+// Behaviour follows the core closely enough for logic tests; timing and heap
+// figures measured with it are host figures, not device figures.
+
+#include <strings.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <functional>
+#include <algorithm>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define PGM_P const char*
+#define F(x) (reinterpret_cast<const __FlashStringHelper*>(x))
+#define FPSTR(x) (reinterpret_cast<const __FlashStringHelper*>(x))
+#define PSTR(x) (x)
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define strncpy_P strncpy
+
+class __FlashStringHelper;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+uint32_t esp_random();
+
+class String {
+public:
+    String() {}
+    String(const char* c) : _s(c ? c : "") {}
+    String(const __FlashStringHelper* c) : _s(reinterpret_cast<const char*>(c)) {}
+    String(const std::string& c) : _s(c) {}
+    String(char c) : _s(1, c) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    String(long long v) : _s(std::to_string(v)) {}
+    String(unsigned long long v) : _s(std::to_string(v)) {}
+    String(uint8_t v) : _s(std::to_string(v)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    char charAt(unsigned i) const { return i < _s.size() ? _s[i] : 0; }
+    void reserve(unsigned n) { _s.reserve(n); }
+    int toInt() const { return atoi(_s.c_str()); }
+
+    int indexOf(const char* x) const { size_t p = _s.find(x); return p == std::string::npos ? -1 : (int)p; }
+    int indexOf(const String& x) const { return indexOf(x.c_str()); }
+    int indexOf(char c) const { size_t p = _s.find(c); return p == std::string::npos ? -1 : (int)p; }
+    bool startsWith(const String& x) const { return _s.compare(0, x._s.size(), x._s) == 0; }
+    String substring(unsigned from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned from, unsigned to) const { return from < to && from < _s.size() ? String(_s.substr(from, to - from)) : String(); }
+    bool equalsIgnoreCase(const String& o) const { return strcasecmp(_s.c_str(), o._s.c_str()) == 0; }
+
+    void replace(const String& from, const String& to) {
+        if (from._s.empty()) {
+            return;
+        }
+        for (size_t p = 0; (p = _s.find(from._s, p)) != std::string::npos; p += to._s.size()) {
+            _s.replace(p, from._s.size(), to._s);
+        }
+    }
+    void toCharArray(char* buf, unsigned size) const {
+        if (size == 0) {
+            return;
+        }
+        strncpy(buf, _s.c_str(), size - 1);
+        buf[size - 1] = 0;
+    }
+
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator==(const char* o) const { return _s == (o ? o : ""); }
+    bool operator!=(const String& o) const { return _s != o._s; }
+    bool operator!=(const char* o) const { return !(*this == o); }
+    String& operator+=(const String& o) { _s += o._s; return *this; }
+    String& operator+=(const char* o) { _s += o; return *this; }
+    String& operator+=(char o) { _s += o; return *this; }
+    template <class T> String& operator+=(T v) { _s += std::to_string(v); return *this; }
+
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+
+private:
+    std::string _s;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            write(buf[i]);
+        }
+        return n;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const __FlashStringHelper* s) { return print(reinterpret_cast<const char*>(s)); }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v) { return print((unsigned long)v); }
+    size_t print(int v) { return print((long)v); }
+    size_t print(unsigned v) { return print((unsigned long)v); }
+    size_t print(long v) { char b[24]; snprintf(b, sizeof(b), "%ld", v); return print(b); }
+    size_t print(unsigned long v) { char b[24]; snprintf(b, sizeof(b), "%lu", v); return print(b); }
+
+    template <class T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    size_t println() { return write((const uint8_t*)"\r\n", 2); }
+
+    size_t printf(const char* fmt, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        return (n > 0) ? write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1)) : 0;
+    }
+};
+
+// Everything printed is kept in output so tests can look at the log
+class HardwareSerial : public Print {
+public:
+    using Print::write;
+    size_t write(uint8_t c) override { output += (char)c; return 1; }
+    void begin(unsigned long) {}
+    std::string output;
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint64_t getEfuseMac();
+    uint32_t getFlashChipSize();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    void     restart();
+};
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include "Arduino.h"
+
+// NVS namespaces live in host::nvs. Like the real one, a read-only begin() on
+// a namespace that was never written fails.
+class Preferences {
+public:
+    Preferences() : _open(false), _readOnly(false) {}
+    ~Preferences() { end(); }
+
+    bool   begin(const char* name, bool readOnly = false, const char* partition = NULL);
+    void   end();
+
+    int32_t getInt(const char* key, int32_t defaultValue = 0);
+    size_t  putInt(const char* key, int32_t value);
+    size_t  getBytesLength(const char* key);
+    size_t  getBytes(const char* key, void* buf, size_t maxLen);
+    size_t  putBytes(const char* key, const void* value, size_t len);
+    bool    remove(const char* key);
+    bool    clear();
+    bool    isKey(const char* key);
+
+private:
+    std::string _name;
+    bool        _open;
+    bool        _readOnly;
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "WebServer.h"
+
+static const char* statusText(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 404: return "Not Found";
+        case 500: return "Internal Server Error";
+        default:  return "";
+    }
+}
+
+static std::string urlDecode(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '+') {
+            out += ' ';
+        } else if (s[i] == '%' && i + 2 < s.size()) {
+            out += (char)strtol(s.substr(i + 1, 2).c_str(), NULL, 16);
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+WebServer::WebServer(int port)
+    : _headerKeysCount(0), _currentHeaders(NULL), _server(port), _currentMethod(HTTP_ANY),
+      _currentStatus(HC_NONE), _statusChange(0), _currentVersion(0),
+      _contentLength(CONTENT_LENGTH_NOT_SET), _chunked(false) {
+}
+
+WebServer::~WebServer() {
+    delete[] _currentHeaders;
+}
+
+// Serves one request from one new connection, then closes it
+void WebServer::handleClient() {
+    WiFiClient client = _server.available();
+    if (!client) {
+        return;
+    }
+    _currentClient = client;
+    if (_parseRequest(_currentClient)) {
+        _contentLength = CONTENT_LENGTH_NOT_SET;
+        _handleRequest();
+    }
+    _currentClient.stop();
+    _currentClient = WiFiClient();
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler) {
+    _handlers.push_back({ uri, method, handler });
+}
+
+String WebServer::arg(String name) {
+    for (const RequestArgument& a : _args) {
+        if (a.key == name) {
+            return a.value;
+        }
+    }
+    return String();
+}
+
+String WebServer::arg(int i) {
+    return (i >= 0 && i < (int)_args.size()) ? _args[i].value : String();
+}
+
+String WebServer::argName(int i) {
+    return (i >= 0 && i < (int)_args.size()) ? _args[i].key : String();
+}
+
+bool WebServer::hasArg(String name) {
+    for (const RequestArgument& a : _args) {
+        if (a.key == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// As in the core, the first slot always collects Authorization
+void WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    delete[] _currentHeaders;
+    _headerKeysCount = headerKeysCount + 1;
+    _currentHeaders = new RequestArgument[_headerKeysCount];
+    _currentHeaders[0].key = "Authorization";
+    for (size_t i = 0; i < headerKeysCount; i++) {
+        _currentHeaders[i + 1].key = headerKeys[i];
+    }
+}
+
+String WebServer::header(String name) {
+    for (int i = 0; i < _headerKeysCount; i++) {
+        if (_currentHeaders[i].key.equalsIgnoreCase(name)) {
+            return _currentHeaders[i].value;
+        }
+    }
+    return String();
+}
+
+bool WebServer::hasHeader(String name) {
+    return header(name).length() > 0;
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+    std::string line = std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+    if (first) {
+        _responseHeaders.insert(0, line);
+    } else {
+        _responseHeaders += line;
+    }
+}
+
+void WebServer::_write(const char* data, size_t length) {
+    if (recording) {
+        output.append(data, length);
+    }
+    if (_currentClient) {
+        _currentClient.write((const uint8_t*)data, length);
+    }
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+    char line[64];
+    snprintf(line, sizeof(line), "HTTP/1.%u %d %s\r\n", (unsigned)_currentVersion, code, statusText(code));
+    std::string head = line;
+    if (contentType != NULL) {
+        head += std::string("Content-Type: ") + contentType + "\r\n";
+    }
+    head += _responseHeaders;
+    _responseHeaders.clear();
+
+    _chunked = false;
+    if (_contentLength == CONTENT_LENGTH_UNKNOWN) {
+        _chunked = (_currentVersion == 1);
+        if (_chunked) {
+            head += "Transfer-Encoding: chunked\r\n";
+        }
+    } else {
+        size_t length = (_contentLength == CONTENT_LENGTH_NOT_SET) ? content.length() : _contentLength;
+        head += "Content-Length: " + std::to_string(length) + "\r\n";
+    }
+    head += "Connection: close\r\n\r\n";
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+
+    _write(head.data(), head.size());
+    if (content.length() > 0) {
+        _write(content.c_str(), content.length());
+    }
+}
+
+void WebServer::send_P(int code, PGM_P contentType, PGM_P content, size_t contentLength) {
+    setContentLength(contentLength);
+    send(code, contentType, "");
+    _write(content, contentLength);
+}
+
+void WebServer::sendContent(const char* content, size_t contentLength) {
+    if (recording) {
+        chunks.push_back(contentLength);
+    }
+    if (_chunked) {
+        char size[16];
+        int n = snprintf(size, sizeof(size), "%zx\r\n", contentLength);
+        _write(size, n);
+    }
+    _write(content, contentLength);
+    if (_chunked) {
+        _write("\r\n", 2);
+        if (contentLength == 0) {
+            _chunked = false;
+        }
+    }
+}
+
+// Reads the request line, headers and a url-encoded body the way the core does
+bool WebServer::_parseRequest(WiFiClient& client) {
+    // Byte by byte, like the core's readStringUntil(), so a pipelined request
+    // stays in the client
+    std::string data;
+    int c;
+    while (data.size() < 4 || data.compare(data.size() - 4, 4, "\r\n\r\n") != 0) {
+        if ((c = client.read()) < 0) {
+            return false;
+        }
+        data += (char)c;
+    }
+    data.resize(data.size() - 2);
+
+    size_t lineEnd = data.find("\r\n");
+    std::string line = data.substr(0, lineEnd);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.rfind(' ');
+    if (sp1 == std::string::npos || sp2 == sp1) {
+        return false;
+    }
+    std::string method = line.substr(0, sp1);
+    std::string url = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    _currentVersion = (line.compare(sp2 + 1, std::string::npos, "HTTP/1.1") == 0) ? 1 : 0;
+    _currentMethod = (method == "POST") ? HTTP_POST : (method == "HEAD") ? HTTP_HEAD : HTTP_GET;
+
+    _args.clear();
+    _hostHeader = "";
+    for (int i = 0; i < _headerKeysCount; i++) {
+        _currentHeaders[i].value = "";
+    }
+
+    std::string query;
+    size_t q = url.find('?');
+    if (q != std::string::npos) {
+        query = url.substr(q + 1);
+        url.resize(q);
+    }
+    _currentUri = url.c_str();
+
+    size_t contentLength = 0;
+    std::string contentType;
+    for (size_t pos = lineEnd + 2; pos < data.size();) {
+        size_t end = data.find("\r\n", pos);
+        std::string header = data.substr(pos, end - pos);
+        pos = end + 2;
+        size_t colon = header.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key = header.substr(0, colon);
+        std::string value = header.substr(header.find_first_not_of(' ', colon + 1) == std::string::npos
+                                          ? header.size() : header.find_first_not_of(' ', colon + 1));
+        for (int i = 0; i < _headerKeysCount; i++) {
+            if (_currentHeaders[i].key.equalsIgnoreCase(key.c_str())) {
+                _currentHeaders[i].value = value.c_str();
+            }
+        }
+        if (strcasecmp(key.c_str(), "Host") == 0) {
+            _hostHeader = value.c_str();
+        } else if (strcasecmp(key.c_str(), "Content-Length") == 0) {
+            contentLength = strtoul(value.c_str(), NULL, 10);
+        } else if (strcasecmp(key.c_str(), "Content-Type") == 0) {
+            contentType = value;
+        }
+    }
+
+    std::string body;
+    uint8_t buf[512];
+    int n;
+    while (body.size() < contentLength &&
+           (n = client.read(buf, std::min(sizeof(buf), contentLength - body.size()))) > 0) {
+        body.append((const char*)buf, n);
+    }
+    if (contentType.find("application/x-www-form-urlencoded") != std::string::npos) {
+        query += (query.empty() ? "" : "&") + body;
+    }
+
+    for (size_t pos = 0; pos < query.size();) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        std::string pair = query.substr(pos, end - pos);
+        pos = end + 1;
+        if (pair.empty()) {
+            continue;
+        }
+        size_t eq = pair.find('=');
+        RequestArgument a;
+        a.key = urlDecode(pair.substr(0, eq)).c_str();
+        a.value = (eq == std::string::npos) ? "" : urlDecode(pair.substr(eq + 1)).c_str();
+        _args.push_back(a);
+    }
+    return true;
+}
+
+void WebServer::_handleRequest() {
+    bool handled = false;
+    for (const Handler& h : _handlers) {
+        if (h.uri == _currentUri && (h.method == HTTP_ANY || h.method == _currentMethod)) {
+            h.fn();
+            handled = true;
+            break;
+        }
+    }
+    if (!handled) {
+        if (_notFound) {
+            _notFound();
+        } else {
+            send(404, "text/plain", String("Not found: ") + _currentUri);
+        }
+    }
+    _currentUri = "";
+}
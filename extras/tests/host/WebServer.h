@@ -0,0 +1,108 @@
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include "WiFi.h"
+#include <memory>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPClientStatus { HC_NONE, HC_WAIT_READ, HC_WAIT_CLOSE };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+#define CONTENT_LENGTH_NOT_SET ((size_t) -2)
+#define HTTP_MAX_DATA_WAIT  5000
+#define HTTP_MAX_SEND_WAIT  5000
+#define HTTP_MAX_CLOSE_WAIT 2000
+
+class HTTPUpload {};
+
+// The core's WebServer reduced to what the library relies on: the protected
+// members PortalServer drives, request parsing from a client, handler
+// dispatch, and chunked responses. While recording is set, every byte sent is
+// also appended to output, and the payload size of each sendContent() call to
+// chunks; heap measurements turn it off.
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    WebServer(int port = 80);
+    virtual ~WebServer();
+
+    virtual void begin() {}
+    virtual void handleClient();
+    virtual void close() {}
+    void stop() { close(); }
+
+    void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler) { _notFound = handler; }
+
+    String     uri() { return _currentUri; }
+    HTTPMethod method() { return _currentMethod; }
+    WiFiClient client() { return _currentClient; }
+
+    String arg(String name);
+    String arg(int i);
+    String argName(int i);
+    int    args() { return (int)_args.size(); }
+    bool   hasArg(String name);
+
+    void   collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(String name);
+    bool   hasHeader(String name);
+    String hostHeader() { return _hostHeader; }
+
+    void send(int code, const char* contentType = NULL, const String& content = String(""));
+    void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+    void send(int code, const char* contentType, const char* content) { send(code, contentType, String(content)); }
+    void send_P(int code, PGM_P contentType, PGM_P content) { send_P(code, contentType, content, strlen(content)); }
+    void send_P(int code, PGM_P contentType, PGM_P content, size_t contentLength);
+    void setContentLength(const size_t contentLength) { _contentLength = contentLength; }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t contentLength);
+    void sendContent_P(PGM_P content) { sendContent(content, strlen(content)); }
+    void sendContent_P(PGM_P content, size_t size) { sendContent(content, size); }
+
+    bool                recording = true;
+    std::string         output;
+    std::vector<size_t> chunks;
+
+protected:
+    struct RequestArgument {
+        String key;
+        String value;
+    };
+
+    bool _parseRequest(WiFiClient& client);
+    void _handleRequest();
+    void _write(const char* data, size_t length);
+
+    int              _headerKeysCount;
+    RequestArgument* _currentHeaders;
+    WiFiServer       _server;
+    WiFiClient       _currentClient;
+    HTTPMethod       _currentMethod;
+    String           _currentUri;
+    HTTPClientStatus _currentStatus;
+    unsigned long    _statusChange;
+    uint8_t          _currentVersion;
+    size_t           _contentLength;
+    String           _hostHeader;
+    std::unique_ptr<HTTPUpload> _currentUpload;
+    bool             _chunked;
+
+private:
+    struct Handler {
+        String           uri;
+        HTTPMethod       method;
+        THandlerFunction fn;
+    };
+
+    std::vector<Handler>         _handlers;
+    THandlerFunction             _notFound;
+    std::vector<RequestArgument> _args;
+    std::string                  _responseHeaders;
+};
+
+#endif
@@ -0,0 +1,443 @@
+#include "host.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+WiFiClass WiFi;
+
+namespace host {
+
+WiFiState wifi;
+std::deque<Datagram> udpIn;
+std::deque<Datagram> udpOut;
+
+static std::deque<WiFiClient> pending;
+
+struct EventHandler {
+    wifi_event_id_t    id;
+    arduino_event_id_t event;
+    WiFiEventFuncCb    cb;
+};
+static std::vector<EventHandler> handlers;
+static wifi_event_id_t nextHandlerId = 1;
+
+static const uint8_t DEFAULT_BSSID[6] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+void reset() {
+    wifi.status = WL_IDLE_STATUS;
+    wifi.mode = WIFI_MODE_NULL;
+    wifi.persistent = true;
+    wifi.autoReconnect = true;
+    wifi.storage = WIFI_STORAGE_FLASH;
+    memset(&wifi.running, 0, sizeof(wifi.running));
+    memset(&wifi.flash, 0, sizeof(wifi.flash));
+    wifi.localIP = IPAddress(192, 168, 1, 50);
+    wifi.staticIP = IPAddress();
+    wifi.stations = 0;
+    wifi.rssi = -55;
+    memcpy(wifi.bssid, DEFAULT_BSSID, sizeof(wifi.bssid));
+    wifi.aps.clear();
+    wifi.scanStatus = WIFI_SCAN_FAILED;
+    wifi.holdScan = false;
+    wifi.begins = 0;
+    wifi.onBegin = nullptr;
+    handlers.clear();
+    pending.clear();
+    udpIn.clear();
+    udpOut.clear();
+    nvs.clear();
+    nvsWrites = 0;
+    freeHeap = 200000;
+    minFreeHeap = 180000;
+    maxAllocHeap = 110000;
+    restarted = false;
+}
+
+static struct Init {
+    Init() { reset(); }
+} init;
+
+void addAP(const char* ssid, int8_t rssi, uint8_t channel, wifi_auth_mode_t auth) {
+    wifi_ap_record_t ap;
+    memset(&ap, 0, sizeof(ap));
+    strncpy((char*)ap.ssid, ssid, sizeof(ap.ssid) - 1);
+    ap.rssi = rssi;
+    ap.primary = channel;
+    ap.authmode = auth;
+    ap.bssid[5] = (uint8_t)wifi.aps.size();
+    wifi.aps.push_back(ap);
+}
+
+void fireEvent(arduino_event_id_t event, uint8_t reason) {
+    arduino_event_info_t info;
+    memset(&info, 0, sizeof(info));
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        wifi.status = WL_CONNECTED;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        wifi.status = (reason == WIFI_REASON_NO_AP_FOUND) ? WL_NO_SSID_AVAIL : WL_DISCONNECTED;
+        info.wifi_sta_disconnected.reason = reason;
+    }
+    // Copied: a handler may register or remove handlers
+    std::vector<EventHandler> current = handlers;
+    for (const EventHandler& h : current) {
+        if (h.event == ARDUINO_EVENT_MAX || h.event == event) {
+            h.cb(event, info);
+        }
+    }
+}
+
+std::string configSSID(const wifi_config_t& conf) {
+    return std::string((const char*)conf.sta.ssid, strnlen((const char*)conf.sta.ssid, sizeof(conf.sta.ssid)));
+}
+
+int connect() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return -1;
+    }
+    pending.push_back(WiFiClient(fds[0]));
+    return fds[1];
+}
+
+std::string receive(int fd) {
+    std::string data;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        data.append(buf, n);
+    }
+    return data;
+}
+
+void send(int fd, const std::string& data) {
+    ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+}
+
+}
+
+using host::wifi;
+
+esp_err_t esp_wifi_get_config(wifi_interface_t iface, wifi_config_t* conf) {
+    if (iface != WIFI_IF_STA || wifi.mode == WIFI_MODE_NULL) {
+        return ESP_FAIL;
+    }
+    *conf = wifi.running;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t iface, wifi_config_t* conf) {
+    if (iface != WIFI_IF_STA || wifi.mode == WIFI_MODE_NULL) {
+        return ESP_FAIL;
+    }
+    wifi.running = *conf;
+    if (wifi.storage == WIFI_STORAGE_FLASH) {
+        wifi.flash = *conf;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage) {
+    wifi.storage = storage;
+    return ESP_OK;
+}
+
+bool WiFiClass::mode(wifi_mode_t m) {
+    if (wifi.mode == WIFI_MODE_NULL && m != WIFI_MODE_NULL) {
+        // The driver starts from what it stored
+        wifi.running = wifi.flash;
+    }
+    wifi.mode = m;
+    return true;
+}
+
+wifi_mode_t WiFiClass::getMode() { return wifi.mode; }
+
+bool WiFiClass::softAPConfig(IPAddress ip, IPAddress gateway, IPAddress subnet) { return true; }
+bool WiFiClass::softAP(const char* ssid, const char* pass, int channel, int hidden, int maxConnections) { return ssid != NULL; }
+bool WiFiClass::softAPdisconnect(bool wifioff) { return true; }
+IPAddress WiFiClass::softAPIP() { return IPAddress(192, 168, 4, 1); }
+String WiFiClass::softAPmacAddress() { return String("A1:B2:C3:D4:E5:F7"); }
+uint8_t WiFiClass::softAPgetStationNum() { return wifi.stations; }
+String WiFiClass::macAddress() { return String("A1:B2:C3:D4:E5:F6"); }
+
+int16_t WiFiClass::scanNetworks(bool async, bool hidden, bool passive, uint32_t maxMsPerChannel, uint8_t channel) {
+    // Like the core, no second scan while one is running
+    if (scanComplete() == WIFI_SCAN_RUNNING) {
+        return WIFI_SCAN_RUNNING;
+    }
+    if (async) {
+        wifi.scanStatus = WIFI_SCAN_RUNNING;
+        return WIFI_SCAN_RUNNING;
+    }
+    wifi.scanStatus = (int16_t)wifi.aps.size();
+    return wifi.scanStatus;
+}
+
+int16_t WiFiClass::scanComplete() {
+    if (wifi.scanStatus == WIFI_SCAN_RUNNING && !wifi.holdScan) {
+        wifi.scanStatus = (int16_t)wifi.aps.size();
+    }
+    return wifi.scanStatus;
+}
+
+void WiFiClass::scanDelete() {
+    if (wifi.scanStatus >= 0) {
+        wifi.scanStatus = WIFI_SCAN_FAILED;
+    }
+}
+
+void* WiFiClass::getScanInfoByIndex(int i) {
+    if (wifi.scanStatus < 0 || i < 0 || i >= (int)wifi.aps.size()) {
+        return NULL;
+    }
+    return &wifi.aps[i];
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* pass, int32_t channel, const uint8_t* bssid, bool connect) {
+    if (wifi.mode == WIFI_MODE_NULL || wifi.mode == WIFI_MODE_AP) {
+        mode(wifi.mode == WIFI_MODE_AP ? WIFI_MODE_APSTA : WIFI_MODE_STA);
+    }
+    wifi_config_t conf;
+    memset(&conf, 0, sizeof(conf));
+    strncpy((char*)conf.sta.ssid, ssid, sizeof(conf.sta.ssid));
+    if (pass != NULL) {
+        strncpy((char*)conf.sta.password, pass, sizeof(conf.sta.password));
+    }
+    conf.sta.channel = channel;
+    if (bssid != NULL) {
+        conf.sta.bssid_set = true;
+        memcpy(conf.sta.bssid, bssid, 6);
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &conf);
+    return connect ? begin() : wifi.status;
+}
+
+wl_status_t WiFiClass::begin() {
+    if (wifi.mode == WIFI_MODE_NULL) {
+        mode(WIFI_MODE_STA);
+    }
+    wifi.status = WL_DISCONNECTED;
+    wifi.begins++;
+    if (wifi.onBegin) {
+        wifi.onBegin();
+    }
+    return wifi.status;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    wifi.staticIP = local;
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    wifi.status = WL_DISCONNECTED;
+    if (eraseap) {
+        memset(&wifi.running, 0, sizeof(wifi.running));
+        memset(&wifi.flash, 0, sizeof(wifi.flash));
+    }
+    if (wifioff) {
+        wifi.mode = WIFI_MODE_NULL;
+    }
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    return begin() != WL_CONNECT_FAILED;
+}
+
+void WiFiClass::persistent(bool persistent) {
+    wifi.persistent = persistent;
+}
+
+bool WiFiClass::setAutoReconnect(bool autoReconnect) {
+    wifi.autoReconnect = autoReconnect;
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    return wifi.status;
+}
+
+uint8_t WiFiClass::waitForConnectResult(unsigned long timeoutLength) {
+    return wifi.status;
+}
+
+String WiFiClass::SSID() { return String(host::configSSID(wifi.running)); }
+
+String WiFiClass::psk() {
+    const char* p = (const char*)wifi.running.sta.password;
+    return String(std::string(p, strnlen(p, sizeof(wifi.running.sta.password))));
+}
+
+int8_t WiFiClass::RSSI() { return (wifi.status == WL_CONNECTED) ? wifi.rssi : 0; }
+uint8_t* WiFiClass::BSSID() { return (wifi.status == WL_CONNECTED) ? wifi.bssid : NULL; }
+int32_t WiFiClass::channel() { return 6; }
+
+IPAddress WiFiClass::localIP() {
+    if (wifi.status != WL_CONNECTED) {
+        return IPAddress();
+    }
+    return (uint32_t)wifi.staticIP ? wifi.staticIP : wifi.localIP;
+}
+
+IPAddress WiFiClass::gatewayIP() { return (wifi.status == WL_CONNECTED) ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+IPAddress WiFiClass::subnetMask() { return (wifi.status == WL_CONNECTED) ? IPAddress(255, 255, 255, 0) : IPAddress(); }
+IPAddress WiFiClass::dnsIP(uint8_t i) { return (wifi.status == WL_CONNECTED) ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb cb, arduino_event_id_t event) {
+    wifi_event_id_t id = host::nextHandlerId++;
+    host::handlers.push_back({ id, event, cb });
+    return id;
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id) {
+    for (size_t i = 0; i < host::handlers.size(); i++) {
+        if (host::handlers[i].id == id) {
+            host::handlers.erase(host::handlers.begin() + i);
+            return;
+        }
+    }
+}
+
+WiFiClient::State::~State() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+WiFiClient::WiFiClient(int fd) : _state(std::make_shared<State>()) {
+    _state->fd = fd;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+    if (!*this) {
+        return 0;
+    }
+    ssize_t n = ::send(_state->fd, buf, size, MSG_NOSIGNAL);
+    return (n > 0) ? n : 0;
+}
+
+void WiFiClient::fill() {
+    char buf[1024];
+    ssize_t n;
+    while ((n = recv(_state->fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        _state->rx.append(buf, n);
+    }
+}
+
+int WiFiClient::available() {
+    if (!*this) {
+        return 0;
+    }
+    fill();
+    return (int)_state->rx.size();
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return (read(&c, 1) == 1) ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t size) {
+    if (available() == 0) {
+        return -1;
+    }
+    size_t n = std::min(size, _state->rx.size());
+    memcpy(buf, _state->rx.data(), n);
+    _state->rx.erase(0, n);
+    return (int)n;
+}
+
+int WiFiClient::peek() {
+    return (available() > 0) ? (uint8_t)_state->rx[0] : -1;
+}
+
+bool WiFiClient::connected() {
+    if (!*this) {
+        return false;
+    }
+    if (!_state->rx.empty()) {
+        return true;
+    }
+    char c;
+    ssize_t n = recv(_state->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+void WiFiClient::stop() {
+    if (*this) {
+        ::close(_state->fd);
+        _state->fd = -1;
+        _state->rx.clear();
+    }
+}
+
+IPAddress WiFiClient::localIP() {
+    return WiFi.softAPIP();
+}
+
+IPAddress WiFiClient::remoteIP() {
+    return IPAddress(192, 168, 4, 2);
+}
+
+bool WiFiServer::hasClient() {
+    return !host::pending.empty();
+}
+
+WiFiClient WiFiServer::available() {
+    if (host::pending.empty()) {
+        return WiFiClient();
+    }
+    WiFiClient client = host::pending.front();
+    host::pending.pop_front();
+    return client;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    _port = port;
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    _port = 0;
+    _in.clear();
+    _pos = 0;
+}
+
+int WiFiUDP::parsePacket() {
+    if (_port == 0 || host::udpIn.empty()) {
+        return 0;
+    }
+    host::Datagram d = host::udpIn.front();
+    host::udpIn.pop_front();
+    _in = d.data;
+    _pos = 0;
+    _remoteIP = d.ip;
+    _remotePort = d.port;
+    return (int)_in.size();
+}
+
+int WiFiUDP::read(uint8_t* buf, size_t size) {
+    size_t n = std::min(size, _in.size() - _pos);
+    memcpy(buf, _in.data() + _pos, n);
+    _pos += n;
+    return (int)n;
+}
+
+int WiFiUDP::read() {
+    return (_pos < _in.size()) ? _in[_pos++] : -1;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    _out.clear();
+    _outIP = ip;
+    _outPort = port;
+    return 1;
+}
+
+int WiFiUDP::endPacket() {
+    host::udpOut.push_back({ _outIP, _outPort, _out });
+    _out.clear();
+    return 1;
+}
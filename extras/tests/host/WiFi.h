@@ -0,0 +1,83 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "WiFiClient.h"
+#include "WiFiUdp.h"
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED
+} wl_status_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED  (-2)
+
+typedef enum { WIFI_MODE_NULL = 0, WIFI_MODE_STA, WIFI_MODE_AP, WIFI_MODE_APSTA } wifi_mode_t;
+#define WIFI_OFF   WIFI_MODE_NULL
+#define WIFI_STA   WIFI_MODE_STA
+#define WIFI_AP    WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+typedef int wifi_event_id_t;
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+
+// Driven by host::wifi; see host.h
+class WiFiClass {
+public:
+    bool        mode(wifi_mode_t m);
+    wifi_mode_t getMode();
+
+    bool      softAPConfig(IPAddress ip, IPAddress gateway, IPAddress subnet);
+    bool      softAP(const char* ssid, const char* pass = NULL, int channel = 1, int hidden = 0, int maxConnections = 4);
+    bool      softAPdisconnect(bool wifioff = false);
+    IPAddress softAPIP();
+    String    softAPmacAddress();
+    uint8_t   softAPgetStationNum();
+    String    macAddress();
+
+    int16_t scanNetworks(bool async = false, bool hidden = false, bool passive = false,
+                         uint32_t maxMsPerChannel = 300, uint8_t channel = 0);
+    int16_t scanComplete();
+    void    scanDelete();
+    void*   getScanInfoByIndex(int i);
+
+    wl_status_t begin(const char* ssid, const char* pass = NULL, int32_t channel = 0,
+                      const uint8_t* bssid = NULL, bool connect = true);
+    wl_status_t begin();
+    bool        config(IPAddress local, IPAddress gateway, IPAddress subnet,
+                       IPAddress dns1 = (uint32_t)0, IPAddress dns2 = (uint32_t)0);
+    bool        disconnect(bool wifioff = false, bool eraseap = false);
+    bool        reconnect();
+    bool        isConnected() { return status() == WL_CONNECTED; }
+    void        persistent(bool persistent);
+    bool        setAutoReconnect(bool autoReconnect);
+    wl_status_t status();
+    uint8_t     waitForConnectResult(unsigned long timeoutLength = 60000);
+
+    String    SSID();
+    String    psk();
+    int8_t    RSSI();
+    uint8_t*  BSSID();
+    int32_t   channel();
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t i = 0);
+
+    wifi_event_id_t onEvent(WiFiEventFuncCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    void            removeEvent(wifi_event_id_t id);
+};
+
+extern WiFiClass WiFi;
+
+#endif
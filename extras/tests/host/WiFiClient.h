@@ -0,0 +1,57 @@
+#ifndef HOST_WIFICLIENT_H
+#define HOST_WIFICLIENT_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include <memory>
+
+// A connection is one end of a socketpair; host::connect() hands the other end
+// to the test. Copies share the socket, as copies of the core's client do.
+class WiFiClient : public Print {
+public:
+    WiFiClient() {}
+    explicit WiFiClient(int fd);
+
+    using Print::write;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t size) override;
+
+    int  available();
+    int  read();
+    int  read(uint8_t* buf, size_t size);
+    int  peek();
+    void flush() {}
+    bool connected();
+    void stop();
+    int  fd() const { return _state ? _state->fd : -1; }
+    operator bool() const { return _state && _state->fd >= 0; }
+
+    IPAddress localIP();
+    IPAddress remoteIP();
+    uint16_t  remotePort() { return 50000; }
+    void setTimeout(uint32_t seconds) {}
+    void setNoDelay(bool noDelay) {}
+
+private:
+    struct State {
+        int         fd;
+        std::string rx;     // bytes taken off the socket by available()
+        ~State();
+    };
+    void fill();
+
+    std::shared_ptr<State> _state;
+};
+
+class WiFiServer {
+public:
+    WiFiServer(uint16_t port = 80) {}
+    void begin() {}
+    void setNoDelay(bool noDelay) {}
+    bool hasClient();
+    // Next connection made with host::connect(), or an empty client
+    WiFiClient available();
+    WiFiClient accept() { return available(); }
+};
+
+#endif
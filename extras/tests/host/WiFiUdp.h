@@ -0,0 +1,41 @@
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include <vector>
+
+// Datagrams are queued in host::udpIn and collected from host::udpOut
+class WiFiUDP : public Print {
+public:
+    WiFiUDP() : _port(0), _pos(0) {}
+
+    uint8_t begin(uint16_t port);
+    void    stop();
+
+    int     parsePacket();
+    int     available() { return _in.size() - _pos; }
+    int     read(uint8_t* buf, size_t size);
+    int     read();
+    void    flush() { _pos = _in.size(); }
+    IPAddress remoteIP() { return _remoteIP; }
+    uint16_t  remotePort() { return _remotePort; }
+
+    int     beginPacket(IPAddress ip, uint16_t port);
+    int     endPacket();
+    using Print::write;
+    size_t  write(uint8_t c) override { _out.push_back(c); return 1; }
+    size_t  write(const uint8_t* buf, size_t size) override { _out.insert(_out.end(), buf, buf + size); return size; }
+
+private:
+    uint16_t             _port;
+    std::vector<uint8_t> _in;
+    size_t               _pos;
+    IPAddress            _remoteIP;
+    uint16_t             _remotePort;
+    std::vector<uint8_t> _out;
+    IPAddress            _outIP;
+    uint16_t             _outPort;
+};
+
+#endif
@@ -0,0 +1,100 @@
+// Counts heap use of the code under test. malloc() and friends are wrapped at
+// link time (-Wl,--wrap=malloc,...) and operator new/delete are replaced, so
+// both the library's C allocations and its C++ objects are seen.
+
+#include "host.h"
+#include <malloc.h>
+#include <new>
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void  __real_free(void* ptr);
+}
+
+static host::AllocStats stats;
+
+static void counted(void* ptr) {
+    if (ptr != NULL) {
+        stats.count++;
+        stats.live += malloc_usable_size(ptr);
+        if (stats.live > stats.peak) {
+            stats.peak = stats.live;
+        }
+    }
+}
+
+static void released(void* ptr) {
+    if (ptr != NULL) {
+        size_t size = malloc_usable_size(ptr);
+        stats.live = (stats.live > size) ? stats.live - size : 0;
+    }
+}
+
+extern "C" {
+
+void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+    counted(ptr);
+    return ptr;
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    void* ptr = __real_calloc(n, size);
+    counted(ptr);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    released(ptr);
+    void* result = __real_realloc(ptr, size);
+    // A failed realloc leaves the old block in place
+    counted((result != NULL || size == 0) ? result : ptr);
+    return result;
+}
+
+void __wrap_free(void* ptr) {
+    released(ptr);
+    __real_free(ptr);
+}
+
+}
+
+void* operator new(size_t size) {
+    void* ptr = __wrap_malloc(size ? size : 1);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return __wrap_malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return __wrap_malloc(size ? size : 1);
+}
+
+void operator delete(void* ptr) noexcept { __wrap_free(ptr); }
+void operator delete[](void* ptr) noexcept { __wrap_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { __wrap_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { __wrap_free(ptr); }
+
+namespace host {
+
+AllocStats allocs() {
+    return stats;
+}
+
+void resetAllocs() {
+    stats.count = 0;
+    stats.peak = stats.live;
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef HOST_ESP_WIFI_H
+#define HOST_ESP_WIFI_H
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+typedef enum {
+    WIFI_AUTH_OPEN = 0, WIFI_AUTH_WEP, WIFI_AUTH_WPA_PSK, WIFI_AUTH_WPA2_PSK, WIFI_AUTH_WPA_WPA2_PSK
+} wifi_auth_mode_t;
+
+typedef struct {
+    uint8_t          bssid[6];
+    uint8_t          ssid[33];
+    uint8_t          primary;
+    int              second;
+    int8_t           rssi;
+    wifi_auth_mode_t authmode;
+} wifi_ap_record_t;
+
+typedef enum {
+    WIFI_REASON_UNSPECIFIED          = 1,
+    WIFI_REASON_AUTH_EXPIRE          = 2,
+    WIFI_REASON_ASSOC_LEAVE          = 8,
+    WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+    WIFI_REASON_BEACON_TIMEOUT       = 200,
+    WIFI_REASON_NO_AP_FOUND          = 201,
+    WIFI_REASON_AUTH_FAIL            = 202,
+    WIFI_REASON_ASSOC_FAIL           = 203,
+    WIFI_REASON_HANDSHAKE_TIMEOUT    = 204,
+    WIFI_REASON_CONNECTION_FAIL      = 205
+} wifi_err_reason_t;
+
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP } wifi_interface_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t password[64];
+    int     scan_method;
+    bool    bssid_set;
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_sta_config_t;
+
+typedef union {
+    wifi_sta_config_t sta;
+} wifi_config_t;
+
+typedef enum { WIFI_STORAGE_FLASH, WIFI_STORAGE_RAM } wifi_storage_t;
+
+// Station config as the driver keeps it: the running copy, and the copy in
+// flash that set_config() also writes while storage is WIFI_STORAGE_FLASH
+esp_err_t esp_wifi_get_config(wifi_interface_t iface, wifi_config_t* conf);
+esp_err_t esp_wifi_set_config(wifi_interface_t iface, wifi_config_t* conf);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+
+#endif
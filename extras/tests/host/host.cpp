@@ -0,0 +1,234 @@
+#include "host.h"
+#include "Preferences.h"
+#include "nvs_flash.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <chrono>
+#include <random>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace host {
+
+uint32_t freeHeap = 200000;
+uint32_t minFreeHeap = 180000;
+uint32_t maxAllocHeap = 110000;
+bool     restarted = false;
+
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+unsigned nvsWrites = 0;
+
+static unsigned long long skewMicros = 0;
+
+void advance(unsigned long ms) {
+    skewMicros += (unsigned long long)ms * 1000;
+}
+
+}
+
+static unsigned long long nowMicros() {
+    static const auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + host::skewMicros;
+}
+
+unsigned long millis() {
+    return (unsigned long)(uint32_t)(nowMicros() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)nowMicros();
+}
+
+void delay(unsigned long ms) {
+    host::advance(ms);
+}
+
+void yield() {
+}
+
+uint32_t esp_random() {
+    static std::mt19937 gen(12345);
+    return gen();
+}
+
+uint64_t EspClass::getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+uint32_t EspClass::getFlashChipSize() { return 4 * 1024 * 1024; }
+uint32_t EspClass::getFreeHeap() { return host::freeHeap; }
+uint32_t EspClass::getMinFreeHeap() { return host::minFreeHeap; }
+uint32_t EspClass::getMaxAllocHeap() { return host::maxAllocHeap; }
+void     EspClass::restart() { host::restarted = true; }
+
+esp_err_t nvs_flash_init() {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase_partition(const char* label) {
+    host::nvs.clear();
+    return ESP_OK;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition) {
+    if (readOnly && host::nvs.find(name) == host::nvs.end()) {
+        return false;
+    }
+    _name = name;
+    _open = true;
+    _readOnly = readOnly;
+    host::nvs[_name];
+    return true;
+}
+
+void Preferences::end() {
+    _open = false;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+    int32_t value;
+    return (getBytes(key, &value, sizeof(value)) == sizeof(value)) ? value : defaultValue;
+}
+
+size_t Preferences::putInt(const char* key, int32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!_open) {
+        return 0;
+    }
+    auto& ns = host::nvs[_name];
+    auto it = ns.find(key);
+    return (it == ns.end()) ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    size_t len = getBytesLength(key);
+    // Like nvs_get_blob(), a buffer that is too small gets nothing
+    if (len == 0 || len > maxLen) {
+        return 0;
+    }
+    memcpy(buf, host::nvs[_name][key].data(), len);
+    return len;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!_open || _readOnly) {
+        return 0;
+    }
+    const uint8_t* p = static_cast<const uint8_t*>(value);
+    host::nvs[_name][key].assign(p, p + len);
+    host::nvsWrites++;
+    return len;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_open || _readOnly) {
+        return false;
+    }
+    return host::nvs[_name].erase(key) > 0;
+}
+
+bool Preferences::clear() {
+    if (!_open || _readOnly) {
+        return false;
+    }
+    host::nvs[_name].clear();
+    return true;
+}
+
+bool Preferences::isKey(const char* key) {
+    return getBytesLength(key) > 0;
+}
+
+struct HostEventGroup {
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup{0};
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete static_cast<HostEventGroup*>(group);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    return static_cast<HostEventGroup*>(group)->bits |= bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t before = static_cast<HostEventGroup*>(group)->bits;
+    static_cast<HostEventGroup*>(group)->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    return static_cast<HostEventGroup*>(group)->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear,
+                                BaseType_t all, TickType_t ticks) {
+    HostEventGroup* g = static_cast<HostEventGroup*>(group);
+    bool done = all ? (g->bits & bits) == bits : (g->bits & bits) != 0;
+    if (!done) {
+        host::advance(ticks);
+    }
+    EventBits_t result = g->bits;
+    if (done && clear) {
+        g->bits &= ~bits;
+    }
+    return result;
+}
+
+struct HostMutex {
+    unsigned depth;
+};
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return new HostMutex{0};
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t mutex) {
+    delete static_cast<HostMutex*>(mutex);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks) {
+    static_cast<HostMutex*>(mutex)->depth++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) {
+    HostMutex* m = static_cast<HostMutex*>(mutex);
+    if (m->depth == 0) {
+        return pdFALSE;
+    }
+    m->depth--;
+    return pdTRUE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+}
+
+void vTaskDelay(TickType_t ticks) {
+    host::advance(ticks);
+}
+
+TickType_t xTaskGetTickCount() {
+    return millis();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    host::advance(ticks);
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return pdPASS;
+}
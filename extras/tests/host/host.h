@@ -0,0 +1,81 @@
+#ifndef HOST_HOST_H
+#define HOST_HOST_H
+
+// Controls for the host stand-ins, used by the tests only
+
+#include "WiFi.h"
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace host {
+
+// Moves millis()/micros() forward without sleeping; delay() does the same
+void advance(unsigned long ms);
+
+// What ESP.getFreeHeap() and friends report
+extern uint32_t freeHeap;
+extern uint32_t minFreeHeap;
+extern uint32_t maxAllocHeap;
+extern bool     restarted;
+
+// Heap use of the test binary, counted by alloc.cpp
+struct AllocStats {
+    size_t count;   // allocations since resetAllocs()
+    size_t live;    // bytes allocated and not freed
+    size_t peak;    // highest live since resetAllocs()
+};
+AllocStats allocs();
+void       resetAllocs();
+
+// NVS contents by namespace and key, and the number of writes
+extern std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+extern unsigned nvsWrites;
+
+// Radio state behind WiFiClass and esp_wifi_*
+struct WiFiState {
+    wl_status_t    status;
+    wifi_mode_t    mode;
+    bool           persistent;
+    bool           autoReconnect;
+    wifi_storage_t storage;
+    wifi_config_t  running;
+    wifi_config_t  flash;
+    IPAddress      localIP;
+    IPAddress      staticIP;
+    uint8_t        stations;
+    int8_t         rssi;
+    uint8_t        bssid[6];
+    std::vector<wifi_ap_record_t> aps;
+    int16_t        scanStatus;      // count, WIFI_SCAN_RUNNING or WIFI_SCAN_FAILED
+    bool           holdScan;        // async scans stay running until released
+    unsigned       begins;
+    std::function<void()> onBegin;  // runs at the end of every WiFi.begin()
+};
+extern WiFiState wifi;
+
+// Back to a blank device: radio, NVS, heap figures and queued connections
+void reset();
+void addAP(const char* ssid, int8_t rssi, uint8_t channel = 6, wifi_auth_mode_t auth = WIFI_AUTH_WPA2_PSK);
+// Delivers a driver event to the handlers registered with WiFi.onEvent(). GOT_IP
+// and DISCONNECTED also update the station status.
+void fireEvent(arduino_event_id_t event, uint8_t reason = 0);
+std::string configSSID(const wifi_config_t& conf);
+
+// Opens a connection to the server and returns the test's end of it
+int         connect();
+// Everything readable on fd without blocking
+std::string receive(int fd);
+void        send(int fd, const std::string& data);
+
+struct Datagram {
+    IPAddress            ip;
+    uint16_t             port;
+    std::vector<uint8_t> data;
+};
+extern std::deque<Datagram> udpIn;
+extern std::deque<Datagram> udpOut;
+
+}
+
+#endif
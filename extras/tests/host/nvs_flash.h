@@ -0,0 +1,9 @@
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+
+#include "esp_wifi.h"
+
+esp_err_t nvs_flash_init();
+esp_err_t nvs_flash_erase_partition(const char* label);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef HOST_PING_SOCK_H
+#define HOST_PING_SOCK_H
+
+#include <stdint.h>
+#include "esp_wifi.h"
+
+// No ICMP on the host: sessions cannot be created, so a cached lease is never confirmed
+
+typedef struct { uint32_t addr; uint8_t type; } ip_addr_t;
+typedef void* esp_ping_handle_t;
+
+typedef struct {
+    uint32_t  count;
+    uint32_t  interval_ms;
+    uint32_t  timeout_ms;
+    uint32_t  data_size;
+    int       tos;
+    int       ttl;
+    ip_addr_t target_addr;
+    uint32_t  task_stack_size;
+    uint32_t  task_prio;
+    uint32_t  interface;
+} esp_ping_config_t;
+
+#define ESP_PING_DEFAULT_CONFIG() { 5, 1000, 1000, 64, 0, 64, { 0, 0 }, 2048, 2, 0 }
+
+typedef struct {
+    void* cb_args;
+    void (*on_ping_success)(esp_ping_handle_t, void*);
+    void (*on_ping_timeout)(esp_ping_handle_t, void*);
+    void (*on_ping_end)(esp_ping_handle_t, void*);
+} esp_ping_callbacks_t;
+
+#define IP_ADDR4(ipaddr, a, b, c, d) do { \
+    (ipaddr)->addr = ((uint32_t)(a)) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24); \
+    (ipaddr)->type = 0; } while (0)
+
+inline esp_err_t esp_ping_new_session(const esp_ping_config_t*, const esp_ping_callbacks_t*, esp_ping_handle_t*) { return ESP_FAIL; }
+inline esp_err_t esp_ping_start(esp_ping_handle_t) { return ESP_FAIL; }
+inline esp_err_t esp_ping_stop(esp_ping_handle_t) { return ESP_FAIL; }
+inline esp_err_t esp_ping_delete_session(esp_ping_handle_t) { return ESP_FAIL; }
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef WM_TEST_PORTAL_H
+#define WM_TEST_PORTAL_H
+
+// Drives a SimpleWiFiManager portal over host connections
+
+#include "test.h"
+#include "SimpleWiFiManager.h"
+#include <unistd.h>
+
+struct SimpleWiFiManagerTest {
+    static PortalServer* server(SimpleWiFiManager& wm) { return wm._server.get(); }
+    static CaptiveDNSServer* dns(SimpleWiFiManager& wm) { return wm._dnsServer.get(); }
+    static WiFiScanCache& scanCache(SimpleWiFiManager& wm) { return wm._scanCache; }
+    static bool captivePortal(SimpleWiFiManager& wm) { return wm.captivePortal(); }
+    static bool isIp(const char* s) { return SimpleWiFiManager::isIp(s); }
+    static size_t formatIp(const IPAddress& ip, char* buf) { return SimpleWiFiManager::formatIp(ip, buf); }
+    static uint32_t portalFreeHeap(SimpleWiFiManager& wm) { return wm._portalFreeHeap; }
+    static WiFiCredentialStore& credentials(SimpleWiFiManager& wm) { return wm._credentials; }
+    static wm_connect_result_t connectKnownNetworks(SimpleWiFiManager& wm) { return wm.connectKnownNetworks(); }
+    static unsigned long backoffDelay(SimpleWiFiManager& wm, uint8_t attempts) { return wm.backoffDelay(attempts); }
+    // Runs the supervisor loop on the calling thread until stopSupervisor()
+    static void runSupervisor(SimpleWiFiManager& wm) { wm.runSupervisor(); }
+    static void stopSupervisor(SimpleWiFiManager& wm) { wm._supervisorStop = true; }
+};
+
+inline std::string httpGet(const std::string& path, const std::string& hostHeader = "192.168.4.1") {
+    return "GET " + path + " HTTP/1.1\r\nHost: " + hostHeader + "\r\nConnection: close\r\n\r\n";
+}
+
+inline std::string httpPost(const std::string& path, const std::string& body) {
+    return "POST " + path + " HTTP/1.1\r\nHost: 192.168.4.1\r\nConnection: close\r\n"
+           "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// Sends one request, runs one process() slice and returns what came back
+inline std::string fetch(SimpleWiFiManager& wm, const std::string& request) {
+    int fd = host::connect();
+    host::send(fd, request);
+    wm.process();
+    std::string response = host::receive(fd);
+    close(fd);
+    return response;
+}
+
+// Body of a chunked response, without the chunk framing
+inline std::string dechunk(const std::string& response) {
+    size_t pos = response.find("\r\n\r\n");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    pos += 4;
+    if (response.find("Transfer-Encoding: chunked") == std::string::npos) {
+        return response.substr(pos);
+    }
+    std::string body;
+    while (pos < response.size()) {
+        size_t end = response.find("\r\n", pos);
+        size_t size = strtoul(response.substr(pos, end - pos).c_str(), NULL, 16);
+        if (size == 0) {
+            break;
+        }
+        body += response.substr(end + 2, size);
+        pos = end + 2 + size + 2;
+    }
+    return body;
+}
+
+#endif
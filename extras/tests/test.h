@@ -0,0 +1,64 @@
+#ifndef WM_TEST_H
+#define WM_TEST_H
+
+// Minimal check macros for the host tests. Each test file is its own program;
+// it returns non-zero when a check failed.
+
+#include "host.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+static int testFailures = 0;
+static int testChecks = 0;
+
+#define CHECK(cond) do { \
+    testChecks++; \
+    if (!(cond)) { \
+        testFailures++; \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    testChecks++; \
+    auto _va = (a); \
+    auto _vb = (b); \
+    if (!(_va == _vb)) { \
+        testFailures++; \
+        printf("%s:%d: CHECK_EQ(%s, %s) failed: %s != %s\n", __FILE__, __LINE__, #a, #b, \
+               testValue(_va).c_str(), testValue(_vb).c_str()); \
+    } \
+} while (0)
+
+#define CHECK_CONTAINS(haystack, needle) CHECK(std::string(haystack).find(needle) != std::string::npos)
+
+inline std::string testValue(const std::string& v) { return "\"" + v + "\""; }
+inline std::string testValue(const char* v) { return v ? testValue(std::string(v)) : "NULL"; }
+inline std::string testValue(bool v) { return v ? "true" : "false"; }
+template <class T> std::string testValue(const T& v) { return std::to_string(v); }
+
+#define RUN(test) do { printf("  %s\n", #test); test(); } while (0)
+
+inline int testReport(const char* name) {
+    printf("%s: %d checks, %d failed\n", name, testChecks, testFailures);
+    return testFailures ? 1 : 0;
+}
+
+// Benchmarks only run with WM_BENCH set (make bench builds without sanitizers).
+// They print host figures; none of them stands in for a measurement on the chip.
+inline bool benchEnabled() {
+    return getenv("WM_BENCH") != NULL;
+}
+
+template <class F>
+double benchMicros(int iterations, F fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+#endif
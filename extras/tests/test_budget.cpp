@@ -0,0 +1,116 @@
+// Heap budget mode: the reserved render buffer and the degraded pages (user-025)
+
+#include "portal.h"
+
+static int countOf(const std::string& s, const std::string& needle) {
+    int n = 0;
+    for (size_t p = 0; (p = s.find(needle, p)) != std::string::npos; p++) {
+        n++;
+    }
+    return n;
+}
+
+// Rows of the scan list on a /wifi page
+static int scanRows(SimpleWiFiManager& wm) {
+    return countOf(fetch(wm, httpGet("/wifi")), "onclick='c(this)'");
+}
+
+// Networks named with 32 double quotes, each escaped to six bytes, at full signal
+static void addWorstCaseNetworks(int n) {
+    const std::string quotes(32, '"');
+    for (int i = 0; i < n; i++) {
+        host::addAP(quotes.c_str(), -30);
+    }
+}
+
+// The largest page the portal renders without parameters fits the buffer, so
+// it goes out in one piece. A failure here means WM_RENDER_BUFFER_SIZE needs
+// the new figure.
+static void testWorstCasePageFitsTheBuffer() {
+    host::reset();
+    SimpleWiFiManager wm;
+    wm.setHeapBudget(20000);
+    wm.setRemoveDuplicateAPs(false);
+    addWorstCaseNetworks(40);
+    CHECK(wm.startConfigPortalAsync("budget-ap"));
+    wm.process();
+    CHECK_EQ(SimpleWiFiManagerTest::scanCache(wm).count(), WM_BUDGET_SCAN_RECORDS);
+
+    // A scan still running adds the polling script
+    host::advance(60000);
+    host::wifi.holdScan = true;
+    fetch(wm, httpGet("/wifi"));
+    wm.process();
+    CHECK(SimpleWiFiManagerTest::scanCache(wm).isScanning());
+
+    size_t worst = 0;
+    static const char* const PAGES[] = { "/", "/wifi", "/0wifi", "/scan.json", "/api/scan", "/i", "/api/status", "/r" };
+    for (const char* path : PAGES) {
+        PortalServer* server = SimpleWiFiManagerTest::server(wm);
+        server->chunks.clear();
+        size_t body = dechunk(fetch(wm, httpGet(path))).size();
+        CHECK(body <= WM_RENDER_BUFFER_SIZE);
+        CHECK_EQ(server->chunks.size(), (size_t)2);
+        worst = std::max(worst, body);
+    }
+    printf("    largest page %zu bytes, render buffer %d bytes\n", worst, WM_RENDER_BUFFER_SIZE);
+}
+
+static void testScanListDegradesWithTheBudget() {
+    host::reset();
+    SimpleWiFiManager wm;
+    wm.setHeapBudget(10000);
+    for (int i = 0; i < 20; i++) {
+        host::addAP(("Net" + std::to_string(i)).c_str(), -40 - i);
+    }
+    CHECK(wm.startConfigPortalAsync("budget-ap"));
+    wm.process();
+    CHECK_EQ(SimpleWiFiManagerTest::portalFreeHeap(wm), host::freeHeap);
+    CHECK_EQ(scanRows(wm), WM_BUDGET_SCAN_RECORDS);
+
+    // Half the budget used: the strongest few
+    host::freeHeap -= 5000;
+    CHECK_EQ(scanRows(wm), WM_BUDGET_SCAN_ITEMS);
+    std::string page = fetch(wm, httpGet("/wifi"));
+    CHECK_CONTAINS(page, ">Net0<");
+    CHECK(page.find(">Net6<") == std::string::npos);
+
+    // All of it: no list, the name is typed in
+    host::freeHeap -= 5000;
+    page = fetch(wm, httpGet("/wifi"));
+    CHECK_EQ(countOf(page, "onclick='c(this)'"), 0);
+    CHECK_CONTAINS(page, "Low on memory");
+    CHECK_CONTAINS(page, "name='s'");
+}
+
+// What the portal takes while it starts counts against the budget
+static void testHeapIsSampledBeforeThePortal() {
+    host::reset();
+    SimpleWiFiManager wm;
+    wm.setHeapBudget(10000);
+    for (int i = 0; i < 20; i++) {
+        host::addAP(("Net" + std::to_string(i)).c_str(), -40 - i);
+    }
+    uint32_t before = host::freeHeap;
+    // Stands in for heap taken after the portal objects, up to the AP callback
+    wm.setAPCallback([](SimpleWiFiManager*) { host::freeHeap -= 6000; });
+    CHECK(wm.startConfigPortalAsync("budget-ap"));
+    wm.process();
+    CHECK_EQ(SimpleWiFiManagerTest::portalFreeHeap(wm), before);
+    CHECK_EQ(scanRows(wm), WM_BUDGET_SCAN_ITEMS);
+
+    // The block kept for the next portal is counted as free again
+    wm.stopConfigPortal();
+    host::freeHeap = before;
+    wm.setAPCallback(NULL);
+    CHECK(wm.startConfigPortalAsync("budget-ap"));
+    CHECK(SimpleWiFiManagerTest::portalFreeHeap(wm) >= before + WM_RENDER_BUFFER_SIZE);
+    wm.stopConfigPortal();
+}
+
+int main() {
+    RUN(testWorstCasePageFitsTheBuffer);
+    RUN(testScanListDegradesWithTheBudget);
+    RUN(testHeapIsSampledBeforeThePortal);
+    return testReport("test_budget");
+}
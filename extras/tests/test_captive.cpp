@@ -0,0 +1,174 @@
+// Captive portal redirects and OS connectivity probes (user-023)
+
+#include "portal.h"
+
+static void testIsIp() {
+    const char* const yes[] = { "192.168.4.1", "0.0.0.0", "255.255.255.255", "192.168.4.1:80", "10.0.0.1:8080" };
+    for (const char* s : yes) {
+        CHECK_EQ(SimpleWiFiManagerTest::isIp(s), true);
+    }
+    const char* const no[] = { "", "captive.apple.com", "1.2.3", "1.2.3.4.5", "256.1.1.1", "1.2.3.256",
+                               "0001.1.1.1", "1..2.3", ".1.2.3", "1.2.3.4x", "1.2.3.4:", "1.2.3.4:80x",
+                               "a.b.c.d", "1.2.3.4 ", "[::1]" };
+    for (const char* s : no) {
+        CHECK_EQ(SimpleWiFiManagerTest::isIp(s), false);
+    }
+}
+
+static void testFormatIp() {
+    char buf[WM_IP_STR_LEN];
+    CHECK_EQ(SimpleWiFiManagerTest::formatIp(IPAddress(0, 0, 0, 0), buf), (size_t)7);
+    CHECK_EQ(std::string(buf), std::string("0.0.0.0"));
+    CHECK_EQ(SimpleWiFiManagerTest::formatIp(IPAddress(255, 255, 255, 255), buf), (size_t)15);
+    CHECK_EQ(std::string(buf), std::string("255.255.255.255"));
+    SimpleWiFiManagerTest::formatIp(IPAddress(10, 0, 100, 9), buf);
+    CHECK_EQ(std::string(buf), std::string("10.0.100.9"));
+    // Every octet value formats like the core's toString()
+    for (int v = 0; v < 256; v++) {
+        IPAddress ip(v, 255 - v, v / 2, 7);
+        SimpleWiFiManagerTest::formatIp(ip, buf);
+        CHECK_EQ(std::string(buf), std::string(ip.toString().c_str()));
+    }
+}
+
+static void testProbeTable() {
+    struct { const char* path; int family; } cases[] = {
+        { "/generate_204", WM_PROBE_ANDROID },
+        { "/gen_204", WM_PROBE_ANDROID },
+        { "/hotspot-detect.html", WM_PROBE_APPLE },
+        { "/library/test/success.html", WM_PROBE_APPLE },
+        { "/connecttest.txt", WM_PROBE_WINDOWS },
+        { "/ncsi.txt", WM_PROBE_WINDOWS },
+        { "/redirect", WM_PROBE_WINDOWS },
+        { "/success.txt", WM_PROBE_OTHER },
+        { "/canonical.html", WM_PROBE_OTHER },
+        { "/check_network_status.txt", WM_PROBE_OTHER },
+        { "/kindle-wifi/wifistub.html", WM_PROBE_OTHER },
+        { "", -1 },
+        { "/", -1 },
+        { "/generate_20", -1 },
+        { "/generate_2044", -1 },
+        { "/GENERATE_204", -1 },
+        { "generate_204", -1 },
+        { "/wifi", -1 },
+    };
+    for (auto& c : cases) {
+        CHECK_EQ(PortalServer::findProbe(c.path), c.family);
+    }
+    // Long paths are hashed in a loop, not by recursion
+    CHECK_EQ(PortalServer::findProbe(std::string(100000, 'a').c_str()), -1);
+}
+
+static void testRedirects() {
+    host::reset();
+    SimpleWiFiManager wm;
+    CHECK(wm.startConfigPortalAsync("captive-ap"));
+
+    // A page requested under a foreign name goes to the portal
+    std::string reply = fetch(wm, httpGet("/some/page", "example.com"));
+    CHECK_CONTAINS(reply, "HTTP/1.1 302 Found\r\n");
+    CHECK_CONTAINS(reply, "Location: http://192.168.4.1\r\n");
+    CHECK_CONTAINS(reply, "Content-Length: 0\r\n");
+
+    // The portal's own address, with or without port, and no Host at all are served
+    CHECK_CONTAINS(fetch(wm, httpGet("/", "192.168.4.1:80")), "HTTP/1.1 200");
+    CHECK_CONTAINS(fetch(wm, "GET / HTTP/1.0\r\n\r\n"), "HTTP/1.0 200");
+
+    // Probes get the prebuilt reply, whatever the Host
+    reply = fetch(wm, httpGet("/hotspot-detect.html", "captive.apple.com"));
+    CHECK_CONTAINS(reply, "Location: http://192.168.4.1/\r\n");
+    CHECK_CONTAINS(reply, "Cache-Control: no-store\r\n");
+    CHECK_CONTAINS(reply, "Connection: close\r\n");
+}
+
+static void testRedirectDoesNotAllocate() {
+    host::reset();
+    SimpleWiFiManager wm;
+    CHECK(wm.startConfigPortalAsync("captive-ap"));
+    size_t count = (size_t)-1;
+    bool redirected = false;
+    SimpleWiFiManagerTest::server(wm)->on("/measure", [&]() {
+        host::resetAllocs();
+        redirected = SimpleWiFiManagerTest::captivePortal(wm);
+        count = host::allocs().count;
+    });
+    std::string reply = fetch(wm, httpGet("/measure", "clients3.google.com"));
+    CHECK(redirected);
+    CHECK_EQ(count, (size_t)0);
+    CHECK_CONTAINS(reply, "302 Found");
+}
+
+static std::string receiveAll(SimpleWiFiManager& wm, int fd, int slices) {
+    std::string all;
+    for (int i = 0; i < slices; i++) {
+        wm.process();
+        all += host::receive(fd);
+    }
+    return all;
+}
+
+static int countOf(const std::string& s, const std::string& needle) {
+    int n = 0;
+    for (size_t p = 0; (p = s.find(needle, p)) != std::string::npos; p++) {
+        n++;
+    }
+    return n;
+}
+
+static void testProbeKeepAliveAndPipelining() {
+    host::reset();
+    SimpleWiFiManager wm;
+    CHECK(wm.startConfigPortalAsync("captive-ap"));
+    PortalServer* server = SimpleWiFiManagerTest::server(wm);
+
+    // Three probes in one segment, HTTP/1.1 without "Connection: close"
+    const std::string probe = "GET /generate_204 HTTP/1.1\r\nHost: connectivitycheck.gstatic.com\r\n\r\n";
+    int fd = host::connect();
+    host::send(fd, probe + probe + probe);
+    std::string replies = receiveAll(wm, fd, 6);
+    CHECK_EQ(countOf(replies, "HTTP/1.1 302 Found"), 3);
+    CHECK_EQ(countOf(replies, "Connection: keep-alive"), 3);
+    CHECK_EQ(server->openClients(), (uint8_t)1);
+
+    // A redirect through the handler chain keeps the connection as well
+    host::send(fd, "GET /favicon.ico HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    replies = receiveAll(wm, fd, 2);
+    CHECK_CONTAINS(replies, "Location: http://192.168.4.1\r\n");
+    CHECK_CONTAINS(replies, "Connection: keep-alive");
+    CHECK_EQ(server->openClients(), (uint8_t)1);
+
+    // "Connection: close" ends it after the reply
+    host::send(fd, "GET /ncsi.txt HTTP/1.1\r\nHost: www.msftncsi.com\r\nConnection: close\r\n\r\n");
+    replies = receiveAll(wm, fd, 2);
+    CHECK_CONTAINS(replies, "Connection: close");
+    CHECK_EQ(server->openClients(), (uint8_t)0);
+    close(fd);
+
+    // So does HTTP/1.0
+    fd = host::connect();
+    host::send(fd, "GET /generate_204 HTTP/1.0\r\n\r\n");
+    replies = receiveAll(wm, fd, 2);
+    CHECK_CONTAINS(replies, "Connection: close");
+    CHECK_EQ(server->openClients(), (uint8_t)0);
+    close(fd);
+
+    // An idle kept-alive connection is closed after WM_PORTAL_KEEPALIVE_TIMEOUT
+    fd = host::connect();
+    host::send(fd, probe);
+    receiveAll(wm, fd, 2);
+    CHECK_EQ(server->openClients(), (uint8_t)1);
+    host::advance(WM_PORTAL_KEEPALIVE_TIMEOUT + 1);
+    wm.process();
+    CHECK_EQ(server->openClients(), (uint8_t)0);
+    close(fd);
+}
+
+int main() {
+    RUN(testIsIp);
+    RUN(testFormatIp);
+    RUN(testProbeTable);
+    RUN(testRedirects);
+    RUN(testRedirectDoesNotAllocate);
+    RUN(testProbeKeepAliveAndPipelining);
+    return testReport("test_captive");
+}
@@ -0,0 +1,232 @@
+// Remembered networks: ranking, replacement, NVS writes and retry order (user-011)
+
+#include "portal.h"
+#include "wificredentials.h"
+
+static void testAddAndUpdate() {
+    host::reset();
+    WiFiCredentialStore store;
+    CHECK_EQ(store.count(), 0);
+    store.add("Home", "secret1");
+    store.add("", "ignored");
+    store.add("Office", "secret2");
+    CHECK_EQ(store.count(), 2);
+    CHECK_EQ(store.find("Office"), 1);
+    CHECK_EQ(store.find("Cafe"), -1);
+
+    store.save();
+    CHECK_EQ(host::nvsWrites, 1u);
+    // The same password again changes nothing, so nothing is written
+    store.add("Home", "secret1");
+    store.save();
+    CHECK_EQ(host::nvsWrites, 1u);
+
+    // A new password starts the network over without failures
+    store.recordFailure(0, -70);
+    store.add("Home", "changed");
+    CHECK_EQ(std::string(store.get(0).pass), std::string("changed"));
+    CHECK_EQ(store.get(0).failures, (uint8_t)0);
+    CHECK_EQ(store.count(), 2);
+}
+
+static void testScore() {
+    host::reset();
+    WiFiCredentialStore store;
+    store.add("Never", "p");
+    store.add("Earlier", "p");
+    store.add("Recent", "p");
+    store.recordSuccess(1, -60);
+    store.recordSuccess(2, -60);
+
+    CHECK_EQ(store.score(0, -60), -60);
+    CHECK_EQ(store.score(1, -60), -60 + 10);
+    CHECK_EQ(store.score(2, -60), -60 + 10 + 15);
+
+    // Ten points per failure, at most five of them count
+    for (int i = 1; i <= 7; i++) {
+        store.recordFailure(0, -60);
+        CHECK_EQ(store.score(0, -60), -60 - 10 * std::min(i, 5));
+    }
+    CHECK_EQ(store.get(0).failures, (uint8_t)7);
+
+    // A success clears the failures and makes the network the most recent
+    store.recordSuccess(0, -60);
+    CHECK_EQ(store.score(0, -60), -60 + 25);
+    CHECK_EQ(store.score(2, -60), -60 + 10);
+}
+
+static void testFullStoreReplacesTheLowest() {
+    host::reset();
+    WiFiCredentialStore store;
+    for (int i = 0; i < WIFI_MANAGER_MAX_NETWORKS; i++) {
+        store.add(("Net" + std::to_string(i)).c_str(), "p");
+        store.recordSuccess(i, -50);
+    }
+    // Net1 keeps failing, so it makes way
+    store.recordFailure(1, -50);
+    store.recordFailure(1, -50);
+    store.add("Newcomer", "p");
+    CHECK_EQ(store.count(), WIFI_MANAGER_MAX_NETWORKS);
+    CHECK_EQ(store.find("Net1"), -1);
+    CHECK_EQ(store.find("Newcomer"), 1);
+    CHECK_EQ(store.get(1).lastSuccess, 0u);
+    CHECK_EQ(store.get(1).lastRSSI, (int8_t)-100);
+}
+
+static void testRewritesAreSkipped() {
+    host::reset();
+    WiFiCredentialStore store;
+    store.add("Home", "p");
+    store.recordSuccess(0, -50);
+    store.save();
+    unsigned writes = host::nvsWrites;
+
+    // Reconnecting to the most recent network is not worth a flash write
+    for (int i = 0; i < 10; i++) {
+        store.recordSuccess(0, -40 - i);
+        store.save();
+    }
+    CHECK_EQ(host::nvsWrites, writes);
+
+    // After a failure the next success is
+    store.recordFailure(0, -80);
+    store.recordSuccess(0, -50);
+    store.save();
+    CHECK_EQ(host::nvsWrites, writes + 1);
+}
+
+static void testNvsRoundTrip() {
+    host::reset();
+    {
+        WiFiCredentialStore store;
+        store.add("Home", "secret1");
+        store.add("Office", std::string(64, 'k').c_str());
+        store.recordSuccess(1, -55);
+        store.recordFailure(0, -80);
+        store.save();
+    }
+    WiFiCredentialStore loaded;
+    CHECK_EQ(loaded.count(), 2);
+    CHECK_EQ(std::string(loaded.get(1).pass), std::string(64, 'k'));
+    CHECK_EQ(loaded.get(1).lastSuccess, 1u);
+    CHECK_EQ(loaded.get(0).failures, (uint8_t)1);
+    CHECK_EQ(loaded.get(0).lastRSSI, (int8_t)-80);
+    // The sequence counter came back too, so Office is still the most recent
+    CHECK_EQ(loaded.score(1, -55), -55 + 25);
+
+    // A blob of another version or size is ignored
+    std::vector<uint8_t>& blob = host::nvs["wm"]["creds"];
+    blob[0]++;
+    WiFiCredentialStore wrongVersion;
+    CHECK_EQ(wrongVersion.count(), 0);
+    blob[0]--;
+    blob.pop_back();
+    WiFiCredentialStore truncated;
+    CHECK_EQ(truncated.count(), 0);
+
+    // Clearing an empty store writes nothing
+    host::nvs.clear();
+    unsigned writes = host::nvsWrites;
+    WiFiCredentialStore empty;
+    empty.clear();
+    empty.save();
+    CHECK_EQ(host::nvsWrites, writes);
+}
+
+static void testKnownNetworksAreTriedBestFirst() {
+    host::reset();
+    host::addAP("Cafe", -70);
+    host::addAP("Office", -50);
+    host::addAP("Neighbour", -40);
+    // Every network but Cafe accepts the password
+    std::vector<std::string> tried;
+    host::wifi.onBegin = [&tried]() {
+        tried.push_back(host::configSSID(host::wifi.running));
+        if (tried.back() == "Cafe") {
+            host::fireEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_AUTH_FAIL);
+        } else {
+            host::fireEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+        }
+    };
+
+    SimpleWiFiManager wm;
+    WiFiCredentialStore& store = SimpleWiFiManagerTest::credentials(wm);
+    store.add("Office", "p");
+    store.add("Away", "p");
+    store.add("Cafe", "p");
+    store.recordSuccess(2, -70);
+
+    // Cafe scores -70 + 25 against Office at -50; Away is not in range.
+    // The first network that connects ends the round.
+    CHECK_EQ(SimpleWiFiManagerTest::connectKnownNetworks(wm), WM_CONNECT_OK);
+    CHECK_EQ(tried.size(), (size_t)2);
+    CHECK_EQ(tried[0], std::string("Cafe"));
+    CHECK_EQ(tried[1], std::string("Office"));
+    CHECK_EQ(store.get(2).failures, (uint8_t)1);
+    CHECK_EQ(store.get(0).failures, (uint8_t)0);
+
+    // The failure takes Cafe down to -55, below Office
+    tried.clear();
+    CHECK_EQ(SimpleWiFiManagerTest::connectKnownNetworks(wm), WM_CONNECT_OK);
+    CHECK_EQ(tried.size(), (size_t)1);
+    CHECK_EQ(tried[0], std::string("Office"));
+
+    // Nothing stored in range
+    host::wifi.aps.clear();
+    CHECK_EQ(SimpleWiFiManagerTest::connectKnownNetworks(wm), WM_CONNECT_NO_AP_FOUND);
+}
+
+static void testBackoff() {
+    host::reset();
+    SimpleWiFiManager wm;
+    wm.setReconnectBackoff(2, 30);
+    // Half of each step is fixed and half random, and the steps double up to the cap
+    const unsigned long steps[] = { 2000, 4000, 8000, 16000, 30000, 30000 };
+    for (uint8_t attempts = 0; attempts < 6; attempts++) {
+        unsigned long low = steps[attempts];
+        unsigned long high = 0;
+        for (int i = 0; i < 200; i++) {
+            unsigned long d = SimpleWiFiManagerTest::backoffDelay(wm, attempts);
+            low = std::min(low, d);
+            high = std::max(high, d);
+        }
+        CHECK(low >= steps[attempts] / 2);
+        CHECK(high <= steps[attempts]);
+        // Spread over the range rather than a fixed value
+        CHECK(high - low > steps[attempts] / 4);
+    }
+    CHECK(SimpleWiFiManagerTest::backoffDelay(wm, 255) <= 30000);
+
+    wm.setReconnectBackoff(5, 1);
+    CHECK(SimpleWiFiManagerTest::backoffDelay(wm, 3) >= 2500);
+    CHECK(SimpleWiFiManagerTest::backoffDelay(wm, 3) <= 5000);
+}
+
+static void testSupervisorRefreshesTheLease() {
+    host::reset();
+    memcpy(host::wifi.running.sta.ssid, "Office", 7);
+    SimpleWiFiManager wm;
+    wm.setDHCPLeaseCache(true);
+    // The link is down; the first retry connects and ends the run
+    host::wifi.onBegin = [&wm]() {
+        host::fireEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+        SimpleWiFiManagerTest::stopSupervisor(wm);
+    };
+    SimpleWiFiManagerTest::runSupervisor(wm);
+
+    CHECK_EQ(host::wifi.begins, 1u);
+    CHECK_EQ(WM_SUPERVISOR_RESULT(wm.getSupervisorStatus()), WM_CONNECT_OK);
+    CHECK_EQ(host::nvs["wm"].count("lease"), (size_t)1);
+}
+
+int main() {
+    RUN(testAddAndUpdate);
+    RUN(testScore);
+    RUN(testFullStoreReplacesTheLowest);
+    RUN(testRewritesAreSkipped);
+    RUN(testNvsRoundTrip);
+    RUN(testKnownNetworksAreTriedBestFirst);
+    RUN(testBackoff);
+    RUN(testSupervisorRefreshesTheLease);
+    return testReport("test_credentials");
+}
@@ -0,0 +1,114 @@
+// Disconnect reasons to outcome bits, and waits that end on the event (user-010)
+
+#include "portal.h"
+#include "wifievents.h"
+
+static uint32_t bitsFor(uint8_t reason) {
+    uint8_t timeouts = 0;
+    return WiFiConnectEvents::bitsForDisconnect(reason, timeouts);
+}
+
+static void testDisconnectReasons() {
+    CHECK_EQ(bitsFor(WIFI_REASON_AUTH_FAIL), (uint32_t)WM_EVENT_AUTH_FAILED);
+    CHECK_EQ(bitsFor(WIFI_REASON_NO_AP_FOUND), (uint32_t)WM_EVENT_NO_AP_FOUND);
+    CHECK_EQ(bitsFor(WIFI_REASON_ASSOC_FAIL), (uint32_t)WM_EVENT_FAILED);
+    CHECK_EQ(bitsFor(WIFI_REASON_CONNECTION_FAIL), (uint32_t)WM_EVENT_FAILED);
+    // Leaving the previous AP says nothing about this attempt
+    CHECK_EQ(bitsFor(WIFI_REASON_ASSOC_LEAVE), (uint32_t)0);
+    CHECK_EQ(bitsFor(WIFI_REASON_BEACON_TIMEOUT), (uint32_t)0);
+    CHECK_EQ(bitsFor(WIFI_REASON_UNSPECIFIED), (uint32_t)0);
+}
+
+static void testHandshakeTimeoutsNeedRepeats() {
+    const uint8_t reasons[] = { WIFI_REASON_AUTH_EXPIRE, WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT,
+                                WIFI_REASON_HANDSHAKE_TIMEOUT };
+    for (uint8_t reason : reasons) {
+        uint8_t timeouts = 0;
+        for (int i = 1; i < WM_HANDSHAKE_TIMEOUT_LIMIT; i++) {
+            CHECK_EQ(WiFiConnectEvents::bitsForDisconnect(reason, timeouts), (uint32_t)0);
+        }
+        CHECK_EQ(WiFiConnectEvents::bitsForDisconnect(reason, timeouts), (uint32_t)WM_EVENT_AUTH_FAILED);
+        CHECK_EQ(timeouts, (uint8_t)WM_HANDSHAKE_TIMEOUT_LIMIT);
+    }
+    // Different timeout reasons count together within one attempt
+    uint8_t timeouts = 0;
+    WiFiConnectEvents::bitsForDisconnect(WIFI_REASON_AUTH_EXPIRE, timeouts);
+    WiFiConnectEvents::bitsForDisconnect(WIFI_REASON_HANDSHAKE_TIMEOUT, timeouts);
+    CHECK_EQ(WiFiConnectEvents::bitsForDisconnect(WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT, timeouts),
+             (uint32_t)WM_EVENT_AUTH_FAILED);
+    // Other reasons leave the count alone, and it saturates
+    WiFiConnectEvents::bitsForDisconnect(WIFI_REASON_NO_AP_FOUND, timeouts);
+    CHECK_EQ(timeouts, (uint8_t)3);
+    timeouts = 254;
+    WiFiConnectEvents::bitsForDisconnect(WIFI_REASON_AUTH_EXPIRE, timeouts);
+    CHECK_EQ(WiFiConnectEvents::bitsForDisconnect(WIFI_REASON_AUTH_EXPIRE, timeouts),
+             (uint32_t)WM_EVENT_AUTH_FAILED);
+    CHECK_EQ(timeouts, (uint8_t)255);
+}
+
+static void testResultPriority() {
+    CHECK_EQ(WiFiConnectEvents::resultFromBits(0), WM_CONNECT_PENDING);
+    CHECK_EQ(WiFiConnectEvents::resultFromBits(WM_EVENT_FAILED), WM_CONNECT_FAILED);
+    CHECK_EQ(WiFiConnectEvents::resultFromBits(WM_EVENT_FAILED | WM_EVENT_NO_AP_FOUND), WM_CONNECT_NO_AP_FOUND);
+    CHECK_EQ(WiFiConnectEvents::resultFromBits(WM_EVENT_NO_AP_FOUND | WM_EVENT_AUTH_FAILED), WM_CONNECT_AUTH_FAILED);
+    // An address beats any failure seen on the way
+    CHECK_EQ(WiFiConnectEvents::resultFromBits(WM_CONNECT_EVENT_BITS), WM_CONNECT_OK);
+    // Bits outside the outcome set are ignored
+    CHECK_EQ(WiFiConnectEvents::resultFromBits(1 << 8), WM_CONNECT_PENDING);
+}
+
+static unsigned long portalOpenedAt;
+
+// Time from autoConnect() until the portal opens, with onBegin playing the driver
+static unsigned long timeToPortal(std::function<void()> driver) {
+    host::reset();
+    host::wifi.onBegin = driver;
+    SimpleWiFiManager wm;
+    wm.setConnectTimeout(30);
+    wm.setConfigPortalTimeout(1);
+    wm.setAPCallback([](SimpleWiFiManager*) { portalOpenedAt = millis(); });
+    portalOpenedAt = 0;
+    unsigned long start = millis();
+    CHECK(!wm.autoConnect("events-ap"));
+    return portalOpenedAt - start;
+}
+
+static void testWaitEndsOnTheEvent() {
+    host::reset();
+    host::wifi.onBegin = []() { host::fireEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP); };
+    SimpleWiFiManager wm;
+    wm.setConnectTimeout(30);
+    unsigned long start = millis();
+    CHECK(wm.autoConnect("events-ap"));
+    CHECK(millis() - start < 100);
+    CHECK_EQ(wm.getLastConnectResult(), WM_CONNECT_OK);
+
+    // A definitive failure opens the portal at once instead of after the
+    // timeout; the 500 ms are the softAP settle delay in openConfigPortal()
+    unsigned long wrongPassword = timeToPortal([]() {
+        host::fireEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_AUTH_FAIL);
+    });
+    CHECK(wrongPassword < 1000);
+    unsigned long notFound = timeToPortal([]() {
+        host::fireEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+    });
+    CHECK(notFound < 1000);
+
+    // A single handshake timeout is not a verdict, the wait runs its course
+    unsigned long weakLink = timeToPortal([]() {
+        host::fireEvent(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_HANDSHAKE_TIMEOUT);
+    });
+    CHECK(weakLink >= 30000);
+    unsigned long silent = timeToPortal(nullptr);
+    CHECK(silent >= 30000);
+    printf("    portal after: auth fail %lu ms, no AP %lu ms, one handshake timeout %lu ms, no event %lu ms\n",
+           wrongPassword, notFound, weakLink, silent);
+}
+
+int main() {
+    RUN(testDisconnectReasons);
+    RUN(testHandshakeTimeoutsNeedRepeats);
+    RUN(testResultPriority);
+    RUN(testWaitEndsOnTheEvent);
+    return testReport("test_events");
+}
@@ -0,0 +1,68 @@
+// Metric scopes (user-017)
+
+#include "test.h"
+#include "wifimetrics.h"
+#include <thread>
+
+#ifdef WM_METRICS
+
+// Real time passes too, so each figure gets a millisecond of slack
+static bool near(uint64_t micros, uint64_t expected) {
+    return micros >= expected && micros < expected + 1000;
+}
+
+static void testNestedScopesCountOnce() {
+    WiFiManagerMetrics::reset();
+    {
+        WiFiManagerMetrics::Scope outer(WM_METRIC_WIFI);
+        host::advance(5);
+        {
+            WiFiManagerMetrics::Scope inner(WM_METRIC_CAPTIVE);
+            WM_METRIC_BYTES(100);
+            host::advance(3);
+        }
+        WM_METRIC_BYTES(20);
+    }
+    const wm_metric_stats_t& wifi = WiFiManagerMetrics::get(WM_METRIC_WIFI);
+    const wm_metric_stats_t& captive = WiFiManagerMetrics::get(WM_METRIC_CAPTIVE);
+    CHECK_EQ(wifi.count, 1u);
+    CHECK(near(wifi.totalMicros, 5000));
+    CHECK_EQ(wifi.bytes, (uint64_t)20);
+    CHECK_EQ(captive.count, 1u);
+    CHECK(near(captive.totalMicros, 3000));
+    CHECK_EQ(captive.bytes, (uint64_t)100);
+}
+
+// A scope on another task is not nested in the one open on this task
+static void testScopesOnOtherTasksAreNotNested() {
+    WiFiManagerMetrics::reset();
+    {
+        WiFiManagerMetrics::Scope outer(WM_METRIC_ROOT);
+        host::advance(4);
+        std::thread other([]() {
+            WiFiManagerMetrics::Scope scan(WM_METRIC_SCAN);
+            host::advance(2);
+        });
+        other.join();
+    }
+    CHECK(near(WiFiManagerMetrics::get(WM_METRIC_ROOT).totalMicros, 6000));
+    CHECK(near(WiFiManagerMetrics::get(WM_METRIC_SCAN).totalMicros, 2000));
+
+    // And this task's chain is intact afterwards
+    {
+        WiFiManagerMetrics::Scope outer(WM_METRIC_INFO);
+        host::advance(1);
+    }
+    CHECK(near(WiFiManagerMetrics::get(WM_METRIC_INFO).totalMicros, 1000));
+    CHECK(near(WiFiManagerMetrics::get(WM_METRIC_ROOT).totalMicros, 6000));
+}
+
+#endif
+
+int main() {
+#ifdef WM_METRICS
+    RUN(testNestedScopesCountOnce);
+    RUN(testScopesOnOtherTasksAreNotNested);
+#endif
+    return testReport("test_metrics");
+}
@@ -0,0 +1,228 @@
+// Streamed responses through PageWriter, and heap per portal handler (user-003)
+
+#include "portal.h"
+#include "webui.h"
+
+#define ROW64 "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+static const char LONG_FLASH[] PROGMEM = ROW64 ROW64 ROW64 ROW64 ROW64 ROW64 ROW64 ROW64 ROW64 ROW64;
+
+// Without a request the server answers as HTTP/1.0, so the body is unframed
+static std::string payload(const WebServer& server) {
+    return server.output.substr(server.output.find("\r\n\r\n") + 4);
+}
+
+static void testSmallWritesLeaveFullChunks() {
+    WebServer server;
+    std::string expected;
+    {
+        PageWriter page(&server);
+        page.begin(200, "text/html");
+        for (int i = 0; i < 200; i++) {
+            std::string piece = "<p>" + std::to_string(i) + "</p>";
+            page.write(piece.c_str());
+            expected += piece;
+        }
+        page.write((int32_t)-42);
+        page.write((uint32_t)7);
+        page.write((uint64_t)1234567890123ULL);
+        expected += "-4271234567890123";
+        CHECK_EQ(page.bytesWritten(), expected.size());
+    }
+    // The destructor ended the response with the zero-length chunk
+    CHECK(server.chunks.size() >= 2);
+    CHECK_EQ(server.chunks.back(), (size_t)0);
+    for (size_t i = 0; i + 2 < server.chunks.size(); i++) {
+        CHECK_EQ(server.chunks[i], (size_t)WM_PAGE_BUFFER_SIZE);
+    }
+    CHECK_EQ(payload(server), expected);
+}
+
+static void testFlashFragmentsAreNotCopied() {
+    WebServer server;
+    PageWriter page(&server);
+    page.begin(200, "text/html");
+    // Tops up the buffer, the remainder of at least a buffer goes out in place
+    page.write("head");
+    page.write_P(LONG_FLASH);
+    size_t direct = sizeof(LONG_FLASH) - 1 - (WM_PAGE_BUFFER_SIZE - 4);
+    page.end();
+
+    CHECK_EQ(server.chunks.size(), (size_t)3);
+    CHECK_EQ(server.chunks[0], (size_t)WM_PAGE_BUFFER_SIZE);
+    CHECK_EQ(server.chunks[1], direct);
+    CHECK_EQ(payload(server), std::string("head") + LONG_FLASH);
+
+    // A short remainder is copied so it can share a chunk with what follows
+    WebServer small;
+    PageWriter tail(&small);
+    tail.begin(200, "text/html");
+    tail.write_P(LONG_FLASH, 10);
+    tail.write("x");
+    tail.end();
+    CHECK_EQ(small.chunks.size(), (size_t)2);
+    CHECK_EQ(small.chunks[0], (size_t)11);
+}
+
+static void testEscaping() {
+    WebServer server;
+    PageWriter page(&server);
+    page.begin(200, "text/html");
+    page.writeEscaped("a<b>&\"c'");
+    page.write("|");
+    page.writeJsonEscaped("q\"b\\\n\x01");
+    page.end();
+    CHECK_EQ(payload(server), std::string("a&lt;b&gt;&amp;&quot;c&#39;|q\\\"b\\\\\\u000a\\u0001"));
+}
+
+static void testSharedBuffer() {
+    char shared[64];
+    PageWriter::setSharedBuffer(shared, sizeof(shared));
+    WebServer server;
+    {
+        PageWriter page(&server);
+        page.begin(200, "text/plain");
+        for (int i = 0; i < 20; i++) {
+            page.write("0123456789");
+        }
+    }
+    PageWriter::setSharedBuffer(NULL, 0);
+    CHECK_EQ(server.chunks[0], sizeof(shared));
+    CHECK_EQ(payload(server).size(), (size_t)200);
+}
+
+// Heap taken while one request is served, above what was live before it
+static size_t requestPeak(SimpleWiFiManager& wm, const std::string& request, size_t* bodySize = NULL) {
+    int fd = host::connect();
+    host::send(fd, request);
+    host::resetAllocs();
+    size_t before = host::allocs().live;
+    wm.process();
+    size_t peak = host::allocs().peak - before;
+    std::string response = host::receive(fd);
+    close(fd);
+    if (bodySize != NULL) {
+        *bodySize = dechunk(response).size();
+    }
+    return peak;
+}
+
+// handleWifi() as it was before PageWriter (git 966023f^): the whole page is
+// built in one String, with String::replace() per row and parameter. It reads
+// the same scan snapshot and parameters, so only the page assembly differs.
+// Host std::string growth is not the ESP32 String's, so the figures it gives
+// are the order of magnitude, not the exact bytes on the chip.
+static const char LEGACY_HEAD_START[] = "<!DOCTYPE html><html lang=\"en\"><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/><title>{v}</title>";
+static const char LEGACY_SCRIPT[] = "<script>function c(l){document.getElementById('s').value=l.innerText||l.textContent;document.getElementById('p').focus();} function toggleTheme(){fetch('/theme-toggle',{method:'POST'}).then(()=>{location.reload();});}</script>";
+static const char LEGACY_STYLE_LINK[] = "<link rel=\"stylesheet\" href=\"/style.css?t=0\">";
+static const char LEGACY_HEAD_END[] = "</head><body><div style='text-align:center;display:inline-block;min-width:260px;'>";
+static const char LEGACY_ITEM[] = "<div><a href='#p' onclick='c(this)'>{v}</a>&nbsp;<span class='q {i}'>{r}%</span></div>";
+static const char LEGACY_FORM_START[] = "<form method='get' action='wifisave'><input id='s' name='s' length=32 placeholder='SSID'><br/><input id='p' name='p' length=64 type='password' placeholder='password'><br/>";
+static const char LEGACY_FORM_PARAM[] = "<br/><input id='{i}' name='{n}' length={l} placeholder='{p}' value='{v}' {c}>";
+static const char LEGACY_FORM_END[] = "<br/><button type='submit'>save</button></form>";
+static const char LEGACY_SCAN_LINK[] = "<br/><div class=\"c\"><a href=\"/wifi\">Scan</a></div>";
+static const char LEGACY_END[] = "</div></body></html>";
+
+static void legacyHandleWifi(WebServer* server, WiFiScanCache& scan, const std::vector<WiFiManagerParameter*>& params) {
+    String page = LEGACY_HEAD_START;
+    page.replace("{v}", "Config ESP");
+    page += LEGACY_SCRIPT;
+    page += LEGACY_STYLE_LINK;
+    page += LEGACY_HEAD_END;
+
+    for (int i = 0; i < scan.count(); i++) {
+        const ScanRecord& ap = scan.get(i);
+        int quality = (ap.rssi <= -100) ? 0 : (ap.rssi >= -50) ? 100 : 2 * (ap.rssi + 100);
+        String item = LEGACY_ITEM;
+        String rssiQ;
+        rssiQ += quality;
+        item.replace("{v}", ap.ssid);
+        item.replace("{r}", rssiQ);
+        item.replace("{i}", (ap.auth != WIFI_AUTH_OPEN) ? "l" : "");
+        page += item;
+    }
+    page += "<br/>";
+
+    page += LEGACY_FORM_START;
+    char parLength[2];
+    for (WiFiManagerParameter* p : params) {
+        String pitem = LEGACY_FORM_PARAM;
+        pitem.replace("{i}", p->getID());
+        pitem.replace("{n}", p->getID());
+        pitem.replace("{p}", p->getPlaceholder());
+        snprintf(parLength, 2, "%d", p->getValueLength());
+        pitem.replace("{l}", parLength);
+        pitem.replace("{v}", p->getValue());
+        pitem.replace("{c}", p->getCustomHTML());
+        page += pitem;
+    }
+    page += "<br/>";
+    page += LEGACY_FORM_END;
+    page += LEGACY_SCAN_LINK;
+    page += LEGACY_END;
+
+    server->sendHeader("Content-Length", String(page.length()));
+    server->send(200, "text/html", page);
+}
+
+static void testHandlerHeapDoesNotGrowWithThePage() {
+    host::reset();
+    SimpleWiFiManager wm;
+    WiFiManagerParameter server("server", "MQTT server", "mqtt.example.com", 40);
+    WiFiManagerParameter port("port", "MQTT port", "1883", 6);
+    wm.addParameter(&server);
+    wm.addParameter(&port);
+    CHECK(wm.startConfigPortalAsync("heap-ap"));
+    SimpleWiFiManagerTest::server(wm)->recording = false;
+
+    // Let the first scan finish with a handful of networks, then with many
+    for (int i = 0; i < 5; i++) {
+        host::addAP(("Net" + std::to_string(i)).c_str(), -40 - i);
+    }
+    wm.process();
+    size_t smallPage;
+    size_t smallPeak = requestPeak(wm, httpGet("/wifi"), &smallPage);
+
+    SimpleWiFiManagerTest::scanCache(wm).end();
+    for (int i = 5; i < 60; i++) {
+        host::addAP(("Warehouse-AP-" + std::to_string(i)).c_str(), -40 - i);
+    }
+    SimpleWiFiManagerTest::scanCache(wm).scanNow();
+    SimpleWiFiManagerTest::scanCache(wm).begin();
+    size_t largePage;
+    size_t largePeak = requestPeak(wm, httpGet("/wifi"), &largePage);
+
+    CHECK(largePage > smallPage + 3000);
+    // Only the request itself and the per-page row index array grow
+    CHECK(largePeak < smallPeak + 512);
+
+    // Before: the String-built handler on the same server, scan and parameters
+    std::vector<WiFiManagerParameter*> params = { &server, &port };
+    PortalServer* portal = SimpleWiFiManagerTest::server(wm);
+    portal->on("/legacy-wifi", [&]() { legacyHandleWifi(portal, SimpleWiFiManagerTest::scanCache(wm), params); });
+    size_t legacyPage;
+    size_t legacyPeak = requestPeak(wm, httpGet("/legacy-wifi"), &legacyPage);
+    CHECK(legacyPeak > legacyPage);
+    CHECK(largePeak < legacyPeak);
+    printf("    /wifi, %d networks: String page %zu bytes, peak heap %zu bytes; "
+           "streamed page %zu bytes, peak heap %zu bytes\n",
+           SimpleWiFiManagerTest::scanCache(wm).count(), legacyPage, legacyPeak, largePage, largePeak);
+
+    static const char* const PAGES[] = { "/", "/wifi", "/0wifi", "/scan.json", "/i", "/api/status", "/api/params" };
+    for (const char* path : PAGES) {
+        size_t body;
+        size_t peak = requestPeak(wm, httpGet(path), &body);
+        printf("    %-12s page %5zu bytes, peak heap %5zu bytes\n", path, body, peak);
+    }
+    size_t body;
+    size_t peak = requestPeak(wm, httpGet("/wifisave?s=&server=broker&port=8883"), &body);
+    printf("    %-12s page %5zu bytes, peak heap %5zu bytes\n", "/wifisave?s=", body, peak);
+}
+
+int main() {
+    RUN(testSmallWritesLeaveFullChunks);
+    RUN(testFlashFragmentsAreNotCopied);
+    RUN(testEscaping);
+    RUN(testSharedBuffer);
+    RUN(testHandlerHeapDoesNotGrowWithThePage);
+    return testReport("test_pagewriter");
+}
@@ -0,0 +1,178 @@
+// Parameter values in one CRC-checked NVS blob (user-013)
+
+#include "portal.h"
+#include "wifiparams.h"
+#include <memory>
+
+// Parameters p0..p(n-1) with values v0..v(n-1), plus an HTML-only one without id
+struct ParamSet {
+    std::vector<std::unique_ptr<WiFiManagerParameter>> owned;
+    std::vector<WiFiManagerParameter*> list;
+
+    explicit ParamSet(int n, int length = 40) {
+        owned.emplace_back(new WiFiManagerParameter("<hr>"));
+        for (int i = 0; i < n; i++) {
+            std::string id = "p" + std::to_string(i);
+            std::string value = "v" + std::to_string(i);
+            owned.emplace_back(new WiFiManagerParameter(strdup(id.c_str()), "", value.c_str(), length));
+        }
+        for (auto& p : owned) {
+            list.push_back(p.get());
+        }
+    }
+    ~ParamSet() {
+        for (auto& p : owned) {
+            free((void*)p->getID());
+        }
+    }
+    WiFiManagerParameter** data() { return list.data(); }
+    int size() { return (int)list.size(); }
+};
+
+static void testRoundTrip() {
+    host::reset();
+    ParamSet params(3, 400);
+    std::string longValue(300, 'x');
+    params.list[2]->setValue(longValue.c_str(), 400);
+    params.list[3]->setValue("", 400);
+    {
+        WiFiParameterStore store;
+        CHECK(store.save(params.data(), params.size()));
+        CHECK_EQ(host::nvsWrites, 1u);
+    }
+
+    WiFiParameterStore loaded;
+    CHECK_EQ(loaded.size(), host::nvs["wm"]["params"].size());
+    CHECK_EQ(std::string(loaded.find("p0")), std::string("v0"));
+    // Values of 256 bytes and more use both length bytes
+    CHECK_EQ(std::string(loaded.find("p1")), longValue);
+    CHECK_EQ(std::string(loaded.find("p2")), std::string(""));
+    CHECK(loaded.find("p") == NULL);
+    CHECK(loaded.find("p00") == NULL);
+    CHECK(loaded.find(NULL) == NULL);
+
+    // Values are read in place: the same pointer every time, and no copies
+    host::resetAllocs();
+    const char* first = loaded.find("p1");
+    CHECK(loaded.find("p1") == first);
+    CHECK_EQ(host::allocs().count, (size_t)0);
+
+    // Saving the same values again does not touch NVS
+    CHECK(!loaded.save(params.data(), params.size()));
+    CHECK_EQ(host::nvsWrites, 1u);
+    CHECK(loaded.find("p1") == first);
+
+    params.list[1]->setValue("changed", 400);
+    CHECK(loaded.save(params.data(), params.size()));
+    CHECK_EQ(host::nvsWrites, 2u);
+    CHECK_EQ(std::string(loaded.find("p0")), std::string("changed"));
+}
+
+static bool loads(const std::vector<uint8_t>& blob) {
+    host::nvs["wm"]["params"] = blob;
+    WiFiParameterStore store;
+    return store.find("p0") != NULL;
+}
+
+static void testDamagedBlobsAreRejected() {
+    host::reset();
+    ParamSet params(4);
+    WiFiParameterStore store;
+    store.save(params.data(), params.size());
+    const std::vector<uint8_t> good = host::nvs["wm"]["params"];
+    const size_t header = 8;
+    CHECK(loads(good));
+
+    std::vector<uint8_t> blob = good;
+    blob.back() ^= 0x01;
+    CHECK(!loads(blob));            // CRC
+
+    blob = good;
+    blob[0]++;
+    CHECK(!loads(blob));            // version
+
+    blob = good;
+    blob.pop_back();
+    CHECK(!loads(blob));            // truncated
+    CHECK(!loads(std::vector<uint8_t>(good.begin(), good.begin() + header - 1)));
+
+    blob = good;
+    blob.push_back(0);
+    CHECK(!loads(blob));            // trailing byte
+
+    // The count and the entry lengths are checked even when the CRC matches
+    blob = good;
+    blob[1]++;
+    CHECK(!loads(blob));
+    blob = good;
+    blob[1]--;
+    CHECK(!loads(blob));
+
+    CHECK(!loads(std::vector<uint8_t>()));
+    CHECK(loads(good));
+
+    // clear() removes the blob
+    store.clear();
+    CHECK(host::nvs["wm"].count("params") == 0);
+    CHECK(store.find("p0") == NULL);
+}
+
+static void testManagerUsesStoredValues() {
+    host::reset();
+    {
+        ParamSet params(2);
+        params.list[1]->setValue("broker.local", 40);
+        params.list[2]->setValue("123456", 40);
+        WiFiParameterStore store;
+        store.save(params.data(), params.size());
+    }
+    SimpleWiFiManager wm;
+    WiFiManagerParameter server("p0", "server", "default", 40);
+    WiFiManagerParameter tooLong("p1", "port", "1883", 4);
+    wm.addParameter(&server);
+    wm.addParameter(&tooLong);
+    wm.setPersistParameters(true);
+    CHECK_EQ(std::string(server.getValue()), std::string("broker.local"));
+    CHECK(server._stored != NULL);
+    // A stored value longer than the field is ignored
+    CHECK_EQ(std::string(tooLong.getValue()), std::string("1883"));
+}
+
+static void benchLoad() {
+    const int sizes[] = { 10, 50 };
+    for (int n : sizes) {
+        host::reset();
+        ParamSet params(n);
+        {
+            WiFiParameterStore store;
+            store.save(params.data(), params.size());
+        }
+        host::resetAllocs();
+        {
+            WiFiParameterStore store;
+            for (int i = 0; i < n; i++) {
+                store.find(params.list[i + 1]->getID());
+            }
+        }
+        size_t allocs = host::allocs().count;
+        CHECK_EQ(allocs, (size_t)1);
+        if (!benchEnabled()) {
+            continue;
+        }
+        double us = benchMicros(20000, [&]() {
+            WiFiParameterStore store;
+            for (int i = 0; i < n; i++) {
+                store.find(params.list[i + 1]->getID());
+            }
+        });
+        printf("    %2d params: load and look up all %.2f us, %zu allocation\n", n, us, allocs);
+    }
+}
+
+int main() {
+    RUN(testRoundTrip);
+    RUN(testDamagedBlobsAreRejected);
+    RUN(testManagerUsesStoredValues);
+    RUN(benchLoad);
+    return testReport("test_params");
+}
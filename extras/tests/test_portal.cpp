@@ -0,0 +1,188 @@
+// Non-blocking portal: process() slices and the connection attempt (user-001)
+
+#include "portal.h"
+#include "webui_assets.h"
+
+static double elapsedMs(SimpleWiFiManager& wm) {
+    auto start = std::chrono::steady_clock::now();
+    wm.process();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void testProcessBudget() {
+    host::reset();
+    SimpleWiFiManager wm;
+    CHECK(wm.startConfigPortalAsync("budget-ap"));
+    CHECK(wm.isConfigPortalActive());
+
+    // Without a budget a slice is a single pass
+    wm.setProcessBudget(0);
+    double single = elapsedMs(wm);
+    CHECK(single < 20);
+
+    // With one it keeps serving until the budget is used, and not much longer
+    wm.setProcessBudget(30);
+    double sliced = elapsedMs(wm);
+    CHECK(sliced >= 29);
+    CHECK(sliced < 80);
+    printf("    idle slice: %.3f ms, 30 ms budget: %.3f ms\n", single, sliced);
+
+    wm.stopConfigPortal();
+    CHECK(!wm.isConfigPortalActive());
+    CHECK(!wm.process());
+}
+
+static void testConnectDoesNotBlock() {
+    host::reset();
+    SimpleWiFiManager wm;
+    CHECK(wm.startConfigPortalAsync("connect-ap"));
+
+    std::string saved = fetch(wm, httpGet("/wifisave?s=HomeNet&p=secret123"));
+    CHECK_CONTAINS(saved, "HTTP/1.1 200");
+    CHECK_CONTAINS(dechunk(saved), "Connecting...");
+
+    // The attempt starts on a later slice and nothing waits for the driver
+    unsigned begins = host::wifi.begins;
+    for (int i = 0; i < 5; i++) {
+        CHECK(elapsedMs(wm) < 20);
+    }
+    CHECK_EQ(host::wifi.begins, begins + 1);
+    CHECK_EQ(host::configSSID(host::wifi.running), std::string("HomeNet"));
+    // Tried from RAM: the stored config stays until the attempt succeeded
+    CHECK(host::configSSID(host::wifi.flash) != "HomeNet");
+
+    std::string status = dechunk(fetch(wm, httpGet("/api/status")));
+    CHECK_CONTAINS(status, "\"state\":\"connecting\"");
+    CHECK_CONTAINS(status, "\"result\":-1");
+
+    host::fireEvent(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    CHECK(wm.process());
+    CHECK_EQ(wm.getLastConnectResult(), WM_CONNECT_OK);
+    CHECK_EQ(host::configSSID(host::wifi.flash), std::string("HomeNet"));
+    CHECK_EQ(wm.getNetworkCount(), 1);
+
+    status = dechunk(fetch(wm, httpGet("/api/status")));
+    CHECK_CONTAINS(status, "\"state\":\"connected\"");
+    CHECK_CONTAINS(status, "\"ip\":\"192.168.1.50\"");
+
+    // The page gets WM_PORTAL_LINGER to show the result, then the portal closes
+    host::advance(WM_PORTAL_LINGER);
+    CHECK(!wm.process());
+    CHECK(!wm.isConfigPortalActive());
+}
+
+static void testTimeoutIsPolled() {
+    host::reset();
+    SimpleWiFiManager wm;
+    wm.setConnectTimeout(10);
+    CHECK(wm.startConfigPortalAsync("timeout-ap"));
+    fetch(wm, httpGet("/wifisave?s=Unreachable&p=secret123"));
+    wm.process();
+    wm.process();
+
+    host::advance(9000);
+    CHECK(wm.process());
+    CHECK_EQ(wm.getLastConnectResult(), WM_CONNECT_SKIPPED);
+
+    host::advance(2000);
+    CHECK(wm.process());
+    CHECK_EQ(wm.getLastConnectResult(), WM_CONNECT_TIMEOUT);
+    // Back to serving, the old config untouched and nothing remembered
+    CHECK(host::configSSID(host::wifi.flash) != "Unreachable");
+    CHECK_EQ(wm.getNetworkCount(), 0);
+    CHECK_CONTAINS(dechunk(fetch(wm, httpGet("/api/status"))), "\"state\":\"serving\"");
+}
+
+static void testPortalTimeoutDuringScan() {
+    host::reset();
+    host::addAP("Home", -50);
+    host::wifi.holdScan = true;
+    SimpleWiFiManager wm;
+    wm.setConfigPortalTimeout(30);
+    CHECK(wm.startConfigPortalAsync("scan-ap"));
+    CHECK(SimpleWiFiManagerTest::scanCache(wm).isScanning());
+
+    // The scan never finishes while held, so waiting for it would never return
+    host::advance(31000);
+    CHECK(elapsedMs(wm) < 20);
+    CHECK(!wm.isConfigPortalActive());
+
+    // The next portal takes the scan over and gets its results
+    CHECK(wm.startConfigPortalAsync("scan-ap"));
+    CHECK(SimpleWiFiManagerTest::scanCache(wm).isScanning());
+    host::wifi.holdScan = false;
+    wm.process();
+    CHECK_EQ(SimpleWiFiManagerTest::scanCache(wm).count(), 1);
+    wm.stopConfigPortal();
+}
+
+static void testResetIsScheduled() {
+    host::reset();
+    SimpleWiFiManager wm;
+    CHECK(wm.startConfigPortalAsync("reset-ap"));
+
+    // The page goes out at once and the portal keeps serving until the delay is up
+    unsigned long start = millis();
+    std::string page = fetch(wm, httpGet("/r"));
+    // delay() moves the host clock, so a sleep in the handler would show here
+    CHECK(millis() - start < 100);
+    CHECK_CONTAINS(dechunk(page), "Module will reset");
+    CHECK_CONTAINS(dechunk(fetch(wm, httpGet("/api/status"))), "\"state\":\"restarting\"");
+    CHECK(!host::restarted);
+
+    host::advance(WM_RESET_DELAY);
+    CHECK(!wm.process());
+    CHECK(host::restarted);
+    CHECK(!wm.isConfigPortalActive());
+}
+
+// process() is the only caller of the delayed write, so a pending change
+// must not depend on it
+static void testSettingsAreFlushed() {
+    host::reset();
+    {
+        SimpleWiFiManager wm;
+        wm.setWebUITitle("Kitchen");
+    }
+    CHECK_EQ(host::nvs["webui"].count("settings"), (size_t)1);
+
+    host::reset();
+    SimpleWiFiManager wm;
+    wm.setWebUITitle("Garage");
+    wm.resetSettings();
+    CHECK_EQ(host::nvs["webui"].count("settings"), (size_t)1);
+    CHECK_EQ(wm.getSettingsWriteCount(), 1u);
+
+    // A reset from the portal restarts through stopConfigPortal()
+    CHECK(wm.startConfigPortalAsync("reset-ap"));
+    wm.setWebUITitle("Shed");
+    fetch(wm, httpGet("/r"));
+    host::advance(WM_RESET_DELAY);
+    wm.process();
+    CHECK(host::restarted);
+    CHECK_EQ(wm.getSettingsWriteCount(), 2u);
+}
+
+// The page polling /api/status has a message for every result it can get
+static void testStatusMessagesCoverEveryResult() {
+    std::string script = WM_ASSET_SCRIPT;
+    size_t start = script.find("var m=[");
+    size_t end = script.find("]", start);
+    CHECK(start != std::string::npos && end != std::string::npos);
+    int entries = 1;
+    for (size_t i = start; i < end; i++) {
+        entries += (script[i] == ',');
+    }
+    CHECK_EQ(entries, (int)WM_CONNECT_SKIPPED + 1);
+}
+
+int main() {
+    RUN(testProcessBudget);
+    RUN(testConnectDoesNotBlock);
+    RUN(testTimeoutIsPolled);
+    RUN(testPortalTimeoutDuringScan);
+    RUN(testResetIsScheduled);
+    RUN(testSettingsAreFlushed);
+    RUN(testStatusMessagesCoverEveryResult);
+    return testReport("test_portal");
+}
@@ -0,0 +1,171 @@
+// Pooled portal clients against the core's one-client handleClient() (user-021)
+
+#include "portal.h"
+#include <algorithm>
+#include <deque>
+#include <sys/socket.h>
+
+static PortalServer* startPortal(SimpleWiFiManager& wm) {
+    host::reset();
+    CHECK(wm.startConfigPortalAsync("pool-ap"));
+    return SimpleWiFiManagerTest::server(wm);
+}
+
+static void testSlowClientDoesNotHoldOthers() {
+    SimpleWiFiManager wm;
+    PortalServer* server = startPortal(wm);
+
+    std::string request = httpGet("/");
+    int slow = host::connect();
+    host::send(slow, request.substr(0, 20));
+    int fast = host::connect();
+    host::send(fast, request);
+
+    wm.process();
+    CHECK_CONTAINS(host::receive(fast), "HTTP/1.1 200");
+    CHECK_EQ(host::receive(slow), std::string());
+    CHECK_EQ(server->openClients(), (uint8_t)1);
+
+    // The rest arrives and the slow client is served on the next slice
+    host::send(slow, request.substr(20));
+    wm.process();
+    CHECK_CONTAINS(host::receive(slow), "HTTP/1.1 200");
+    close(slow);
+    close(fast);
+}
+
+static void testContentLengthBeyondTheWindow() {
+    SimpleWiFiManager wm;
+    PortalServer* server = startPortal(wm);
+
+    // strtol() saturates; adding the head length to it must not overflow
+    const char* const lengths[] = { "99999999999999999999", "2147483647", "-1" };
+    for (const char* length : lengths) {
+        int fd = host::connect();
+        host::send(fd, std::string("POST /wifisave HTTP/1.1\r\nHost: 192.168.4.1\r\nContent-Length: ") +
+                       length + "\r\n\r\ns=a");
+        wm.process();
+        CHECK_EQ(host::receive(fd), std::string());
+        CHECK_EQ(server->openClients(), (uint8_t)1);
+
+        // Never complete, so it gets the core's data wait and is dropped
+        host::advance(HTTP_MAX_DATA_WAIT + 1);
+        wm.process();
+        CHECK_EQ(server->openClients(), (uint8_t)0);
+        close(fd);
+    }
+}
+
+// Load model: for LOAD_TIME ms every client fetches the portal page over and
+// over. One in four is a slow phone whose request arrives in two halves
+// SLOW_GAP ms apart. Each loop pass advances the clock by one ms, so the
+// figures mostly show how the two servers schedule clients; the handlers' CPU
+// time only adds its wall-clock share.
+#define LOAD_CLIENTS   8
+#define LOAD_TIME      5000
+#define SLOW_GAP       200
+
+struct LoadClient {
+    int           fd = -1;
+    unsigned long start = 0;
+    bool          sent = false;
+};
+
+struct LoadResult {
+    double        requestsPerSecond;
+    unsigned long p50;
+    unsigned long p99;
+};
+
+// pooled: wm.process() and its PortalServer. Otherwise the core's path: one
+// client at a time, held until its request has arrived, then parsed and served
+// by the same handlers through WebServer::handleClient().
+static LoadResult runLoad(bool pooled) {
+    SimpleWiFiManager wm;
+    PortalServer* server = startPortal(wm);
+    std::string request = httpGet("/");
+    size_t half = request.size() / 2;
+
+    LoadClient clients[LOAD_CLIENTS];
+    std::deque<int> accepted;    // connection order, as the core sees them
+    std::vector<unsigned long> latencies;
+    unsigned long begin = millis();
+    char buf[4096];
+
+    while (millis() - begin < LOAD_TIME) {
+        unsigned long now = millis();
+        for (int i = 0; i < LOAD_CLIENTS; i++) {
+            LoadClient& c = clients[i];
+            bool slow = (i % 4) == 0;
+            if (c.fd < 0) {
+                c.fd = host::connect();
+                c.start = now;
+                c.sent = !slow;
+                host::send(c.fd, slow ? request.substr(0, half) : request);
+                if (!pooled) {
+                    accepted.push_back(i);
+                }
+            } else if (c.fd >= 0 && !c.sent && now - c.start >= SLOW_GAP) {
+                host::send(c.fd, request.substr(half));
+                c.sent = true;
+            }
+        }
+
+        if (pooled) {
+            wm.process();
+        } else if (!accepted.empty() && clients[accepted.front()].sent) {
+            server->WebServer::handleClient();
+            accepted.pop_front();
+        }
+
+        for (LoadClient& c : clients) {
+            if (c.fd < 0) {
+                continue;
+            }
+            ssize_t n;
+            while ((n = recv(c.fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            }
+            if (n == 0) {
+                latencies.push_back(millis() - c.start + 1);
+                close(c.fd);
+                c.fd = -1;
+            }
+        }
+        host::advance(1);
+    }
+    for (LoadClient& c : clients) {
+        if (c.fd >= 0) {
+            close(c.fd);
+        }
+    }
+
+    LoadResult result;
+    std::sort(latencies.begin(), latencies.end());
+    result.p50 = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+    result.p99 = latencies.empty() ? 0 : latencies[(latencies.size() * 99 + 99) / 100 - 1];
+    result.requestsPerSecond = latencies.size() * 1000.0 / (millis() - begin);
+    return result;
+}
+
+static void testLoad() {
+    LoadResult core = runLoad(false);
+    LoadResult pool = runLoad(true);
+    CHECK(pool.p99 < core.p99);
+    CHECK(pool.requestsPerSecond > core.requestsPerSecond);
+
+    if (benchEnabled()) {
+        printf("    %d clients for %d ms, %d of them slow (%d ms gap):\n",
+               LOAD_CLIENTS, LOAD_TIME, LOAD_CLIENTS / 4, SLOW_GAP);
+        printf("    core handleClient: %7.1f req/s  p50 %4lu ms  p99 %4lu ms\n",
+               core.requestsPerSecond, core.p50, core.p99);
+        printf("    PortalServer pool: %7.1f req/s  p50 %4lu ms  p99 %4lu ms\n",
+               pool.requestsPerSecond, pool.p50, pool.p99);
+    }
+}
+
+int main() {
+    RUN(testSlowClientDoesNotHoldOthers);
+    RUN(testContentLengthBeyondTheWindow);
+    RUN(testLoad);
+    return testReport("test_portalserver");
+}
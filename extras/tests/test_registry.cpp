@@ -0,0 +1,171 @@
+// Growing parameter registry, value arena and the two save endpoints (user-014)
+
+#include "portal.h"
+#include <memory>
+
+// Parameters that keep their ids alive for as long as the test needs them
+struct Params {
+    std::vector<std::string> ids;
+    std::vector<std::unique_ptr<WiFiManagerParameter>> list;
+
+    Params(int n, int length = 16) : ids(n) {
+        for (int i = 0; i < n; i++) {
+            ids[i] = "p" + std::to_string(i);
+            list.emplace_back(new WiFiManagerParameter(ids[i].c_str(), "label", ("v" + std::to_string(i)).c_str(), length));
+        }
+    }
+    void addTo(SimpleWiFiManager& wm) {
+        for (auto& p : list) {
+            CHECK(wm.addParameter(p.get()));
+        }
+    }
+};
+
+static int countIds(const std::string& json) {
+    int n = 0;
+    for (size_t p = 0; (p = json.find("{\"id\":", p)) != std::string::npos; p++) {
+        n++;
+    }
+    return n;
+}
+
+static void testGrowsPastTheInitialCapacity() {
+    host::reset();
+    Params params(64);
+    SimpleWiFiManager wm;
+    WiFiManagerParameter html("<hr>");
+    wm.addParameter(&html);
+    params.addTo(wm);
+
+    // Values moved into the manager's arena, the parameters' own buffers are gone
+    for (int i = 0; i < 64; i++) {
+        CHECK(!params.list[i]->_owned);
+        CHECK_EQ(std::string(params.list[i]->getValue()), "v" + std::to_string(i));
+    }
+    CHECK(wm.startConfigPortalAsync("registry-ap"));
+    std::string json = dechunk(fetch(wm, httpGet("/api/params")));
+    CHECK_EQ(countIds(json), 64);
+    CHECK_CONTAINS(json, "{\"id\":\"p63\",\"label\":\"label\",\"value\":\"v63\",\"length\":16}");
+}
+
+static void testLargeValuesGetTheirOwnBlock() {
+    host::reset();
+    SimpleWiFiManager wm;
+    WiFiManagerParameter small("small", "", "s", 8);
+    WiFiManagerParameter large("large", "", "L", WM_PARAM_ARENA_BLOCK * 2);
+    WiFiManagerParameter after("after", "", "a", 8);
+    wm.addParameter(&small);
+    wm.addParameter(&large);
+    wm.addParameter(&after);
+    CHECK_EQ(std::string(small.getValue()), std::string("s"));
+    CHECK_EQ(std::string(large.getValue()), std::string("L"));
+    CHECK_EQ(std::string(after.getValue()), std::string("a"));
+    // The whole field is writable
+    memset(large._value, 'x', WM_PARAM_ARENA_BLOCK * 2);
+    CHECK_EQ(strlen(large.getValue()), (size_t)WM_PARAM_ARENA_BLOCK * 2);
+    CHECK_EQ(std::string(after.getValue()), std::string("a"));
+}
+
+// Neighbours in the arena survive whatever setValue() is given
+static void testSetValueStaysInItsField() {
+    host::reset();
+    SimpleWiFiManager wm;
+    WiFiManagerParameter first("first", "", "one", 8);
+    WiFiManagerParameter second("second", "", "two", 8);
+    WiFiManagerParameter html("<hr>");
+    wm.addParameter(&first);
+    wm.addParameter(&second);
+
+    // Not a format string
+    first.setValue("%s%s%n%x", 9);
+    CHECK_EQ(std::string(first.getValue()), std::string("%s%s%n%x"));
+    // A length beyond the field is cut to it
+    first.setValue(std::string(100, 'y').c_str(), 100);
+    CHECK_EQ(std::string(first.getValue()), std::string(8, 'y'));
+    CHECK_EQ(std::string(second.getValue()), std::string("two"));
+    // The caller's smaller length still applies
+    second.setValue("abcdef", 4);
+    CHECK_EQ(std::string(second.getValue()), std::string("abc"));
+    // Nothing to write for an HTML-only parameter or an empty length
+    html.setValue("x", 8);
+    CHECK(html.getValue() == NULL);
+    second.setValue("z", 0);
+    CHECK_EQ(std::string(second.getValue()), std::string("abc"));
+}
+
+// Either may be destroyed first; ASan and LSan report any mistake
+static void testDestructionOrder() {
+    host::reset();
+    {
+        std::unique_ptr<SimpleWiFiManager> wm(new SimpleWiFiManager());
+        Params params(12);
+        params.addTo(*wm);
+        wm.reset();
+    }
+    {
+        Params params(12);
+        std::unique_ptr<SimpleWiFiManager> wm(new SimpleWiFiManager());
+        params.addTo(*wm);
+        params.list.clear();
+        wm.reset();
+    }
+    // A parameter never added keeps and frees its own buffer
+    WiFiManagerParameter alone("alone", "", "value", 8);
+    CHECK(alone._owned);
+}
+
+static void testSaveEndpoints() {
+    host::reset();
+    Params params(3);
+    SimpleWiFiManager wm;
+    params.addTo(wm);
+    CHECK(wm.startConfigPortalAsync("registry-ap"));
+
+    // /api/save updates only the ids sent
+    std::string reply = dechunk(fetch(wm, httpPost("/api/save", "p1=one&unknown=x")));
+    CHECK_EQ(reply, std::string("{\"ok\":true,\"connecting\":false}"));
+    CHECK_EQ(std::string(params.list[0]->getValue()), std::string("v0"));
+    CHECK_EQ(std::string(params.list[1]->getValue()), std::string("one"));
+    CHECK_EQ(std::string(params.list[2]->getValue()), std::string("v2"));
+
+    // Values are cut to the field length
+    fetch(wm, httpPost("/api/save", "p2=" + std::string(40, 'z')));
+    CHECK_EQ(std::string(params.list[2]->getValue()), std::string(15, 'z'));
+
+    // The form sends every field, so one missing from /wifisave was cleared
+    fetch(wm, httpGet("/wifisave?s=&p0=zero"));
+    CHECK_EQ(std::string(params.list[0]->getValue()), std::string("zero"));
+    CHECK_EQ(std::string(params.list[1]->getValue()), std::string(""));
+    CHECK_EQ(std::string(params.list[2]->getValue()), std::string(""));
+}
+
+static void benchSave() {
+    host::reset();
+    Params params(64, 32);
+    SimpleWiFiManager wm;
+    params.addTo(wm);
+    CHECK(wm.startConfigPortalAsync("registry-ap"));
+    SimpleWiFiManagerTest::server(wm)->recording = false;
+
+    std::string body;
+    for (int i = 0; i < 64; i++) {
+        body += (i ? "&p" : "p") + std::to_string(i) + "=value" + std::to_string(i);
+    }
+    fetch(wm, httpPost("/api/save", body));
+    CHECK_EQ(std::string(params.list[63]->getValue()), std::string("value63"));
+    if (!benchEnabled()) {
+        return;
+    }
+    double us = benchMicros(500, [&]() { fetch(wm, httpPost("/api/save", body)); });
+    printf("    64 params: /api/save request %.1f us, including the host HTTP parse\n", us);
+}
+
+int main() {
+    RUN(testGrowsPastTheInitialCapacity);
+    RUN(testLargeValuesGetTheirOwnBlock);
+    RUN(testSetValueStaysInItsField);
+    RUN(testDestructionOrder);
+    RUN(testSaveEndpoints);
+    RUN(benchSave);
+    return testReport("test_registry");
+}
@@ -0,0 +1,175 @@
+// WiFiScanCache snapshot, duplicate flags and the /scan.json filters (user-006)
+
+#include "portal.h"
+
+static void testSnapshotIsSortedStrongestFirst() {
+    host::reset();
+    const int8_t levels[] = { -80, -45, -91, -60, -45, -72 };
+    for (size_t i = 0; i < sizeof(levels); i++) {
+        host::addAP(("Net" + std::to_string(i)).c_str(), levels[i], 1 + i);
+    }
+    WiFiScanCache cache;
+    CHECK(cache.scanNow());
+    CHECK(cache.hasResults());
+    CHECK_EQ(cache.count(), (int)sizeof(levels));
+    for (int i = 1; i < cache.count(); i++) {
+        CHECK(cache.get(i - 1).rssi >= cache.get(i).rssi);
+    }
+    // Everything else is copied with the record
+    const ScanRecord& weakest = cache.get(cache.count() - 1);
+    CHECK_EQ(std::string(weakest.ssid), std::string("Net2"));
+    CHECK_EQ(weakest.channel, (uint8_t)3);
+    CHECK_EQ(weakest.bssid[5], (uint8_t)2);
+    CHECK_EQ(weakest.auth, (uint8_t)WIFI_AUTH_WPA2_PSK);
+}
+
+static void testDuplicatesAndFind() {
+    host::reset();
+    host::addAP("Home", -70);
+    host::addAP("Office", -65);
+    host::addAP("Home", -50);
+    host::addAP("Home", -60);
+    host::addAP(std::string(32, 'x').c_str(), -55);
+    WiFiScanCache cache;
+    CHECK(cache.scanNow());
+
+    int home = cache.find("Home");
+    CHECK_EQ(home, 0);
+    CHECK_EQ(cache.get(home).rssi, (int8_t)-50);
+    CHECK(!cache.get(home).duplicate);
+    int duplicates = 0;
+    for (int i = 0; i < cache.count(); i++) {
+        duplicates += cache.get(i).duplicate ? 1 : 0;
+    }
+    CHECK_EQ(duplicates, 2);
+    CHECK(!cache.get(cache.find("Office")).duplicate);
+    // A 32 byte SSID has no terminator in the driver record
+    CHECK_EQ(cache.find(std::string(32, 'x').c_str()), 1);
+    CHECK_EQ(cache.find("Missing"), -1);
+}
+
+static void testMaxRecordsKeepsTheStrongest() {
+    host::reset();
+    for (int i = 0; i < 10; i++) {
+        // Interleaved so the strong ones arrive after the table is full
+        host::addAP(("Net" + std::to_string(i)).c_str(), (i % 2) ? -40 - i : -90 + i);
+    }
+    WiFiScanCache cache;
+    cache.setMaxRecords(3);
+    CHECK(cache.scanNow());
+    CHECK_EQ(cache.count(), 3);
+    CHECK_EQ(cache.get(0).rssi, (int8_t)-41);
+    CHECK_EQ(cache.get(1).rssi, (int8_t)-43);
+    CHECK_EQ(cache.get(2).rssi, (int8_t)-45);
+
+    cache.setMaxRecords(0);
+    CHECK(cache.scanNow());
+    CHECK_EQ(cache.count(), 10);
+}
+
+static void testAsyncRefresh() {
+    host::reset();
+    host::addAP("Home", -50);
+    host::wifi.holdScan = true;
+    WiFiScanCache cache;
+    cache.setTTL(60000);
+    cache.begin();
+    CHECK(cache.isScanning());
+    cache.loop();
+    CHECK(cache.isScanning());
+    CHECK(!cache.hasResults());
+
+    host::wifi.holdScan = false;
+    cache.loop();
+    CHECK(!cache.isScanning());
+    CHECK_EQ(cache.count(), 1);
+
+    // A refresh request waits until the snapshot is WM_SCAN_MIN_INTERVAL old
+    cache.requestRefresh();
+    cache.loop();
+    CHECK(!cache.isScanning());
+    host::advance(WM_SCAN_MIN_INTERVAL);
+    cache.loop(false);
+    CHECK(!cache.isScanning());
+    cache.loop();
+    CHECK(cache.isScanning());
+    cache.loop();
+    CHECK(!cache.isScanning());
+
+    // Without a request the snapshot lasts the TTL
+    host::advance(59000);
+    cache.loop();
+    CHECK(!cache.isScanning());
+    host::advance(1000);
+    cache.loop();
+    CHECK(cache.isScanning());
+    cache.end();
+    CHECK(!cache.hasResults());
+}
+
+static int countAPs(const std::string& json) {
+    int n = 0;
+    for (size_t p = 0; (p = json.find("\"ssid\"", p)) != std::string::npos; p++) {
+        n++;
+    }
+    return n;
+}
+
+static void testScanJsonFilters() {
+    host::reset();
+    host::addAP("Strong", -40);     // quality 100
+    host::addAP("Strong", -60);     // 80, duplicate
+    host::addAP("Edge", -80);       // 40
+    host::addAP("Weak", -90);       // 20
+    host::addAP("Quote\"d", -70);   // 60
+    SimpleWiFiManager wm;
+    CHECK(wm.startConfigPortalAsync("scan-ap"));
+    wm.process();
+
+    std::string json = dechunk(fetch(wm, httpGet("/scan.json")));
+    CHECK_CONTAINS(json, "{\"scanning\":false,\"aps\":[{\"ssid\":\"Strong\",\"rssi\":-40,\"q\":100,\"auth\":3,\"ch\":6}");
+    CHECK_CONTAINS(json, "\"ssid\":\"Quote\\\"d\"");
+    CHECK_EQ(countAPs(json), 4);
+
+    wm.setRemoveDuplicateAPs(false);
+    CHECK_EQ(countAPs(dechunk(fetch(wm, httpGet("/scan.json")))), 5);
+
+    // Networks need a quality above the minimum, equal is not enough
+    wm.setRemoveDuplicateAPs(true);
+    wm.setMinimumSignalQuality(40);
+    json = dechunk(fetch(wm, httpGet("/scan.json")));
+    CHECK_EQ(countAPs(json), 2);
+    CHECK(json.find("Edge") == std::string::npos);
+    wm.setMinimumSignalQuality(39);
+    CHECK_CONTAINS(dechunk(fetch(wm, httpGet("/scan.json"))), "Edge");
+}
+
+static void benchScan() {
+    if (!benchEnabled()) {
+        return;
+    }
+    const int sizes[] = { 50, 200, 1000 };
+    for (int n : sizes) {
+        host::reset();
+        for (int i = 0; i < n; i++) {
+            // Half the names repeat, as with mesh and multi-band access points
+            host::addAP(("Net-" + std::to_string(i % (n / 2))).c_str(), -30 - (i * 37) % 65);
+        }
+        WiFiScanCache cache;
+        cache.scanNow();
+        host::resetAllocs();
+        double us = benchMicros(2000, [&]() { cache.scanNow(); });
+        printf("    %4d APs: copy, sort and flag %.1f us, %zu allocations per scan\n",
+               n, us, host::allocs().count / 2000);
+    }
+}
+
+int main() {
+    RUN(testSnapshotIsSortedStrongestFirst);
+    RUN(testDuplicatesAndFind);
+    RUN(testMaxRecordsKeepsTheStrongest);
+    RUN(testAsyncRefresh);
+    RUN(testScanJsonFilters);
+    RUN(benchScan);
+    return testReport("test_scan");
+}
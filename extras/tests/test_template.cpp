@@ -0,0 +1,126 @@
+// WebTemplate: slot compilation and rendering into a PageWriter (user-004)
+
+#include "portal.h"
+#include "webui.h"
+
+// Renders tpl with values into a fresh unrecorded server and returns the body
+static std::string render(WebTemplate& tpl, const char* const values[], uint32_t rawMask = 0) {
+    WebServer server;
+    {
+        PageWriter page(&server);
+        page.begin(200, "text/html");
+        tpl.render(page, values, rawMask);
+    }
+    return server.output.substr(server.output.find("\r\n\r\n") + 4);
+}
+
+static const char ITEM[] PROGMEM = "<a>{v}</a><span class='{i}'>{r}%</span>";
+
+static void testSlotsAreFilledInKeyOrder() {
+    WebTemplate tpl(ITEM, "vri");
+    const char* values[] = { "Home", "72", "l3" };
+    CHECK_EQ(render(tpl, values), std::string("<a>Home</a><span class='l3'>72%</span>"));
+    // Compiled once, the second render gives the same page
+    CHECK_EQ(render(tpl, values), std::string("<a>Home</a><span class='l3'>72%</span>"));
+}
+
+static void testEscapingAndRawMask() {
+    WebTemplate tpl(ITEM, "vri");
+    const char* values[] = { "<Cafe & \"Bar\">", "5'0", "x" };
+    CHECK_EQ(render(tpl, values),
+             std::string("<a>&lt;Cafe &amp; &quot;Bar&quot;&gt;</a><span class='x'>5&#39;0%</span>"));
+    // Bit 0 is the first key, v
+    CHECK_EQ(render(tpl, values, 1),
+             std::string("<a><Cafe & \"Bar\"></a><span class='x'>5&#39;0%</span>"));
+}
+
+static void testUnknownAndAdjacentSlots() {
+    static const char TPL[] PROGMEM = "{a}{b}{z}{a}{}{ab}";
+    WebTemplate tpl(TPL, "ab");
+    const char* values[] = { "1", "2" };
+    // {z} is not a key and {} / {ab} are not slots, all stay literal
+    CHECK_EQ(render(tpl, values), std::string("12{z}1{}{ab}"));
+
+    static const char EDGES[] PROGMEM = "{a";
+    WebTemplate open(EDGES, "a");
+    CHECK_EQ(render(open, values), std::string("{a"));
+
+    static const char EMPTY[] PROGMEM = "";
+    WebTemplate empty(EMPTY, "a");
+    CHECK_EQ(render(empty, values), std::string(""));
+}
+
+static void testSegmentOverflow() {
+    // Each slot after the first takes a literal and a slot segment. Once the
+    // table is full the rest of the template is written as it is.
+    std::string text;
+    for (int i = 0; i < WM_TEMPLATE_MAX_SEGMENTS; i++) {
+        text += "{a}-";
+    }
+    WebTemplate tpl(text.c_str(), "a");
+    const char* values[] = { "A" };
+    std::string out = render(tpl, values);
+
+    int filled = (WM_TEMPLATE_MAX_SEGMENTS - 2) / 2 + 1;
+    std::string expected;
+    for (int i = 0; i < WM_TEMPLATE_MAX_SEGMENTS; i++) {
+        expected += (i < filled) ? "A-" : "{a}-";
+    }
+    CHECK_EQ(out, expected);
+}
+
+static void testRenderDoesNotAllocate() {
+    WebTemplate tpl(WebUI::HTTP_ITEM, "vri");
+    const char* values[] = { "Warehouse <5GHz>", "64", "l2" };
+    WebServer server;
+    server.recording = false;
+    PageWriter page(&server);
+    page.begin(200, "text/html");
+    tpl.render(page, values);
+
+    host::resetAllocs();
+    for (int i = 0; i < 100; i++) {
+        tpl.render(page, values);
+    }
+    CHECK_EQ(host::allocs().count, (size_t)0);
+    page.end();
+}
+
+// What the pages did before: copy the template into a String and replace each slot
+static void renderWithReplace(PageWriter& page, const char* const values[]) {
+    String item = FPSTR(WebUI::HTTP_ITEM);
+    item.replace("{v}", values[0]);
+    item.replace("{r}", values[1]);
+    item.replace("{i}", values[2]);
+    page.write(item);
+}
+
+static void benchItemRow() {
+    WebTemplate tpl(WebUI::HTTP_ITEM, "vri");
+    const char* values[] = { "Warehouse-AP-17", "64", "l2" };
+    WebServer server;
+    server.recording = false;
+    PageWriter page(&server);
+    page.begin(200, "text/html");
+
+    host::resetAllocs();
+    renderWithReplace(page, values);
+    size_t replaceAllocs = host::allocs().count;
+    printf("    allocations per row: replace %zu, template 0\n", replaceAllocs);
+    if (!benchEnabled()) {
+        return;
+    }
+    double replaced = benchMicros(200000, [&]() { renderWithReplace(page, values); });
+    double rendered = benchMicros(200000, [&]() { tpl.render(page, values); });
+    printf("    per row: replace %.3f us, template %.3f us\n", replaced, rendered);
+}
+
+int main() {
+    RUN(testSlotsAreFilledInKeyOrder);
+    RUN(testEscapingAndRawMask);
+    RUN(testUnknownAndAdjacentSlots);
+    RUN(testSegmentOverflow);
+    RUN(testRenderDoesNotAllocate);
+    RUN(benchItemRow);
+    return testReport("test_template");
+}
@@ -1,13 +1,55 @@
 #include "SimpleWiFiManager.h"
+#include "wififeatures.h"
 #include <nvs_flash.h>
+#include <Preferences.h>
+#include <time.h>
+#include <algorithm>
+#include <ping/ping_sock.h>
 #include "webui.h"
 
+// Portal objects and render buffer, placed in one allocation in heap budget mode
+struct SimpleWiFiManager::PortalBlock {
+  alignas(PortalServer)     uint8_t server[sizeof(PortalServer)];
+  alignas(CaptiveDNSServer) uint8_t dns[sizeof(CaptiveDNSServer)];
+  alignas(WebUI)            uint8_t webUI[sizeof(WebUI)];
+  char                      render[WM_RENDER_BUFFER_SIZE];
+};
+
+// Holds the supervisor's portal lock for one scope; no-op without a supervisor
+class PortalLock {
+public:
+  explicit PortalLock(SemaphoreHandle_t lock) : _lock(lock) {
+    if (_lock != NULL) {
+      xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+    }
+  }
+  ~PortalLock() {
+    if (_lock != NULL) {
+      xSemaphoreGiveRecursive(_lock);
+    }
+  }
+
+private:
+  SemaphoreHandle_t _lock;
+};
+
+static WebTemplate headTemplate(WebUI::HTTP_HEAD_START, "v");
+#if WM_FEATURE_THEMES
+static WebTemplate themeToggleTemplate(WebUI::HTTP_THEME_TOGGLE, "c");
+#endif
+static WebTemplate itemTemplate(WebUI::HTTP_ITEM, "vri");
+#if WM_FEATURE_PARAMS
+static WebTemplate paramTemplate(WebUI::HTTP_FORM_PARAM, "inplvc");
+#endif
+
 // WiFiManagerParameter implementation (same as original)
 WiFiManagerParameter::WiFiManagerParameter(const char *custom) {
   _id = NULL;
   _placeholder = NULL;
   _length = 0;
   _value = NULL;
+  _stored = NULL;
+  _owned = false;
 
   _customHTML = custom;
 }
@@ -20,12 +62,21 @@ WiFiManagerParameter::WiFiManagerParameter(const char *id, const char *placehold
   init(id, placeholder, defaultValue, length, custom);
 }
 
+WiFiManagerParameter::~WiFiManagerParameter() {
+  if (_owned) {
+    delete[] _value;
+  }
+}
+
 void WiFiManagerParameter::init(const char *id, const char *placeholder, const char *defaultValue, int length, const char *custom) {
   _id = id;
   _placeholder = placeholder;
   _length = length;
+  _stored = NULL;
+  _owned = true;
   _value = new char[length + 1];
-  for (int i = 0; i < length; i++) {
+  // Including the terminator, which strncpy() leaves out for a full-length default
+  for (int i = 0; i < length + 1; i++) {
     _value[i] = 0;
   }
   if (defaultValue != NULL) {
@@ -36,7 +87,7 @@ void WiFiManagerParameter::init(const char *id, const char *placeholder, const c
 }
 
 const char* WiFiManagerParameter::getValue() {
-  return _value;
+  return (_stored != NULL) ? _stored : _value;
 }
 const char* WiFiManagerParameter::getID() {
   return _id;
@@ -52,26 +103,185 @@ const char* WiFiManagerParameter::getCustomHTML() {
 }
 
 void WiFiManagerParameter::setValue(const char *defaultValue, int length) {
-  snprintf(_value, length, defaultValue);
+  // The value may sit between others in the manager's arena: never past _length,
+  // and never read as a format string
+  if (_value == NULL || length <= 0) {
+    return;
+  }
+  _stored = NULL;
+  snprintf(_value, std::min(length, _length + 1), "%s", defaultValue);
 }
 
-SimpleWiFiManager::SimpleWiFiManager() {
+extern "C" const char WM_CONFIG_SYMBOL = 0;
+
+SimpleWiFiManager::SimpleWiFiManager(const char&) : _supervisorStatus(WM_SUPERVISOR_STOPPED) {
   _webUI = nullptr;
 }
 
 SimpleWiFiManager::~SimpleWiFiManager() {
-  if (_webUI != nullptr) {
-    delete _webUI;
-    _webUI = nullptr;
+  stopReconnectSupervisor();
+  _settings.flush();
+#if WM_FEATURE_PARAMS
+  // The parameters may already be gone, so they are not touched here. Their
+  // values live in the arena and _paramStore and go with the manager.
+  while (_paramArena != NULL) {
+    ParamArenaBlock* next = _paramArena->next;
+    free(_paramArena);
+    _paramArena = next;
+  }
+  free(_params);
+  free(_paramSlots);
+#endif
+  if (_connectEvents != NULL) {
+    WiFi.removeEvent(_eventHandlerId);
+    vEventGroupDelete(_connectEvents);
+    _connectEvents = NULL;
+  }
+  releasePortalObjects();
+  free(_portalBlock);
+  if (_portalLock != NULL) {
+    vSemaphoreDelete(_portalLock);
   }
 }
 
-void SimpleWiFiManager::addParameter(WiFiManagerParameter *p) {
+#if WM_FEATURE_PARAMS
+boolean SimpleWiFiManager::addParameter(WiFiManagerParameter *p) {
+  if (_paramsCount == _paramsCapacity) {
+#ifdef WIFI_MANAGER_FIXED_PARAMS
+    int capacity = (_paramsCapacity == 0) ? WIFI_MANAGER_MAX_PARAMS : 0;
+#else
+    int capacity = (_paramsCapacity == 0) ? WIFI_MANAGER_MAX_PARAMS : _paramsCapacity * 2;
+#endif
+    WiFiManagerParameter** params = NULL;
+    if (capacity > 0) {
+      params = (WiFiManagerParameter**)realloc(_params, capacity * sizeof(WiFiManagerParameter*));
+    }
+    if (params == NULL) {
+      WM_LOG_W("Parameter limit reached");
+      return false;
+    }
+    _params = params;
+    _paramsCapacity = capacity;
+  }
+
+  // Move the value into the arena and release the parameter's own buffer
+  if (p->getID() != NULL && p->_owned) {
+    char* value = paramArenaAlloc(p->_length + 1);
+    if (value == NULL) {
+      WM_LOG_E("Out of memory for parameter");
+      return false;
+    }
+    memcpy(value, p->_value, p->_length + 1);
+    delete[] p->_value;
+    p->_value = value;
+    p->_owned = false;
+  }
+
   _params[_paramsCount] = p;
   _paramsCount++;
-  DEBUG_WM("Adding parameter");
-  DEBUG_WM(p->getID());
+  _paramSlotsStale = true;
+  WM_LOG_I("Adding parameter", p->getID());
+  if (_persistParams) {
+    bindStoredParameters();
+  }
+  return true;
+}
+
+char* SimpleWiFiManager::paramArenaAlloc(size_t size) {
+  if (_paramArena == NULL || _paramArena->size - _paramArena->used < size) {
+    size_t blockSize = (size > WM_PARAM_ARENA_BLOCK) ? size : WM_PARAM_ARENA_BLOCK;
+    ParamArenaBlock* block = (ParamArenaBlock*)malloc(sizeof(ParamArenaBlock) + blockSize);
+    if (block == NULL) {
+      return NULL;
+    }
+    block->next = _paramArena;
+    block->size = blockSize;
+    block->used = 0;
+    _paramArena = block;
+  }
+  char* ptr = (char*)(_paramArena + 1) + _paramArena->used;
+  _paramArena->used += size;
+  return ptr;
+}
+
+static uint32_t hashParamId(const char* id) {
+  // FNV-1a
+  uint32_t hash = 2166136261UL;
+  while (*id) {
+    hash ^= (uint8_t)*id++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+boolean SimpleWiFiManager::buildParamSlots() {
+  int size = 8;
+  while (size < _paramsCount * 2) {
+    size <<= 1;
+  }
+  if (size - 1 != _paramSlotsMask || _paramSlots == NULL) {
+    int16_t* slots = (int16_t*)realloc(_paramSlots, size * sizeof(int16_t));
+    if (slots == NULL) {
+      WM_LOG_E("Out of memory for the parameter table");
+      return false;
+    }
+    _paramSlots = slots;
+    _paramSlotsMask = size - 1;
+  }
+  memset(_paramSlots, 0xFF, size * sizeof(int16_t));
+
+  for (int i = 0; i < _paramsCount; i++) {
+    if (_params[i]->getID() == NULL) {
+      continue;
+    }
+    uint32_t h = hashParamId(_params[i]->getID()) & _paramSlotsMask;
+    while (_paramSlots[h] >= 0) {
+      h = (h + 1) & _paramSlotsMask;
+    }
+    _paramSlots[h] = i;
+  }
+  _paramSlotsStale = false;
+  return true;
+}
+
+// Index of the parameter with this id, or -1. Call buildParamSlots() first.
+int SimpleWiFiManager::findParamSlot(const char* id) {
+  uint32_t h = hashParamId(id) & _paramSlotsMask;
+  while (_paramSlots[h] >= 0) {
+    if (strcmp(_params[_paramSlots[h]]->getID(), id) == 0) {
+      return _paramSlots[h];
+    }
+    h = (h + 1) & _paramSlotsMask;
+  }
+  return -1;
+}
+
+void SimpleWiFiManager::setPersistParameters(boolean enable) {
+  _persistParams = enable;
+  if (enable) {
+    bindStoredParameters();
+  }
+}
+
+// Points each parameter at its value in the stored blob; no copies are made
+void SimpleWiFiManager::bindStoredParameters() {
+  for (int i = 0; i < _paramsCount; i++) {
+    const char* stored = _paramStore.find(_params[i]->getID());
+    if (stored != NULL && (int)strlen(stored) <= _params[i]->_length) {
+      _params[i]->_stored = stored;
+    }
+  }
+}
+#else
+// Built with WM_FEATURE_PARAMS=0: the methods stay so sketches still build
+boolean SimpleWiFiManager::addParameter(WiFiManagerParameter *p) {
+  WM_LOG_W("Parameters are disabled, ignoring", p->getID());
+  return false;
+}
+
+void SimpleWiFiManager::setPersistParameters(boolean enable) {
 }
+#endif
 
 boolean SimpleWiFiManager::autoConnect() {
   String ssid = "ESP" + String(ESP.getEfuseMac());
@@ -79,18 +289,64 @@ boolean SimpleWiFiManager::autoConnect() {
 }
 
 boolean SimpleWiFiManager::autoConnect(char const *apName, char const *apPassword) {
-  DEBUG_WM(F(""));
-  DEBUG_WM(F("AutoConnect"));
+  WM_LOG_I("AutoConnect");
+
+  // Kept for portals raised later by the reconnect supervisor
+  _apName = apName;
+  _apPassword = (apPassword != NULL) ? apPassword : "";
+
+  unsigned long connectStart = millis();
+  wm_connect_result_t connRes = WM_CONNECT_SKIPPED;
+  wifi_config_t conf;
 
-  if (WiFi.SSID() != "") {
-    DEBUG_WM(F("Using last saved values, should be faster"));
+  _leaseApplied = applyCachedLease();
+  if (_fastReconnect) {
+    connRes = tryFastReconnect(&conf);
   }
+  _lastConnectFast = (connRes == WM_CONNECT_OK);
 
-  if (connectWifi("", "") == WL_CONNECTED) {
-    DEBUG_WM(F("IP Address:"));
-    DEBUG_WM(WiFi.localIP());
+  if (connRes != WM_CONNECT_SKIPPED && connRes != WM_CONNECT_OK) {
+    WM_LOG_I("Fast reconnect failed");
+    WiFi.disconnect();
+  }
+
+  if (connRes != WM_CONNECT_OK && _credentials.count() > 0) {
+    connRes = connectKnownNetworks();
+  } else if (connRes != WM_CONNECT_SKIPPED && connRes != WM_CONNECT_OK) {
+    // The cached AP did not answer, retry the stored network with a full scan
+    char ssid[33];
+    char pass[65];
+    memcpy(ssid, conf.sta.ssid, 32);
+    ssid[32] = 0;
+    memcpy(pass, conf.sta.password, 64);
+    pass[64] = 0;
+    connRes = connectWifi(ssid, pass);
+  } else if (connRes == WM_CONNECT_SKIPPED) {
+    connRes = connectWifi("", "");
+  }
+
+  if (connRes == WM_CONNECT_OK && _leaseApplied && !gatewayResponds()) {
+    // The cached address is not usable on this network any more
+    WM_LOG_I("Cached lease rejected, falling back to DHCP");
+    WiFi.disconnect();
+    dropCachedLease();
+    connRes = connectWifi("", "");
+  }
+  if (connRes != WM_CONNECT_OK && _leaseApplied) {
+    dropCachedLease();
+  }
+
+  if (connRes == WM_CONNECT_OK) {
+    _lastConnectTime = millis() - connectStart;
+    rememberNetwork();
+    saveFastConnectInfo();
+    saveLeaseInfo();
+    _scanCache.end();
+    WM_LOG_I("IP Address:", WiFi.localIP());
+    WiFiManagerLog::poll();
     return true;
   }
+  WiFiManagerLog::poll();
 
   return startConfigPortal(apName, apPassword);
 }
@@ -98,8 +354,9 @@ boolean SimpleWiFiManager::autoConnect(char const *apName, char const *apPasswor
 boolean SimpleWiFiManager::configPortalHasTimeout(){
     if(_configPortalTimeout == 0 || WiFi.softAPgetStationNum() > 0){
         _configPortalStart = millis();
+        return false;
     }
-    return (millis() > _configPortalStart + _configPortalTimeout);
+    return (millis() - _configPortalStart > _configPortalTimeout);
 }
 
 boolean SimpleWiFiManager::startConfigPortal() {
@@ -108,52 +365,106 @@ boolean SimpleWiFiManager::startConfigPortal() {
 }
 
 boolean SimpleWiFiManager::startConfigPortal(char const *apName, char const *apPassword) {
-  if(!WiFi.mode(WIFI_AP_STA)) {
-    DEBUG_WM(F("Could not set mode"));
+  if (!startConfigPortalAsync(apName, apPassword)) {
     return false;
   }
 
+  // process() never sleeps, so the blocking wrapper gives the idle task its tick
+  while (process()) {
+    delay(1);
+  }
+  WiFiManagerLog::poll();
+
+  return  WiFi.status() == WL_CONNECTED;
+}
+
+boolean SimpleWiFiManager::startConfigPortalAsync() {
+  // The portal outlives this call, so the name goes straight into _apName
+  // instead of through a pointer to a temporary
+  _apName = "ESP" + String(ESP.getEfuseMac());
+  _apPassword = "";
+  return openConfigPortal();
+}
+
+boolean SimpleWiFiManager::startConfigPortalAsync(char const *apName, char const *apPassword) {
+  // Copied so the portal can outlive the caller's buffers
   _apName = apName;
-  _apPassword = apPassword;
+  _apPassword = (apPassword != NULL) ? apPassword : "";
+  return openConfigPortal();
+}
+
+// Brings up the softAP and portal servers for the stored _apName/_apPassword
+boolean SimpleWiFiManager::openConfigPortal() {
+  PortalLock lock(_portalLock);
+  if (_portalState != PORTAL_IDLE) {
+    stopConfigPortal();
+  }
+
+  if(!WiFi.mode(WIFI_AP_STA)) {
+    WM_LOG_E("Could not set mode");
+    return false;
+  }
 
   if (_ap_static_ip) {
-    DEBUG_WM(F("Custom AP IP/GW/Subnet"));
+    WM_LOG_I("Custom AP IP/GW/Subnet");
     WiFi.softAPConfig(_ap_static_ip, _ap_static_gw, _ap_static_sn);
   }
 
-  if (_apPassword != NULL) {
-    if (strlen(_apPassword) < 8 || strlen(_apPassword) > 63) {
-      DEBUG_WM(F("Invalid AccessPoint password. Ignoring"));
-      _apPassword = NULL;
+  if (_apPassword.length() > 0) {
+    if (_apPassword.length() < 8 || _apPassword.length() > 63) {
+      WM_LOG_W("Invalid AccessPoint password. Ignoring");
+      _apPassword = "";
     }
-    DEBUG_WM(_apPassword);
+    WM_LOG_SECRET("AP password set");
   }
 
-  if (!WiFi.softAP(_apName, _apPassword)) {
-    DEBUG_WM(F("Could not create softAP"));
+  if (!WiFi.softAP(_apName.c_str(), (_apPassword.length() > 0) ? _apPassword.c_str() : NULL)) {
+    WM_LOG_E("Could not create softAP");
     return false;
   }
 
   delay(500);
-  DEBUG_WM(F("AP IP address: "));
-  DEBUG_WM(WiFi.softAPIP());
+  WM_LOG_I("AP IP address:", WiFi.softAPIP());
 
-  _server.reset(new WebServer(80));
-  _dnsServer.reset(new DNSServer());
-  _webUI = new WebUI(_server.get(), _dnsServer.get());
+  if (!createPortalObjects()) {
+    WM_LOG_E("Not enough memory for the portal");
+    WiFi.softAPdisconnect(true);
+    return false;
+  }
+  _server->setProbeRedirect(WiFi.softAPIP());
 
   _webUI->setupHandlers(
     std::bind(&SimpleWiFiManager::handleRoot, this),
     std::bind(&SimpleWiFiManager::handleWifi, this, std::placeholders::_1),
     std::bind(&SimpleWiFiManager::handleWifiSave, this),
-    std::bind(&SimpleWiFiManager::handleInfo, this),
-    std::bind(&SimpleWiFiManager::handleReset, this),
     std::bind(&SimpleWiFiManager::handleNotFound, this),
     std::bind(&SimpleWiFiManager::captivePortal, this),
-    std::bind(&SimpleWiFiManager::handleThemeToggle, this)
+    std::bind(&SimpleWiFiManager::handleScanJson, this)
   );
 
+  // Optional pages, see wififeatures.h
+#if WM_FEATURE_INFO
+  _server->on("/i", std::bind(&SimpleWiFiManager::handleInfo, this));
+#endif
+#if WM_FEATURE_RESET
+  _server->on("/r", std::bind(&SimpleWiFiManager::handleReset, this));
+#endif
+#if WM_FEATURE_THEMES
+  _server->on("/theme-toggle", HTTP_POST, std::bind(&SimpleWiFiManager::handleThemeToggle, this));
+#endif
+#if WM_FEATURE_JSON_API
+  _server->on("/api/scan", HTTP_GET, std::bind(&SimpleWiFiManager::handleApiScan, this));
+  _server->on("/api/status", HTTP_GET, std::bind(&SimpleWiFiManager::handleApiStatus, this));
+#if WM_FEATURE_PARAMS
+  _server->on("/api/params", HTTP_GET, std::bind(&SimpleWiFiManager::handleApiParams, this));
+#endif
+  _server->on("/api/save", HTTP_POST, std::bind(&SimpleWiFiManager::handleApiSave, this));
+#endif
+#ifdef WM_METRICS
+  _server->on("/metrics", HTTP_GET, std::bind(&SimpleWiFiManager::handleMetrics, this));
+#endif
   _webUI->startDNSServer();
+  _scanCache.begin();
 
   if ( _apcallback != NULL) {
     _apcallback(this);
@@ -161,90 +472,733 @@ boolean SimpleWiFiManager::startConfigPortal(char const *apName, char const *apP
 
   connect = false;
   _configPortalStart = millis();
+  _portalState = PORTAL_SERVING;
+  _portalStateChange = millis();
+
+  return true;
+}
+
+boolean SimpleWiFiManager::createPortalObjects() {
+  // Sampled before anything is allocated, so the heap budget covers the portal
+  // objects too. A block kept from an earlier portal already belongs to it.
+  _portalFreeHeap = ESP.getFreeHeap() + ((_portalBlock != NULL) ? sizeof(PortalBlock) : 0);
+  _portalLargestBlock = ESP.getMaxAllocHeap();
+  WM_LOG_I("Largest free block before portal:", (int32_t)_portalLargestBlock);
+
+  if (_heapBudget == 0) {
+    _server.reset(new PortalServer(80));
+    _dnsServer.reset(new CaptiveDNSServer());
+    _webUI = new WebUI(_server.get(), _dnsServer.get(), &_settings);
+    _portalInBlock = false;
+    return true;
+  }
 
-  while(1) {
+  // Reserved on the first start and kept, so later portals do not carve up the heap again
+  if (_portalBlock == NULL) {
+    _portalBlock = (PortalBlock*)malloc(sizeof(PortalBlock));
+    if (_portalBlock == NULL) {
+      return false;
+    }
+  }
+  _server.reset(new (_portalBlock->server) PortalServer(80));
+  _dnsServer.reset(new (_portalBlock->dns) CaptiveDNSServer());
+  _webUI = new (_portalBlock->webUI) WebUI(_server.get(), _dnsServer.get(), &_settings);
+  _portalInBlock = true;
+  PageWriter::setSharedBuffer(_portalBlock->render, sizeof(_portalBlock->render));
+  // Only while the portal runs; connectKnownNetworks() needs the full list
+  _scanCache.setMaxRecords(WM_BUDGET_SCAN_RECORDS);
+  return true;
+}
+
+void SimpleWiFiManager::releasePortalObjects() {
+  if (_portalInBlock) {
+    // Only the objects go, the block stays reserved for the next portal
+    if (_server) {
+      _server.release()->~PortalServer();
+    }
+    if (_dnsServer) {
+      _dnsServer.release()->~CaptiveDNSServer();
+    }
+    if (_webUI != nullptr) {
+      _webUI->~WebUI();
+    }
+    PageWriter::setSharedBuffer(NULL, 0);
+    _scanCache.setMaxRecords(0);
+    _portalInBlock = false;
+  } else {
+    _server.reset();
+    _dnsServer.reset();
+    delete _webUI;
+  }
+  _webUI = nullptr;
+}
+
+// Scan rows a page may show: -1 for all. In heap budget mode the list is cut
+// short once half the budget is used, and left out once all of it is.
+int SimpleWiFiManager::scanListLimit() {
+  if (_heapBudget == 0) {
+    return -1;
+  }
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t used = (freeHeap < _portalFreeHeap) ? _portalFreeHeap - freeHeap : 0;
+  if (used >= _heapBudget) {
+    return 0;
+  }
+  return (used >= _heapBudget / 2) ? WM_BUDGET_SCAN_ITEMS : -1;
+}
+
+// Runs one slice of portal work. Returns false once the portal has closed.
+boolean SimpleWiFiManager::process() {
+  // Print what the previous slice logged, outside any request handler
+  WiFiManagerLog::poll();
+  PortalLock lock(_portalLock);
+  if (_portalState == PORTAL_IDLE) {
+    return false;
+  }
+
+  // Serve DNS and HTTP for at most _processBudget ms (a single pass when 0)
+  unsigned long sliceStart = millis();
+  do {
     _webUI->processDNSRequest();
     _webUI->handleClient();
+  } while (_portalState != PORTAL_IDLE && millis() - sliceStart < _processBudget);
 
-    if (connect) {
-      connect = false;
-      delay(2000);
-      DEBUG_WM(F("Connecting to new AP"));
+  if (_portalState == PORTAL_IDLE) {
+    return false;
+  }
+  // Background scans would disturb the association, so only refresh while serving
+  _scanCache.loop(_portalState == PORTAL_SERVING);
+  _settings.loop();
+
+  switch (_portalState) {
+    case PORTAL_SERVING:
+      if (connect) {
+        // Start the attempt on the next slice, after the "saved" page went out
+        connect = false;
+        _portalState = PORTAL_CONNECT_WAIT;
+        _portalStateChange = millis();
+      } else if (configPortalHasTimeout()) {
+        WM_LOG_I("Config portal timed out");
+        stopConfigPortal();
+      }
+      break;
 
-      if (connectWifi(_ssid, _pass) != WL_CONNECTED) {
-        DEBUG_WM(F("Failed to connect."));
+    case PORTAL_CONNECT_WAIT:
+      // The attempt runs in AP+STA mode, so the portal keeps serving and the
+      // page can poll /api/status for the result
+      if (!_scanCache.isScanning()) {
+        WM_LOG_I("Connecting to new AP");
+        beginConnect(_ssid, _pass, true);
+        _portalState = PORTAL_CONNECTING;
+        _portalStateChange = millis();
+      }
+      break;
+
+    case PORTAL_CONNECTING: {
+      wm_connect_result_t connRes = checkConnectResult();
+      if (connRes == WM_CONNECT_PENDING) {
+        break;
+      }
+      WM_LOG_I("Connection result:", (int32_t)connRes);
+
+      if (connRes != WM_CONNECT_OK) {
+        WM_LOG_I("Failed to connect.");
+        // Stop the station from retrying in the background; the AP stays up
+        WiFi.disconnect();
+        settleStationConfig(false);
+        // Only a network that is already known is marked down; the submitted
+        // password is not stored unless it connects
+        int known = _credentials.find(_ssid.c_str());
+        if (known >= 0) {
+          int ap = _scanCache.find(_ssid.c_str());
+          _credentials.recordFailure(known, (ap >= 0) ? _scanCache.get(ap).rssi : -100);
+          _credentials.save();
+        }
+        _portalState = PORTAL_SERVING;
+        _portalStateChange = millis();
+        if (_shouldBreakAfterConfig) {
+          stopConfigPortal();
+        }
       } else {
-        WiFi.mode(WIFI_STA);
-        DEBUG_WM(F("WiFi connected...yeey :)"));
-        DEBUG_WM(F("IP Address:"));
-        DEBUG_WM(WiFi.localIP());
+        _lastConnectTime = millis() - _connectStart;
+        _lastConnectFast = false;
+        settleStationConfig(true);
+        rememberNetwork();
+        saveFastConnectInfo();
+        saveLeaseInfo();
+        WM_LOG_I("WiFi connected...yeey :)");
+        WM_LOG_I("IP Address:", WiFi.localIP());
 
         if ( _savecallback != NULL) {
           _savecallback();
         }
-        break;
+        _portalState = PORTAL_CONNECTED;
+        _portalStateChange = millis();
       }
+      break;
+    }
 
-      if (_shouldBreakAfterConfig) {
-        break;
+    case PORTAL_CONNECTED:
+      if (millis() - _portalStateChange >= WM_PORTAL_LINGER) {
+        stopConfigPortal();
       }
-    }
-    yield();
+      break;
+
+    case PORTAL_RESTART:
+      if (millis() - _portalStateChange >= WM_RESET_DELAY) {
+        stopConfigPortal();
+        ESP.restart();
+      }
+      break;
+
+    default:
+      break;
   }
 
-  _server.reset();
-  _dnsServer.reset();
-  return  WiFi.status() == WL_CONNECTED;
+  return _portalState != PORTAL_IDLE;
 }
 
-int SimpleWiFiManager::connectWifi(String ssid, String pass) {
-  DEBUG_WM(F("Connecting as wifi client..."));
+void SimpleWiFiManager::stopConfigPortal() {
+  PortalLock lock(_portalLock);
+  if (_portalState == PORTAL_IDLE) {
+    return;
+  }
 
-  if (ssid.length() > 0) {
+  if (WiFi.status() == WL_CONNECTED) {
     WiFi.mode(WIFI_STA);
+  }
 
-    WiFi.persistent(true);
-    WiFi.setAutoReconnect(true);
+  _scanCache.end();
+  _settings.flush();
+  releasePortalObjects();
+  WM_LOG_I("Largest free block after portal:", (int32_t)ESP.getMaxAllocHeap());
+  _portalState = PORTAL_IDLE;
+  _portalStateChange = millis();
+}
+
+boolean SimpleWiFiManager::isConfigPortalActive() {
+  return _portalState != PORTAL_IDLE;
+}
+
+wm_connect_result_t SimpleWiFiManager::connectWifi(String ssid, String pass) {
+  beginConnect(ssid, pass);
+
+  wm_connect_result_t connRes = waitForConnectResult();
+  settleStationConfig(connRes == WM_CONNECT_OK);
+  WM_LOG_I("Connection result:", (int32_t)connRes);
+  return connRes;
+}
+
+// Ends an attempt started by beginConnect() with explicit credentials: if they
+// connected they are written to flash, otherwise the previous config is put back
+void SimpleWiFiManager::settleStationConfig(boolean connected) {
+  if (!_stationConfPending) {
+    return;
+  }
+  _stationConfPending = false;
+
+  wifi_config_t conf;
+  if (connected) {
+    esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+    if (esp_wifi_get_config(WIFI_IF_STA, &conf) == ESP_OK) {
+      esp_wifi_set_config(WIFI_IF_STA, &conf);
+    }
+  } else {
+    esp_wifi_set_config(WIFI_IF_STA, &_stationConf);
+    esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+  }
+  WiFi.persistent(true);
+}
+
+void SimpleWiFiManager::beginConnect(String ssid, String pass, boolean keepAP) {
+  WM_LOG_I("Connecting as wifi client...");
+
+  registerEventHandler();
+  xEventGroupClearBits(_connectEvents, WM_CONNECT_EVENT_BITS);
+  _handshakeTimeouts = 0;
+
+  if (ssid.length() > 0) {
+    WiFi.mode(keepAP ? WIFI_AP_STA : WIFI_STA);
+
+    // New credentials are tried from RAM, so a wrong password does not replace
+    // the config the core saved. settleStationConfig() decides what stays.
+    if (!_stationConfPending) {
+      _stationConfPending = (esp_wifi_get_config(WIFI_IF_STA, &_stationConf) == ESP_OK);
+    }
+    WiFi.persistent(false);
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    WiFi.setAutoReconnect(_supervisorTask == NULL);
 
     if (_sta_static_ip) {
-      DEBUG_WM(F("Custom STA IP/GW/Subnet"));
+      WM_LOG_I("Custom STA IP/GW/Subnet");
       WiFi.config(_sta_static_ip, _sta_static_gw, _sta_static_sn);
-      DEBUG_WM(WiFi.localIP());
+      WM_LOG_I("STA IP:", WiFi.localIP());
     }
     WiFi.begin(ssid.c_str(), pass.c_str());
   } else {
     WiFi.persistent(true);
-    WiFi.setAutoReconnect(true);
+    WiFi.setAutoReconnect(_supervisorTask == NULL);
     WiFi.begin();
   }
+  _connectStart = millis();
+  _connectAttemptTimeout = _connectTimeout;
+}
+
+// Scans once and tries the known networks that are in range, best ranked first.
+// Networks that are not visible are skipped without waiting for a timeout.
+wm_connect_result_t SimpleWiFiManager::connectKnownNetworks() {
+  WM_LOG_I("Scanning for known networks");
+  WiFi.mode(WIFI_STA);
+  if (!_scanCache.scanNow()) {
+    return WM_CONNECT_FAILED;
+  }
+
+  // The cached lease belongs to the network the fast path already tried
+  if (_leaseApplied) {
+    dropCachedLease();
+  }
 
-  int connRes = waitForConnectResult();
-  DEBUG_WM ("Connection result: ");
-  DEBUG_WM ( connRes );
+  int candidates[WIFI_MANAGER_MAX_NETWORKS];
+  int8_t rssi[WIFI_MANAGER_MAX_NETWORKS];
+  int n = 0;
+  for (int i = 0; i < _credentials.count(); i++) {
+    int ap = _scanCache.find(_credentials.get(i).ssid);
+    if (ap < 0) {
+      continue;
+    }
+    rssi[i] = _scanCache.get(ap).rssi;
+    // Insertion sort by score, there are only a handful of entries
+    int j = n++;
+    while (j > 0 && _credentials.score(candidates[j - 1], rssi[candidates[j - 1]]) < _credentials.score(i, rssi[i])) {
+      candidates[j] = candidates[j - 1];
+      j--;
+    }
+    candidates[j] = i;
+  }
+
+  wm_connect_result_t connRes = WM_CONNECT_NO_AP_FOUND;
+  for (int k = 0; k < n; k++) {
+    int i = candidates[k];
+    const StoredNetwork& net = _credentials.get(i);
+    WM_LOG_I("Trying known network", net.ssid);
+    connRes = connectWifi(net.ssid, net.pass);
+    if (connRes == WM_CONNECT_OK) {
+      break;
+    }
+    _credentials.recordFailure(i, rssi[i]);
+    WiFi.disconnect();
+  }
+  _credentials.save();
   return connRes;
 }
 
-uint8_t SimpleWiFiManager::waitForConnectResult() {
-  if (_connectTimeout == 0) {
-    return WiFi.waitForConnectResult();
-  } else {
-    DEBUG_WM (F("Waiting for connection result with time out"));
-    unsigned long start = millis();
-    boolean keepConnecting = true;
-    uint8_t status;
-    while (keepConnecting) {
-      status = WiFi.status();
-      if (millis() > start + _connectTimeout) {
-        keepConnecting = false;
-        DEBUG_WM (F("Connection timed out"));
+// Adds the connected network to the store and marks it as the most recent success
+void SimpleWiFiManager::rememberNetwork() {
+  _credentials.add(WiFi.SSID().c_str(), WiFi.psk().c_str());
+  int i = _credentials.find(WiFi.SSID().c_str());
+  if (i >= 0) {
+    _credentials.recordSuccess(i, WiFi.RSSI());
+  }
+  _credentials.save();
+}
+
+// Applies the address stored by saveLeaseInfo() when it belongs to the stored
+// network and is still inside its lease window. time() survives deep sleep and
+// soft resets on the ESP32; after a power cycle it restarts and the check fails.
+boolean SimpleWiFiManager::applyCachedLease() {
+  if (!_leaseCache || _sta_static_ip) {
+    return false;
+  }
+
+  LeaseInfo lease;
+  Preferences preferences;
+  if (!preferences.begin("wm", true)) {
+    return false;
+  }
+  size_t len = preferences.getBytes("lease", &lease, sizeof(lease));
+  preferences.end();
+  if (len != sizeof(lease) || lease.ip == 0) {
+    return false;
+  }
+
+  uint32_t now = time(NULL);
+  if (now < lease.obtainedAt || now - lease.obtainedAt >= lease.leaseSeconds) {
+    WM_LOG_I("Cached lease expired");
+    return false;
+  }
+
+  wifi_config_t conf;
+  WiFi.mode(WIFI_STA);
+  if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK ||
+      strncmp(reinterpret_cast<char*>(conf.sta.ssid), lease.ssid, 32) != 0) {
+    return false;
+  }
+
+  WM_LOG_I("Reusing cached DHCP lease");
+  return WiFi.config(IPAddress(lease.ip), IPAddress(lease.gateway), IPAddress(lease.subnet), IPAddress(lease.dns));
+}
+
+void SimpleWiFiManager::dropCachedLease() {
+  // Zero addresses switch the station back to DHCP
+  WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+  _leaseApplied = false;
+}
+
+void SimpleWiFiManager::saveLeaseInfo() {
+  // Only addresses that actually came from DHCP are worth caching
+  if (!_leaseCache || _sta_static_ip || _leaseApplied) {
+    return;
+  }
+
+  LeaseInfo lease;
+  memset(&lease, 0, sizeof(lease));
+  strncpy(lease.ssid, WiFi.SSID().c_str(), sizeof(lease.ssid) - 1);
+  lease.ip = WiFi.localIP();
+  lease.gateway = WiFi.gatewayIP();
+  lease.subnet = WiFi.subnetMask();
+  lease.dns = WiFi.dnsIP();
+  lease.obtainedAt = time(NULL);
+  lease.leaseSeconds = _leaseSeconds;
+
+  Preferences preferences;
+  preferences.begin("wm", false);
+  preferences.putBytes("lease", &lease, sizeof(lease));
+  preferences.end();
+}
+
+static void onGatewayPingSuccess(esp_ping_handle_t hdl, void *args) {
+  *static_cast<volatile int*>(args) = 1;
+}
+
+static void onGatewayPingEnd(esp_ping_handle_t hdl, void *args) {
+  volatile int *state = static_cast<volatile int*>(args);
+  if (*state == 0) {
+    *state = -1;
+  }
+}
+
+// One ICMP echo to the gateway, used to confirm a reused lease is still valid
+boolean SimpleWiFiManager::gatewayResponds() {
+  IPAddress gw = WiFi.gatewayIP();
+  volatile int state = 0;
+
+  esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
+  IP_ADDR4(&config.target_addr, gw[0], gw[1], gw[2], gw[3]);
+  config.count = 1;
+  config.timeout_ms = WM_LEASE_PROBE_TIMEOUT;
+
+  esp_ping_callbacks_t cbs;
+  memset(&cbs, 0, sizeof(cbs));
+  cbs.cb_args = (void*)&state;
+  cbs.on_ping_success = onGatewayPingSuccess;
+  cbs.on_ping_end = onGatewayPingEnd;
+
+  esp_ping_handle_t ping;
+  if (esp_ping_new_session(&config, &cbs, &ping) != ESP_OK) {
+    return false;
+  }
+  esp_ping_start(ping);
+  unsigned long start = millis();
+  while (state == 0 && millis() - start < WM_LEASE_PROBE_TIMEOUT + 200) {
+    delay(5);
+  }
+  esp_ping_stop(ping);
+  esp_ping_delete_session(ping);
+  return state == 1;
+}
+
+// Associates with the BSSID/channel cached by saveFastConnectInfo(), skipping the
+// all-channel scan. Returns WM_CONNECT_SKIPPED if nothing usable is cached.
+// conf receives the stored station config so the caller can fall back to a normal connect.
+wm_connect_result_t SimpleWiFiManager::tryFastReconnect(wifi_config_t *conf) {
+  FastConnectInfo info;
+  Preferences preferences;
+  if (!preferences.begin("wm", true)) {
+    return WM_CONNECT_SKIPPED;
+  }
+  size_t len = preferences.getBytes("fast", &info, sizeof(info));
+  preferences.end();
+  if (len != sizeof(info) || info.channel == 0) {
+    return WM_CONNECT_SKIPPED;
+  }
+
+  WiFi.mode(WIFI_STA);
+  if (esp_wifi_get_config(WIFI_IF_STA, conf) != ESP_OK) {
+    return WM_CONNECT_SKIPPED;
+  }
+  char ssid[33];
+  memcpy(ssid, conf->sta.ssid, 32);
+  ssid[32] = 0;
+  if (ssid[0] == 0 || strcmp(ssid, info.ssid) != 0) {
+    return WM_CONNECT_SKIPPED;
+  }
+
+  WM_LOG_I("Fast reconnect to cached BSSID");
+
+  // Keep the cached BSSID out of the persisted config so a fallback can roam
+  WiFi.persistent(false);
+  WiFi.setAutoReconnect(_supervisorTask == NULL);
+  if (_sta_static_ip) {
+    WiFi.config(_sta_static_ip, _sta_static_gw, _sta_static_sn);
+  }
+  registerEventHandler();
+  xEventGroupClearBits(_connectEvents, WM_CONNECT_EVENT_BITS);
+  _handshakeTimeouts = 0;
+  char pass[65];
+  memcpy(pass, conf->sta.password, 64);
+  pass[64] = 0;
+  WiFi.begin(ssid, pass, info.channel, info.bssid);
+  WiFi.persistent(true);
+
+  _connectStart = millis();
+  _connectAttemptTimeout = (_connectTimeout == 0 || _connectTimeout > WM_FAST_CONNECT_TIMEOUT) ? WM_FAST_CONNECT_TIMEOUT : _connectTimeout;
+  wm_connect_result_t result = waitForConnectResult();
+  clearBssidPin();
+  return result;
+}
+
+// Drops the BSSID/channel set by tryFastReconnect() from the running config,
+// so the driver's own reconnects and later WiFi.begin() calls can roam again.
+// The new config applies from the next association on.
+void SimpleWiFiManager::clearBssidPin() {
+  wifi_config_t conf;
+  if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK || !conf.sta.bssid_set) {
+    return;
+  }
+  conf.sta.bssid_set = 0;
+  conf.sta.channel = 0;
+  // RAM only, like the fast attempt itself
+  esp_wifi_set_storage(WIFI_STORAGE_RAM);
+  esp_wifi_set_config(WIFI_IF_STA, &conf);
+  esp_wifi_set_storage(WIFI_STORAGE_FLASH);
+}
+
+void SimpleWiFiManager::saveFastConnectInfo() {
+  if (!_fastReconnect) {
+    return;
+  }
+
+  FastConnectInfo info;
+  memset(&info, 0, sizeof(info));
+  strncpy(info.ssid, WiFi.SSID().c_str(), sizeof(info.ssid) - 1);
+  uint8_t *bssid = WiFi.BSSID();
+  if (bssid != NULL) {
+    memcpy(info.bssid, bssid, sizeof(info.bssid));
+  }
+  info.channel = WiFi.channel();
+
+  // Only write when the AP changed, to spare the flash
+  Preferences preferences;
+  preferences.begin("wm", false);
+  FastConnectInfo stored;
+  if (preferences.getBytes("fast", &stored, sizeof(stored)) != sizeof(stored) ||
+      memcmp(&stored, &info, sizeof(info)) != 0) {
+    preferences.putBytes("fast", &info, sizeof(info));
+  }
+  preferences.end();
+}
+
+void SimpleWiFiManager::registerEventHandler() {
+  if (_connectEvents != NULL) {
+    return;
+  }
+  _connectEvents = xEventGroupCreate();
+  _eventHandlerId = WiFi.onEvent(std::bind(&SimpleWiFiManager::onWiFiEvent, this,
+                                           std::placeholders::_1, std::placeholders::_2));
+}
+
+// Runs in the WiFi event task: only translates events into event group bits
+void SimpleWiFiManager::onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      xEventGroupSetBits(_connectEvents, WM_EVENT_GOT_IP);
+      break;
+
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED: {
+      _lastDisconnectReason = info.wifi_sta_disconnected.reason;
+      if (_supervisorTask != NULL) {
+        xTaskNotifyGive(_supervisorTask);
+      }
+      // Handshake timeouts only count as a wrong password once they repeat
+      uint32_t bits = WiFiConnectEvents::bitsForDisconnect(info.wifi_sta_disconnected.reason, _handshakeTimeouts);
+      if (bits != 0) {
+        xEventGroupSetBits(_connectEvents, bits);
       }
-      if (status == WL_CONNECTED || status == WL_CONNECT_FAILED) {
-        keepConnecting = false;
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+boolean SimpleWiFiManager::startReconnectSupervisor(BaseType_t core, UBaseType_t priority, unsigned long portalAfterSeconds) {
+  if (_supervisorTask != NULL) {
+    return true;
+  }
+  if (_portalLock == NULL) {
+    _portalLock = xSemaphoreCreateRecursiveMutex();
+    if (_portalLock == NULL) {
+      return false;
+    }
+  }
+  _portalAfterOutage = portalAfterSeconds * 1000;
+  _supervisorStop = false;
+  registerEventHandler();
+  // The supervisor decides when to retry, not the driver
+  WiFi.setAutoReconnect(false);
+
+  if (xTaskCreatePinnedToCore(supervisorTask, "wm_supervisor", WM_SUPERVISOR_STACK_SIZE, this,
+                              priority, &_supervisorTask, core) != pdPASS) {
+    _supervisorTask = NULL;
+    WiFi.setAutoReconnect(true);
+    return false;
+  }
+  return true;
+}
+
+void SimpleWiFiManager::stopReconnectSupervisor() {
+  if (_supervisorTask == NULL) {
+    return;
+  }
+  _supervisorStop = true;
+  xTaskNotifyGive(_supervisorTask);
+  // The task clears the handle right before deleting itself
+  while (_supervisorTask != NULL) {
+    delay(10);
+  }
+  WiFi.setAutoReconnect(true);
+}
+
+void SimpleWiFiManager::setReconnectBackoff(unsigned long minSeconds, unsigned long maxSeconds) {
+  _backoffMin = minSeconds * 1000;
+  _backoffMax = (maxSeconds > minSeconds ? maxSeconds : minSeconds) * 1000;
+}
+
+uint32_t SimpleWiFiManager::getSupervisorStatus() {
+  return _supervisorStatus.load(std::memory_order_relaxed);
+}
+
+void SimpleWiFiManager::setSupervisorStatus(uint8_t state, uint8_t attempts, wm_connect_result_t result) {
+  _supervisorStatus.store(state | ((uint32_t)attempts << 8) | ((uint32_t)(uint8_t)result << 16),
+                          std::memory_order_relaxed);
+}
+
+void SimpleWiFiManager::supervisorTask(void *arg) {
+  static_cast<SimpleWiFiManager*>(arg)->runSupervisor();
+  static_cast<SimpleWiFiManager*>(arg)->_supervisorTask = NULL;
+  vTaskDelete(NULL);
+}
+
+// Watches the link and reconnects with exponential backoff and jitter, so a
+// fleet that lost its AP at the same moment does not retry in lockstep.
+void SimpleWiFiManager::runSupervisor() {
+  unsigned long outageStart = 0;
+  uint8_t attempts = 0;
+  wm_connect_result_t result = _lastConnectResult;
+
+  while (!_supervisorStop) {
+    WiFiManagerLog::poll();
+    if (WiFi.status() == WL_CONNECTED) {
+      outageStart = 0;
+      attempts = 0;
+      setSupervisorStatus(WM_SUPERVISOR_CONNECTED, 0, result);
+      // Woken early by the disconnect event
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    if (outageStart == 0) {
+      WM_LOG_I("Supervisor: link lost");
+      outageStart = millis();
+    }
+
+    if (_portalAfterOutage > 0 && millis() - outageStart >= _portalAfterOutage) {
+      WM_LOG_I("Supervisor: outage too long, starting config portal");
+      setSupervisorStatus(WM_SUPERVISOR_PORTAL, attempts, result);
+      if (openConfigPortal()) {
+        while (!_supervisorStop && process()) {
+          vTaskDelay(1);
+        }
+        stopConfigPortal();
       }
-      delay(100);
+      outageStart = 0;
+      attempts = 0;
+      continue;
+    }
+
+    setSupervisorStatus(WM_SUPERVISOR_BACKOFF, attempts, result);
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(backoffDelay(attempts)));
+    if (_supervisorStop) {
+      break;
     }
-    return status;
+    if (WiFi.status() == WL_CONNECTED) {
+      continue;
+    }
+
+    setSupervisorStatus(WM_SUPERVISOR_CONNECTING, attempts, result);
+    WiFi.disconnect();
+    // First retry the last network, then rotate through the known ones in range
+    if (attempts == 0 || _credentials.count() == 0) {
+      result = connectWifi("", "");
+    } else {
+      result = connectKnownNetworks();
+    }
+    if (result == WM_CONNECT_OK) {
+      rememberNetwork();
+      saveFastConnectInfo();
+      saveLeaseInfo();
+      _scanCache.end();
+    } else if (attempts < 255) {
+      attempts++;
+    }
+  }
+  setSupervisorStatus(WM_SUPERVISOR_STOPPED, 0, result);
+}
+
+// Exponential backoff with "equal jitter": half fixed, half random
+unsigned long SimpleWiFiManager::backoffDelay(uint8_t attempts) {
+  unsigned long backoff = _backoffMin;
+  for (uint8_t i = 0; i < attempts && backoff < _backoffMax; i++) {
+    backoff *= 2;
+  }
+  if (backoff > _backoffMax) {
+    backoff = _backoffMax;
   }
+  return backoff / 2 + esp_random() % (backoff / 2 + 1);
+}
+
+// Non-blocking check of the attempt started by beginConnect()
+wm_connect_result_t SimpleWiFiManager::checkConnectResult() {
+  // 0 keeps the core's WiFi.waitForConnectResult() default of 60 seconds
+  unsigned long timeout = (_connectAttemptTimeout == 0) ? 60000 : _connectAttemptTimeout;
+  wm_connect_result_t result = WiFiConnectEvents::resultFromBits(xEventGroupGetBits(_connectEvents));
+
+  if (result == WM_CONNECT_PENDING && millis() - _connectStart > timeout) {
+    WM_LOG_I("Connection timed out");
+    result = (WiFi.status() == WL_CONNECTED) ? WM_CONNECT_OK : WM_CONNECT_TIMEOUT;
+  }
+  if (result != WM_CONNECT_PENDING) {
+    _lastConnectResult = result;
+    WM_METRIC_RECORD(WM_METRIC_CONNECT, (millis() - _connectStart) * 1000);
+  }
+  return result;
+}
+
+// Sleeps on the event group until the driver reports an outcome or the timeout expires
+wm_connect_result_t SimpleWiFiManager::waitForConnectResult() {
+  WM_LOG_I("Waiting for connection result with time out");
+  unsigned long timeout = (_connectAttemptTimeout == 0) ? 60000 : _connectAttemptTimeout;
+  unsigned long elapsed = millis() - _connectStart;
+  TickType_t ticks = (elapsed < timeout) ? pdMS_TO_TICKS(timeout - elapsed) : 0;
+
+  xEventGroupWaitBits(_connectEvents, WM_CONNECT_EVENT_BITS, pdFALSE, pdFALSE, ticks);
+  wm_connect_result_t result;
+  while ((result = checkConnectResult()) == WM_CONNECT_PENDING) {
+    // Tick rounding can wake us a moment before the deadline
+    delay(1);
+  }
+  return result;
 }
 
 String SimpleWiFiManager::getConfigPortalSSID() {
@@ -252,9 +1206,26 @@ String SimpleWiFiManager::getConfigPortalSSID() {
 }
 
 void SimpleWiFiManager::resetSettings() {
-  DEBUG_WM(F("settings invalidated"));
-  DEBUG_WM(F("THIS MAY CAUSE AP NOT TO START UP PROPERLY. YOU NEED TO COMMENT IT OUT AFTER ERASING NVS"));
+  WM_LOG_I("settings invalidated");
+  WM_LOG_W("THIS MAY CAUSE AP NOT TO START UP PROPERLY. YOU NEED TO COMMENT IT OUT AFTER ERASING NVS");
   WiFi.disconnect(true);
+  clearNetworks();
+  // Theme and title survive the reset; a restart usually follows
+  _settings.flush();
+
+  Preferences preferences;
+  preferences.begin("wm", false);
+  preferences.remove("fast");
+  preferences.remove("lease");
+  preferences.end();
+
+#if WM_FEATURE_PARAMS
+  // Parameters fall back to their own values before the blob goes away
+  for (int i = 0; i < _paramsCount; i++) {
+    _params[i]->_stored = NULL;
+  }
+  _paramStore.clear();
+#endif
   delay(200);
 }
 
@@ -262,12 +1233,24 @@ void SimpleWiFiManager::setConfigPortalTimeout(unsigned long seconds) {
   _configPortalTimeout = seconds * 1000;
 }
 
+void SimpleWiFiManager::setProcessBudget(unsigned long milliseconds) {
+  _processBudget = milliseconds;
+}
+
 void SimpleWiFiManager::setConnectTimeout(unsigned long seconds) {
   _connectTimeout = seconds * 1000;
 }
 
 void SimpleWiFiManager::setDebugOutput(boolean debug) {
-  _debug = debug;
+  WiFiManagerLog::setEnabled(debug);
+}
+
+boolean SimpleWiFiManager::startLogTask(UBaseType_t priority, BaseType_t core) {
+  return WiFiManagerLog::startTask(priority, core);
+}
+
+void SimpleWiFiManager::flushLog() {
+  WiFiManagerLog::flush();
 }
 
 void SimpleWiFiManager::setAPStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn) {
@@ -290,268 +1273,469 @@ void SimpleWiFiManager::setBreakAfterConfig(boolean shouldBreak) {
   _shouldBreakAfterConfig = shouldBreak;
 }
 
+#if WM_FEATURE_THEMES
 void SimpleWiFiManager::setWebUITheme(int theme) {
-  if (_webUI) {
-    _webUI->setTheme(theme);
-  }
+  _settings.setTheme(theme);
 }
 
 int SimpleWiFiManager::getWebUITheme() {
-  if (_webUI) {
-    return _webUI->getTheme();
-  }
-  return WM_WEBUI_THEME_DARK; // デフォルト値
+  return _settings.getTheme();
+}
+#else
+// Built with WM_FEATURE_THEMES=0: only the light theme exists
+void SimpleWiFiManager::setWebUITheme(int theme) {
+}
+
+int SimpleWiFiManager::getWebUITheme() {
+  return WM_WEBUI_THEME_LIGHT;
+}
+#endif
+
+void SimpleWiFiManager::writePageHead(PageWriter& page, const char* title) {
+  const char* values[] = { title };
+  headTemplate.render(page, values);
+  page.write_P(WebUI::HTTP_SCRIPT);
+  page.write_P(_webUI->getStyleLink());
+  page.write(_customHeadElement);
+  page.write_P(WebUI::HTTP_HEAD_END);
 }
 
 void SimpleWiFiManager::handleRoot() {
-  DEBUG_WM(F("Handle root"));
+  WM_METRIC_SCOPE(WM_METRIC_ROOT);
+  WM_LOG_I("Handle root");
   if (captivePortal()) {
     return;
   }
 
-  String page = WebUI::HTTP_HEAD_START;
-  page.replace("{v}", "Options");
-  page += WebUI::HTTP_SCRIPT;
-  page += _webUI->getCurrentStyle();
-  page += _customHeadElement;
-  page += WebUI::HTTP_HEAD_END;
-  page += "<h1>";
-  page += _apName;
-  page += "</h1>";
-  page += "<h3>" + String(_webUITitle) + "</h3>";
-  
+  PageWriter page(_server.get());
+  page.begin(200, "text/html");
+  writePageHead(page, "Options");
+  page.write("<h1>");
+  page.write(_apName);
+  page.write("</h1>");
+  page.write("<h3>");
+  page.write(_settings.getTitle());
+  page.write("</h3>");
+
+#if WM_FEATURE_THEMES
   // スライドスイッチを追加
-  String themeToggle = WebUI::HTTP_THEME_TOGGLE;
-  String checked = (_webUI->getTheme() == WM_WEBUI_THEME_DARK) ? "checked" : "";
-  themeToggle.replace("{c}", checked);
-  page += themeToggle;
-  
-  page += WebUI::HTTP_PORTAL_OPTIONS;
-  page += WebUI::HTTP_END;
+  const char* values[] = { (_webUI->getTheme() == WM_WEBUI_THEME_DARK) ? "checked" : "" };
+  themeToggleTemplate.render(page, values, 1 << 0);
+#endif
 
-  _server->sendHeader("Content-Length", String(page.length()));
-  _server->send(200, "text/html", page);
+  page.write_P(WebUI::HTTP_PORTAL_OPTIONS);
+  page.write_P(WebUI::HTTP_END);
+  page.end();
 }
 
 void SimpleWiFiManager::handleWifi(boolean scan) {
-  String page = WebUI::HTTP_HEAD_START;
-  page.replace("{v}", "Config ESP");
-  page += WebUI::HTTP_SCRIPT;
-  page += _webUI->getCurrentStyle();
-  page += _customHeadElement;
-  page += WebUI::HTTP_HEAD_END;
+  WM_METRIC_SCOPE(scan ? WM_METRIC_WIFI : WM_METRIC_WIFI_NOSCAN);
+  PageWriter page(_server.get());
+  page.begin(200, "text/html");
+  writePageHead(page, "Config ESP");
+
+  // Over the heap budget the page falls back to the manual entry form
+  if (scan && scanListLimit() == 0) {
+    WM_LOG_W("Heap budget exceeded, scan list left out");
+    page.write(F("<div>Low on memory. Enter the network name below.</div><br/>"));
+    scan = false;
+  }
 
   if (scan) {
-    int n = WiFi.scanNetworks();
-    DEBUG_WM(F("Scan done"));
-    if (n == 0) {
-      DEBUG_WM(F("No networks found"));
-      page += F("No networks found. Refresh to scan again.");
+    // Rendered from the background scan snapshot, the page script refreshes it in place
+    _scanCache.requestRefresh();
+    page.write_P(WebUI::HTTP_SCAN_LIST_START);
+    if (!_scanCache.hasResults()) {
+      page.write(F("Scanning..."));
+    } else if (_scanCache.count() == 0) {
+      WM_LOG_I("No networks found");
+      page.write(F("No networks found. Refresh to scan again."));
     } else {
-      int indices[n];
-      for (int i = 0; i < n; i++) {
-        indices[i] = i;
-      }
-
-      for (int i = 0; i < n; i++) {
-        for (int j = i + 1; j < n; j++) {
-          if (WiFi.RSSI(indices[j]) > WiFi.RSSI(indices[i])) {
-            std::swap(indices[i], indices[j]);
-          }
-        }
-      }
-
-      if (_removeDuplicateAPs) {
-        String cssid;
-        for (int i = 0; i < n; i++) {
-          if (indices[i] == -1) continue;
-          cssid = WiFi.SSID(indices[i]);
-          for (int j = i + 1; j < n; j++) {
-            if (cssid == WiFi.SSID(indices[j])) {
-              DEBUG_WM("DUP AP: " + WiFi.SSID(indices[j]));
-              indices[j] = -1;
-            }
-          }
-        }
-      }
+      int indices[_scanCache.count()];
+      int n = getScanOrder(indices);
 
       for (int i = 0; i < n; i++) {
-        if (indices[i] == -1) continue;
-        DEBUG_WM(WiFi.SSID(indices[i]));
-        DEBUG_WM(WiFi.RSSI(indices[i]));
-        int quality = getRSSIasQuality(WiFi.RSSI(indices[i]));
-
-        if (_minimumQuality == -1 || _minimumQuality < quality) {
-          String item = WebUI::HTTP_ITEM;
-          String rssiQ;
-          rssiQ += quality;
-          item.replace("{v}", WiFi.SSID(indices[i]));
-          item.replace("{r}", rssiQ);
-          if (WiFi.encryptionType(indices[i]) != WIFI_AUTH_OPEN) {
-            item.replace("{i}", "l");
-          } else {
-            item.replace("{i}", "");
-          }
-          page += item;
-          delay(0);
-        } else {
-          DEBUG_WM(F("Skipping due to quality"));
-        }
+        const ScanRecord& ap = _scanCache.get(indices[i]);
+        WM_LOG_D("AP:", ap.ssid);
+        WM_LOG_D("RSSI:", (int32_t)ap.rssi);
+
+        char rssiQ[5];
+        snprintf(rssiQ, sizeof(rssiQ), "%d", getRSSIasQuality(ap.rssi));
+        const char* values[] = {
+          ap.ssid,
+          rssiQ,
+          (ap.auth != WIFI_AUTH_OPEN) ? "l" : ""
+        };
+        itemTemplate.render(page, values, 1 << 2);
+        delay(0);
       }
-      page += "<br/>";
+    }
+    page.write_P(WebUI::HTTP_SCAN_LIST_END);
+    if (!_scanCache.hasResults() || _scanCache.isScanning()) {
+      page.write_P(WebUI::HTTP_SCAN_POLL);
     }
   }
 
-  page += WebUI::HTTP_FORM_START;
-  char parLength[2];
+  page.write_P(WebUI::HTTP_FORM_START);
+#if WM_FEATURE_PARAMS
+  char parLength[12];
   for (int i = 0; i < _paramsCount; i++) {
     if (_params[i] == NULL) {
       break;
     }
 
-    String pitem = WebUI::HTTP_FORM_PARAM;
     if (_params[i]->getID() != NULL) {
-      pitem.replace("{i}", _params[i]->getID());
-      pitem.replace("{n}", _params[i]->getID());
-      pitem.replace("{p}", _params[i]->getPlaceholder());
-      snprintf(parLength, 2, "%d", _params[i]->getValueLength());
-      pitem.replace("{l}", parLength);
-      pitem.replace("{v}", _params[i]->getValue());
-      pitem.replace("{c}", _params[i]->getCustomHTML());
+      snprintf(parLength, sizeof(parLength), "%d", _params[i]->getValueLength());
+      const char* values[] = {
+        _params[i]->getID(),
+        _params[i]->getID(),
+        _params[i]->getPlaceholder(),
+        parLength,
+        _params[i]->getValue(),
+        _params[i]->getCustomHTML()
+      };
+      // Custom HTML is emitted as-is, everything else is escaped
+      paramTemplate.render(page, values, 1 << 5);
     } else {
-      pitem = _params[i]->getCustomHTML();
+      page.write(_params[i]->getCustomHTML());
     }
-
-    page += pitem;
   }
-  if (_params[0] != NULL) {
-    page += "<br/>";
+  if (_paramsCount > 0) {
+    page.write("<br/>");
   }
+#endif
 
-  page += WebUI::HTTP_FORM_END;
+  page.write_P(WebUI::HTTP_FORM_END);
+  page.write_P(WebUI::HTTP_SCAN_LINK);
+  page.write_P(WebUI::HTTP_END);
+  page.end();
+}
 
-  page += WebUI::HTTP_SCAN_LINK;
+// Fills indices with the snapshot entries to show, strongest first, and returns how many
+int SimpleWiFiManager::getScanOrder(int *indices) {
+  // Records are sorted strongest first, so a cut keeps the best networks
+  int limit = scanListLimit();
+  int visible = 0;
+  for (int i = 0; i < _scanCache.count() && visible != limit; i++) {
+    const ScanRecord& ap = _scanCache.get(i);
+    if (_removeDuplicateAPs && ap.duplicate) {
+      continue;
+    }
+    int quality = getRSSIasQuality(ap.rssi);
+    if (_minimumQuality == -1 || _minimumQuality < quality) {
+      indices[visible++] = i;
+    }
+  }
+  return visible;
+}
 
-  page += WebUI::HTTP_END;
+void SimpleWiFiManager::handleScanJson() {
+  WM_METRIC_SCOPE(WM_METRIC_SCAN_JSON);
+  PageWriter page(_server.get());
+  _server->sendHeader("Cache-Control", "no-cache");
+  page.begin(200, "application/json");
+  writeScanJson(page);
+  page.end();
+}
 
-  _server->sendHeader("Content-Length", String(page.length()));
-  _server->send(200, "text/html", page);
+// {"scanning":false,"aps":[{"ssid":"..","rssi":-60,"q":80,"auth":3,"ch":6},..]}
+void SimpleWiFiManager::writeScanJson(PageWriter& page) {
+  page.write(F("{\"scanning\":"));
+  page.write(_scanCache.isScanning() ? "true" : "false");
+  page.write(F(",\"aps\":["));
+
+  int indices[_scanCache.count() > 0 ? _scanCache.count() : 1];
+  int n = getScanOrder(indices);
+  for (int i = 0; i < n; i++) {
+    const ScanRecord& ap = _scanCache.get(indices[i]);
+    page.write(i == 0 ? "{\"ssid\":\"" : ",{\"ssid\":\"");
+    page.writeJsonEscaped(ap.ssid);
+    page.write(F("\",\"rssi\":"));
+    page.write((int32_t)ap.rssi);
+    page.write(F(",\"q\":"));
+    page.write((int32_t)getRSSIasQuality(ap.rssi));
+    page.write(F(",\"auth\":"));
+    page.write((uint32_t)ap.auth);
+    page.write(F(",\"ch\":"));
+    page.write((uint32_t)ap.channel);
+    page.write("}");
+  }
+  page.write("]}");
 }
 
-void SimpleWiFiManager::handleWifiSave() {
-  DEBUG_WM(F("WiFi save"));
+#if WM_FEATURE_JSON_API
+// Same snapshot as /scan.json, and asks for a fresh scan like /wifi does
+void SimpleWiFiManager::handleApiScan() {
+  WM_METRIC_SCOPE(WM_METRIC_API);
+  _scanCache.requestRefresh();
+  PageWriter page(_server.get());
+  _server->sendHeader("Cache-Control", "no-cache");
+  page.begin(200, "application/json");
+  writeScanJson(page);
+  page.end();
+}
 
+// {"state":"connecting","ssid":"..","result":-1,"reason":0,"connected":false,"ip":"0.0.0.0"}
+void SimpleWiFiManager::handleApiStatus() {
+  WM_METRIC_SCOPE(WM_METRIC_API);
+  static const char* const STATES[] = { "idle", "serving", "connect_wait", "connecting", "connected", "restarting" };
+
+  PageWriter page(_server.get());
+  _server->sendHeader("Cache-Control", "no-cache");
+  page.begin(200, "application/json");
+  page.write(F("{\"state\":\""));
+  page.write(STATES[_portalState]);
+  page.write(F("\",\"ssid\":\""));
+  page.writeJsonEscaped(_ssid.c_str());
+  page.write(F("\",\"result\":"));
+  // Pending from the moment credentials are accepted until the attempt ends
+  boolean pending = connect || _portalState == PORTAL_CONNECT_WAIT || _portalState == PORTAL_CONNECTING;
+  page.write((int32_t)(pending ? WM_CONNECT_PENDING : _lastConnectResult));
+  page.write(F(",\"reason\":"));
+  page.write((uint32_t)_lastDisconnectReason);
+  page.write(F(",\"connected\":"));
+  page.write((WiFi.status() == WL_CONNECTED) ? "true" : "false");
+  page.write(F(",\"ip\":\""));
+  char ip[WM_IP_STR_LEN];
+  page.write(ip, formatIp(WiFi.localIP(), ip));
+  page.write("\"}");
+  page.end();
+}
+
+#if WM_FEATURE_PARAMS
+// [{"id":"..","label":"..","value":"..","length":40},..]
+void SimpleWiFiManager::handleApiParams() {
+  WM_METRIC_SCOPE(WM_METRIC_API);
+  PageWriter page(_server.get());
+  _server->sendHeader("Cache-Control", "no-cache");
+  page.begin(200, "application/json");
+  page.write("[");
+  boolean first = true;
   for (int i = 0; i < _paramsCount; i++) {
-    if (_params[i] == NULL) {
-      break;
+    WiFiManagerParameter* p = _params[i];
+    if (p->getID() == NULL) {
+      continue;
     }
-    String value = _server->arg(_params[i]->getID()).c_str();
-    value.toCharArray(_params[i]->_value, _params[i]->_length);
-    DEBUG_WM(F("Parameter"));
-    DEBUG_WM(_params[i]->getID());
-    DEBUG_WM(value);
+    page.write(first ? "{\"id\":\"" : ",{\"id\":\"");
+    first = false;
+    page.writeJsonEscaped(p->getID());
+    page.write(F("\",\"label\":\""));
+    page.writeJsonEscaped(p->getPlaceholder());
+    page.write(F("\",\"value\":\""));
+    page.writeJsonEscaped(p->getValue());
+    page.write(F("\",\"length\":"));
+    page.write((int32_t)p->getValueLength());
+    page.write("}");
+  }
+  page.write("]");
+  page.end();
+}
+#endif
+
+// Form-encoded body with the same fields as /wifisave: s, p and parameter ids.
+// Poll /api/status for the outcome.
+void SimpleWiFiManager::handleApiSave() {
+  WM_METRIC_SCOPE(WM_METRIC_API);
+  // Only the ids present are updated, so a client can change one parameter
+  if (!applySubmittedParams(false)) {
+    _server->send(500, "application/json", "{\"ok\":false,\"connecting\":false}");
+    return;
+  }
+
+  boolean connecting = _server->arg("s") != "";
+  if (connecting) {
+    acceptCredentials(_server->arg("s"), _server->arg("p"));
+  }
+  _server->send(200, "application/json", connecting ? "{\"ok\":true,\"connecting\":true}"
+                                                    : "{\"ok\":true,\"connecting\":false}");
+}
+#endif
+
+void SimpleWiFiManager::handleWifiSave() {
+  WM_METRIC_SCOPE(WM_METRIC_WIFISAVE);
+  WM_LOG_I("WiFi save");
+
+  if (!applySubmittedParams(true)) {
+    _server->send(500, "text/plain", "Out of memory, nothing was saved");
+    return;
   }
 
   if (_server->arg("s") != "") {
-    _ssid = _server->arg("s");
-    _pass = _server->arg("p");
-
-    String page = WebUI::HTTP_HEAD_START;
-    page.replace("{v}", "Credentials Saved");
-    page += WebUI::HTTP_SCRIPT;
-    page += _webUI->getCurrentStyle();
-    page += _customHeadElement;
-    page += WebUI::HTTP_HEAD_END;
-    page += WebUI::HTTP_SAVED;
-    page += WebUI::HTTP_END;
-    _server->sendHeader("Content-Length", String(page.length()));
-    _server->send(200, "text/html", page);
-
-    DEBUG_WM(F("Sent wifi save page"));
-
-    connect = true;
+    PageWriter page(_server.get());
+    page.begin(200, "text/html");
+    writePageHead(page, "Credentials Saved");
+    page.write_P(WebUI::HTTP_SAVED);
+    page.write_P(WebUI::HTTP_END);
+    page.end();
+
+    WM_LOG_I("Sent wifi save page");
+
+    acceptCredentials(_server->arg("s"), _server->arg("p"));
   } else {
-    DEBUG_WM(F("Sent wifi save page"));
+    WM_LOG_I("Sent wifi save page");
   }
 }
 
-void SimpleWiFiManager::handleInfo() {
-  DEBUG_WM(F("Info"));
-
-  String page = WebUI::HTTP_HEAD_START;
-  page.replace("{v}", "Info");
-  page += WebUI::HTTP_SCRIPT;
-  page += _webUI->getCurrentStyle();
-  page += _customHeadElement;
-  page += WebUI::HTTP_HEAD_END;
-  page += F("Chip ID: ");
-  page += ESP.getEfuseMac();
-  page += F("<br/>Flash Chip ID: ");
-  page += ESP.getFlashChipSize();
-  page += F("<br/>IDE Flash Size: ");
-  page += ESP.getFlashChipSize();
-  page += F("<br/>Real Flash Size: ");
-  page += ESP.getFlashChipSize();
-  page += F("<br/>Soft AP IP: ");
-  page += WiFi.softAPIP().toString();
-  page += F("<br/>Soft AP MAC: ");
-  page += WiFi.softAPmacAddress();
-  page += F("<br/>Station MAC: ");
-  page += WiFi.macAddress();
-  page += F("<br/>");
-  page += WebUI::HTTP_END;
-
-  _server->sendHeader("Content-Length", String(page.length()));
-  _server->send(200, "text/html", page);
-
-  DEBUG_WM(F("Sent info page"));
+// Copies the submitted parameter values and stores them when persistence is on.
+// With clearMissing a parameter missing from the request ends up empty, as an
+// unchecked or removed form field would; otherwise it keeps its value.
+// Returns false, changing nothing, when the id table cannot be built.
+boolean SimpleWiFiManager::applySubmittedParams(boolean clearMissing) {
+#if WM_FEATURE_PARAMS
+  if (_paramSlotsStale && !buildParamSlots()) {
+    return false;
+  }
+  if (clearMissing) {
+    for (int i = 0; i < _paramsCount; i++) {
+      if (_params[i]->getID() != NULL) {
+        _params[i]->_value[0] = 0;
+        _params[i]->_stored = NULL;
+      }
+    }
+  }
+  // One pass over the form arguments, each matched through the id table
+  for (int a = 0; a < _server->args(); a++) {
+    int i = findParamSlot(_server->argName(a).c_str());
+    if (i < 0) {
+      continue;
+    }
+    String value = _server->arg(a);
+    value.toCharArray(_params[i]->_value, _params[i]->_length);
+    _params[i]->_stored = NULL;
+    // Values may be secrets, only the id is logged
+    WM_LOG_D("Parameter", _params[i]->getID());
+  }
+  if (_persistParams && _paramsCount > 0) {
+    // Store the form values, then point the parameters at the new blob
+    _paramStore.save(_params, _paramsCount);
+    bindStoredParameters();
+  }
+#endif
+  return true;
 }
 
-void SimpleWiFiManager::handleReset() {
-  DEBUG_WM(F("Reset"));
+// Lets process() try the network. It is added to the store by
+// rememberNetwork() once the attempt succeeded.
+void SimpleWiFiManager::acceptCredentials(const String& ssid, const String& pass) {
+  _ssid = ssid;
+  _pass = pass;
+  connect = true;
+}
 
-  String page = WebUI::HTTP_HEAD_START;
-  page.replace("{v}", "Info");
-  page += WebUI::HTTP_SCRIPT;
-  page += _webUI->getCurrentStyle();
-  page += _customHeadElement;
-  page += WebUI::HTTP_HEAD_END;
-  page += F("Module will reset in a few seconds.");
-  page += WebUI::HTTP_END;
-  _server->sendHeader("Content-Length", String(page.length()));
-  _server->send(200, "text/html", page);
+#if WM_FEATURE_INFO
+void SimpleWiFiManager::handleInfo() {
+  WM_METRIC_SCOPE(WM_METRIC_INFO);
+  WM_LOG_I("Info");
+
+  PageWriter page(_server.get());
+  page.begin(200, "text/html");
+  writePageHead(page, "Info");
+  page.write(F("Chip ID: "));
+  page.write((uint64_t)ESP.getEfuseMac());
+  page.write(F("<br/>Flash Chip ID: "));
+  page.write((uint32_t)ESP.getFlashChipSize());
+  page.write(F("<br/>IDE Flash Size: "));
+  page.write((uint32_t)ESP.getFlashChipSize());
+  page.write(F("<br/>Real Flash Size: "));
+  page.write((uint32_t)ESP.getFlashChipSize());
+  page.write(F("<br/>Soft AP IP: "));
+  char ip[WM_IP_STR_LEN];
+  page.write(ip, formatIp(WiFi.softAPIP(), ip));
+  page.write(F("<br/>Free Heap: "));
+  page.write((uint32_t)ESP.getFreeHeap());
+  page.write(F("<br/>Largest Free Block: "));
+  page.write((uint32_t)ESP.getMaxAllocHeap());
+  page.write(F(" (before portal: "));
+  page.write(_portalLargestBlock);
+  page.write(F(")"));
+  page.write(F("<br/>DNS Queries Answered: "));
+  page.write(_dnsServer->getAnswered());
+  page.write(F(" (retransmissions dropped: "));
+  page.write(_dnsServer->getDropped());
+  page.write(F(")"));
+  page.write(F("<br/>Soft AP MAC: "));
+  page.write(WiFi.softAPmacAddress());
+  page.write(F("<br/>Station MAC: "));
+  page.write(WiFi.macAddress());
+  page.write(F("<br/>"));
+  page.write_P(WebUI::HTTP_END);
+  page.end();
+
+  WM_LOG_I("Sent info page");
+}
+#endif
 
-  DEBUG_WM(F("Sent reset page"));
-  delay(5000);
-  ESP.restart();
-  delay(2000);
+#if WM_FEATURE_RESET
+void SimpleWiFiManager::handleReset() {
+  WM_METRIC_SCOPE(WM_METRIC_RESET);
+  WM_LOG_I("Reset");
+
+  PageWriter page(_server.get());
+  page.begin(200, "text/html");
+  writePageHead(page, "Info");
+  page.write(F("Module will reset in a few seconds."));
+  page.write_P(WebUI::HTTP_END);
+  page.end();
+
+  WM_LOG_I("Sent reset page");
+  // process() restarts the module once the page has had time to arrive
+  _portalState = PORTAL_RESTART;
+  _portalStateChange = millis();
 }
+#endif
 
 void SimpleWiFiManager::handleNotFound() {
+  WM_METRIC_SCOPE(WM_METRIC_NOT_FOUND);
   if (captivePortal()) {
     return;
   }
-  String message = "File Not Found\n\n";
-  message += "URI: ";
-  message += _server->uri();
-  message += "\nMethod: ";
-  message += ( _server->method() == HTTP_GET ) ? "GET" : "POST";
-  message += "\nArguments: ";
-  message += _server->args();
-  message += "\n";
-
-  for ( uint8_t i = 0; i < _server->args(); i++ ) {
-    message += " " + _server->argName ( i ) + ": " + _server->arg ( i ) + "\n";
-  }
   _server->sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
   _server->sendHeader("Pragma", "no-cache");
   _server->sendHeader("Expires", "-1");
-  _server->sendHeader("Content-Length", String(message.length()));
-  _server->send(404, "text/plain", message);
+
+  PageWriter page(_server.get());
+  page.begin(404, "text/plain");
+  page.write(F("File Not Found\n\nURI: "));
+  page.write(_server->uri());
+  page.write(F("\nMethod: "));
+  page.write(( _server->method() == HTTP_GET ) ? "GET" : "POST");
+  page.write(F("\nArguments: "));
+  page.write((int32_t)_server->args());
+  page.write("\n");
+  for ( int i = 0; i < _server->args(); i++ ) {
+    page.write(" ");
+    page.write(_server->argName(i));
+    page.write(": ");
+    page.write(_server->arg(i));
+    page.write("\n");
+  }
+  page.end();
+}
+
+#ifdef WM_METRICS
+void SimpleWiFiManager::handleMetrics() {
+  PageWriter page(_server.get());
+  _server->sendHeader("Cache-Control", "no-cache");
+  page.begin(200, "text/plain; version=0.0.4");
+  WiFiManagerMetrics::write(page);
+  // The DNS responder counts for itself, outside the per-handler table
+  page.write("# TYPE wm_dns_answered_total counter\nwm_dns_answered_total ");
+  page.write(_dnsServer->getAnswered());
+  page.write("\n# TYPE wm_dns_dropped_total counter\nwm_dns_dropped_total ");
+  page.write(_dnsServer->getDropped());
+  page.write("\n");
+  page.end();
 }
 
+const wm_metric_stats_t& SimpleWiFiManager::getMetric(wm_metric_t id) {
+  return WiFiManagerMetrics::get(id);
+}
+#endif
+
+#if WM_FEATURE_THEMES
 void SimpleWiFiManager::handleThemeToggle() {
-  DEBUG_WM(F("Theme toggle"));
+  WM_METRIC_SCOPE(WM_METRIC_THEME);
+  WM_LOG_I("Theme toggle");
   
   int currentTheme = _webUI->getTheme();
   int newTheme = (currentTheme == WM_WEBUI_THEME_LIGHT) ? WM_WEBUI_THEME_DARK : WM_WEBUI_THEME_LIGHT;
@@ -559,26 +1743,25 @@ void SimpleWiFiManager::handleThemeToggle() {
   
   _server->send(200, "text/plain", "Theme toggled");
 }
+#endif
 
+// Runs on every request, so nothing here touches the heap
 boolean SimpleWiFiManager::captivePortal() {
-  if (!isIp(_server->hostHeader()) ) {
-    DEBUG_WM(F("Request redirected to captive portal"));
-    _server->sendHeader("Location", String("http://") + toStringIp(_server->client().localIP()), true);
-    _server->send ( 302, "text/plain", "");
-    _server->client().stop();
+  const char* host = _server->hostName();
+  // Without a Host header there is nothing to correct, and a redirect would
+  // only send the client back here in a loop
+  if (host[0] != '\0' && !isIp(host)) {
+    WM_METRIC_SCOPE(WM_METRIC_CAPTIVE);
+    WM_LOG_I("Request redirected to captive portal");
+    // Bursts of probes from one phone can reuse the same connection
+    char location[7 + WM_IP_STR_LEN] = "http://";
+    formatIp(_server->client().localIP(), location + 7);
+    _server->sendRedirect(location);
     return true;
   }
   return false;
 }
 
-template <typename Generic>
-void SimpleWiFiManager::DEBUG_WM(Generic text) {
-  if (_debug) {
-    Serial.print("*WM: ");
-    Serial.println(text);
-  }
-}
-
 int SimpleWiFiManager::getRSSIasQuality(int RSSI) {
   int quality = 0;
 
@@ -592,23 +1775,53 @@ int SimpleWiFiManager::getRSSIasQuality(int RSSI) {
   return quality;
 }
 
-boolean SimpleWiFiManager::isIp(String str) {
-  for (int i = 0; i < str.length(); i++) {
-    int c = str.charAt(i);
-    if (c != '.' && (c < '0' || c > '9')) {
+// Dotted-quad IPv4 address, optionally followed by ":port"
+boolean SimpleWiFiManager::isIp(const char* str) {
+  for (int octet = 0; octet < 4; octet++) {
+    if (octet > 0 && *str++ != '.') {
+      return false;
+    }
+    int value = 0;
+    int digits = 0;
+    while (*str >= '0' && *str <= '9') {
+      value = value * 10 + (*str++ - '0');
+      if (++digits > 3) {
+        return false;
+      }
+    }
+    if (digits == 0 || value > 255) {
       return false;
     }
   }
-  return true;
+  if (*str == ':') {
+    if (*++str == '\0') {
+      return false;
+    }
+    while (*str >= '0' && *str <= '9') {
+      str++;
+    }
+  }
+  return *str == '\0';
 }
 
-String SimpleWiFiManager::toStringIp(IPAddress ip) {
-  String res = "";
-  for (int i = 0; i < 3; i++) {
-    res += String((ip >> (8 * i)) & 0xFF) + ".";
+// Writes ip into buf (at least WM_IP_STR_LEN bytes). Returns the length.
+size_t SimpleWiFiManager::formatIp(const IPAddress& ip, char* buf) {
+  char* p = buf;
+  for (int i = 0; i < 4; i++) {
+    uint8_t v = ip[i];
+    if (i > 0) {
+      *p++ = '.';
+    }
+    if (v >= 100) {
+      *p++ = '0' + v / 100;
+    }
+    if (v >= 10) {
+      *p++ = '0' + (v / 10) % 10;
+    }
+    *p++ = '0' + v % 10;
   }
-  res += String(((ip >> 8 * 3)) & 0xFF);
-  return res;
+  *p = '\0';
+  return p - buf;
 }
 
 void SimpleWiFiManager::setAPCallback(void (*func)(SimpleWiFiManager*)) {
@@ -627,27 +1840,88 @@ void SimpleWiFiManager::setRemoveDuplicateAPs(boolean removeDuplicates) {
   _removeDuplicateAPs = removeDuplicates;
 }
 
+void SimpleWiFiManager::setFastReconnect(boolean enable) {
+  _fastReconnect = enable;
+}
+
+void SimpleWiFiManager::addNetwork(const char* ssid, const char* pass) {
+  _credentials.add(ssid, pass);
+  _credentials.save();
+}
+
+int SimpleWiFiManager::getNetworkCount() {
+  return _credentials.count();
+}
+
+void SimpleWiFiManager::clearNetworks() {
+  _credentials.clear();
+  _credentials.save();
+}
+
+void SimpleWiFiManager::setHeapBudget(size_t bytes) {
+  _heapBudget = bytes;
+  if (bytes == 0 && !_portalInBlock) {
+    free(_portalBlock);
+    _portalBlock = NULL;
+  }
+}
+
+void SimpleWiFiManager::setDHCPLeaseCache(boolean enable, unsigned long leaseSeconds) {
+  _leaseCache = enable;
+  _leaseSeconds = leaseSeconds;
+}
+
+wm_connect_result_t SimpleWiFiManager::getLastConnectResult() {
+  return _lastConnectResult;
+}
+
+uint8_t SimpleWiFiManager::getLastDisconnectReason() {
+  return _lastDisconnectReason;
+}
+
+unsigned long SimpleWiFiManager::getLastConnectTime() {
+  return _lastConnectTime;
+}
+
+boolean SimpleWiFiManager::wasFastReconnect() {
+  return _lastConnectFast;
+}
+
+void SimpleWiFiManager::setScanCacheTTL(unsigned long seconds) {
+  _scanCache.setTTL(seconds * 1000);
+}
+
 String SimpleWiFiManager::getSSID() {
   if (_ssid == "") {
-    DEBUG_WM(F("Reading SSID"));
+    WM_LOG_I("Reading SSID");
     _ssid = WiFi.SSID();
-    DEBUG_WM(F("SSID: "));
-    DEBUG_WM(_ssid);
+    WM_LOG_I("SSID:", _ssid);
   }
   return _ssid;
 }
 
 String SimpleWiFiManager::getPassword() {
   if (_pass == "") {
-    DEBUG_WM(F("Reading Password"));
+    WM_LOG_I("Reading Password");
     _pass = WiFi.psk();
-    DEBUG_WM(F("Password: "));
-    DEBUG_WM(_pass);
+    WM_LOG_SECRET("Password:");
   }
   return _pass;
 }
 
 void SimpleWiFiManager::setWebUITitle(const char* title) {
-  _webUITitle = title;
+  _settings.setTitle(title);
+}
+
+void SimpleWiFiManager::flushSettings() {
+  _settings.flush();
+}
+
+uint32_t SimpleWiFiManager::getSettingsWriteCount() {
+  return _settings.getWriteCount();
+}
+
+uint32_t SimpleWiFiManager::getSettingsWritesAvoided() {
+  return _settings.getAvoidedWriteCount();
 }
 
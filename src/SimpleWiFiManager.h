@@ -3,19 +3,92 @@
 
 #include <WiFi.h>
 #include <WebServer.h>
-#include <DNSServer.h>
+#include "portalserver.h"
+#include "captivedns.h"
 #include <memory>
+#include "wifiscan.h"
+#include "wificredentials.h"
+#include "wifisettings.h"
+#include "wifiparams.h"
+#include "wifimetrics.h"
+#include "wifilog.h"
+#include "wifievents.h"
+#include "wififeatures.h"
 
 #include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
 #define ESP_getChipId()   ((uint32_t)ESP.getEfuseMac())
 
+// Time allowed for a reconnect to the cached BSSID/channel before falling back to a full scan
+#ifndef WM_FAST_CONNECT_TIMEOUT
+#define WM_FAST_CONNECT_TIMEOUT 5000
+#endif
+
+// Buffer size for a dotted-quad IPv4 address and its terminator
+#define WM_IP_STR_LEN 16
+
+// How long the portal stays up after the new credentials connected, so the
+// page can show the result before the AP goes away
+#ifndef WM_PORTAL_LINGER
+#define WM_PORTAL_LINGER 5000
+#endif
+
+// How long the portal keeps serving after /r before the module restarts
+#ifndef WM_RESET_DELAY
+#define WM_RESET_DELAY 5000
+#endif
+
+// How long the gateway may take to answer a ping before a cached lease is dropped
+#ifndef WM_LEASE_PROBE_TIMEOUT
+#define WM_LEASE_PROBE_TIMEOUT 300
+#endif
+
+// Initial parameter capacity. It doubles as needed unless
+// WIFI_MANAGER_FIXED_PARAMS is defined, in which case it is the hard limit.
 #ifndef WIFI_MANAGER_MAX_PARAMS
 #define WIFI_MANAGER_MAX_PARAMS 10
 #endif
 
-// WebUI Theme constants
-#define WM_WEBUI_THEME_LIGHT 0
-#define WM_WEBUI_THEME_DARK  1
+// Size of each block of the arena that holds parameter values
+#ifndef WM_PARAM_ARENA_BLOCK
+#define WM_PARAM_ARENA_BLOCK 256
+#endif
+
+// Heap budget mode (setHeapBudget): render buffer reserved together with the
+// portal objects. Holds the largest page the portal renders without parameters,
+// /wifi listing WM_BUDGET_SCAN_RECORDS networks whose names escape to six bytes a
+// character (5045 bytes, measured by extras/tests/test_budget.cpp)
+#ifndef WM_RENDER_BUFFER_SIZE
+#define WM_RENDER_BUFFER_SIZE 5120
+#endif
+
+// Heap budget mode: scan records kept, and list rows shown once half the budget is used
+#ifndef WM_BUDGET_SCAN_RECORDS
+#define WM_BUDGET_SCAN_RECORDS 16
+#endif
+#ifndef WM_BUDGET_SCAN_ITEMS
+#define WM_BUDGET_SCAN_ITEMS 6
+#endif
+
+// Reconnect supervisor states, low byte of getSupervisorStatus()
+#define WM_SUPERVISOR_STOPPED     0
+#define WM_SUPERVISOR_CONNECTED   1
+#define WM_SUPERVISOR_BACKOFF     2
+#define WM_SUPERVISOR_CONNECTING  3
+#define WM_SUPERVISOR_PORTAL      4
+
+// Fields of the supervisor status word
+#define WM_SUPERVISOR_STATE(status)    ((uint8_t)((status) & 0xFF))
+#define WM_SUPERVISOR_ATTEMPTS(status) ((uint8_t)(((status) >> 8) & 0xFF))
+#define WM_SUPERVISOR_RESULT(status)   ((wm_connect_result_t)(int8_t)(((status) >> 16) & 0xFF))
+
+#ifndef WM_SUPERVISOR_STACK_SIZE
+#define WM_SUPERVISOR_STACK_SIZE 6144
+#endif
 
 // WiFiManagerParameter class
 class WiFiManagerParameter {
@@ -23,6 +96,13 @@ class WiFiManagerParameter {
     WiFiManagerParameter(const char *custom);
     WiFiManagerParameter(const char *id, const char *placeholder, const char *defaultValue, int length);
     WiFiManagerParameter(const char *id, const char *placeholder, const char *defaultValue, int length, const char *custom);
+    ~WiFiManagerParameter();
+
+    // Owns its value buffer until added to a manager. From then on the value
+    // lives in the manager: read it before the manager is destroyed. The
+    // manager does not touch the parameter on destruction, so either may go first.
+    WiFiManagerParameter(const WiFiManagerParameter&) = delete;
+    WiFiManagerParameter& operator=(const WiFiManagerParameter&) = delete;
 
     const char *getID();
     const char *getValue();
@@ -42,15 +122,19 @@ class WiFiManagerParameter {
   public:
     char       *_value;
     int        _length;
+    const char *_stored;    // persisted value in the manager's parameter blob, or NULL
+    bool       _owned;      // false once _value lives in a manager's arena
 };
 
 // Forward declaration for WebUI class
 class WebUI;
+class PageWriter;
 
 class SimpleWiFiManager
 {
   public:
-    SimpleWiFiManager();
+    // Inline, so the feature check refers to the sketch's flags (see wififeatures.h)
+    SimpleWiFiManager() : SimpleWiFiManager(WM_CONFIG_SYMBOL) {}
     ~SimpleWiFiManager();
 
     boolean       autoConnect();
@@ -59,6 +143,13 @@ class SimpleWiFiManager
     boolean       startConfigPortal();
     boolean       startConfigPortal(char const *apName, char const *apPassword = NULL);
 
+    // Non-blocking config portal: call process() from loop() until it returns false
+    boolean       startConfigPortalAsync();
+    boolean       startConfigPortalAsync(char const *apName, char const *apPassword = NULL);
+    boolean       process();
+    void          stopConfigPortal();
+    boolean       isConfigPortalActive();
+
     String        getConfigPortalSSID();
     String        getSSID();
     String        getPassword();
@@ -66,49 +157,193 @@ class SimpleWiFiManager
 
     void          setConnectTimeout(unsigned long seconds);
     void          setConfigPortalTimeout(unsigned long seconds);
+    void          setProcessBudget(unsigned long milliseconds);
 
     void          setDebugOutput(boolean debug);
+    // Log records are queued and printed by process()/autoConnect(), flushLog(),
+    // or, once started, a low-priority task
+    boolean       startLogTask(UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY);
+    void          flushLog();
     void          setMinimumSignalQuality(int quality = 8);
     void          setAPStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn);
     void          setSTAStaticIPConfig(IPAddress ip, IPAddress gw, IPAddress sn);
     void          setAPCallback( void (*func)(SimpleWiFiManager*) );
     void          setSaveConfigCallback( void (*func)(void) );
-    void          addParameter(WiFiManagerParameter *p);
+    boolean       addParameter(WiFiManagerParameter *p);
+    // Opt-in: keep parameter values in NVS and restore them in addParameter()
+    void          setPersistParameters(boolean enable);
     void          setBreakAfterConfig(boolean shouldBreak);
     void          setCustomHeadElement(const char* element);
     void          setRemoveDuplicateAPs(boolean removeDuplicates);
+    void          setFastReconnect(boolean enable);
+    void          setDHCPLeaseCache(boolean enable, unsigned long leaseSeconds = 3600);
+    // Opt-in heap budget mode. The portal objects and one render buffer are
+    // reserved in a single block on the first portal start and reused after.
+    // Once the portal has taken more than bytes of heap, the scan list is cut
+    // short and then left out. 0 (default) turns the mode off.
+    void          setHeapBudget(size_t bytes);
+
+#ifdef WM_METRICS
+    // Counters, latency histogram and bytes for one handler or operation
+    const wm_metric_stats_t& getMetric(wm_metric_t id);
+#endif
+
+    // Background task that keeps the station connected after autoConnect().
+    // While it runs, other tasks may call getSupervisorStatus(), and process()
+    // and stopConfigPortal() to serve or close a portal the supervisor opened;
+    // those two are serialised with the task. Nothing else, and in particular
+    // no startConfigPortal*() of their own.
+    boolean       startReconnectSupervisor(BaseType_t core = 1, UBaseType_t priority = 1, unsigned long portalAfterSeconds = 0);
+    void          stopReconnectSupervisor();
+    void          setReconnectBackoff(unsigned long minSeconds, unsigned long maxSeconds);
+    uint32_t      getSupervisorStatus();
+
+    // Known networks tried by autoConnect() when the last one is out of range
+    void          addNetwork(const char* ssid, const char* pass);
+    int           getNetworkCount();
+    void          clearNetworks();
+
+    // Connection metrics of the last successful connect
+    unsigned long getLastConnectTime();
+    boolean       wasFastReconnect();
+    wm_connect_result_t getLastConnectResult();
+    uint8_t       getLastDisconnectReason();
+    void          setScanCacheTTL(unsigned long seconds);
 
     // テーマ関連の新しいメソッド
     void          setWebUITheme(int theme);
     int           getWebUITheme();
     void          setWebUITitle(const char* title);
+    // Theme and title are kept in RAM. While process() runs they are written
+    // to NVS a few seconds after the last change; they are also written when
+    // the portal closes, on resetSettings(), when the manager is destroyed and
+    // on flushSettings(). Call it before restarting the chip yourself.
+    void          flushSettings();
+    uint32_t      getSettingsWriteCount();
+    uint32_t      getSettingsWritesAvoided();
 
   private:
-    std::unique_ptr<DNSServer>        _dnsServer;
-    std::unique_ptr<WebServer>        _server;
+    // Called by the inline constructor with the symbol of the sketch's flags
+    explicit SimpleWiFiManager(const char& config);
+#ifdef WM_HOST_TEST
+    // Lets the host tests in extras/tests reach the portal internals
+    friend struct SimpleWiFiManagerTest;
+#endif
+
+    // Last successful association, persisted so the next connect can skip the scan
+    struct FastConnectInfo {
+      char    ssid[33];
+      uint8_t bssid[6];
+      uint8_t channel;
+    };
+
+    // Address obtained by DHCP, reused on the next boot within the lease window
+    struct LeaseInfo {
+      char     ssid[33];
+      uint32_t ip;
+      uint32_t gateway;
+      uint32_t subnet;
+      uint32_t dns;
+      uint32_t obtainedAt;    // time(NULL) when stored
+      uint32_t leaseSeconds;
+    };
+
+    enum PortalState {
+      PORTAL_IDLE,
+      PORTAL_SERVING,
+      PORTAL_CONNECT_WAIT,
+      PORTAL_CONNECTING,
+      PORTAL_CONNECTED,
+      PORTAL_RESTART
+    };
+
+    std::unique_ptr<CaptiveDNSServer> _dnsServer;
+    std::unique_ptr<PortalServer>     _server;
+
+    // Storage for the portal objects in heap budget mode
+    struct PortalBlock;
+    PortalBlock*  _portalBlock            = NULL;
+    boolean       _portalInBlock          = false;
+    size_t        _heapBudget             = 0;
+    uint32_t      _portalFreeHeap         = 0;    // free heap before the portal objects
+    uint32_t      _portalLargestBlock     = 0;    // largest free block before it
 
     // WebUI object
     WebUI* _webUI;
 
+    WiFiScanCache _scanCache;
+    WiFiCredentialStore _credentials;
+
     void          setupConfigPortal();
+    boolean       openConfigPortal();
+    boolean       createPortalObjects();
+    void          releasePortalObjects();
+    int           scanListLimit();
     void          startWPS();
     
     // Handler methods
     void          handleRoot();
     void          handleWifi(boolean scan);
     void          handleWifiSave();
+    // Handlers of optional pages are only defined when their WM_FEATURE_* is
+    // on (see wififeatures.h); the class layout is the same in every build
     void          handleInfo();
     void          handleReset();
     void          handleNotFound();
     void          handleThemeToggle();
-
-    const char*   _apName                 = "no-net";
-    const char*   _apPassword             = NULL;
+#ifdef WM_METRICS
+    void          handleMetrics();
+#endif
+    void          handleScanJson();
+    // JSON provisioning API under /api
+    void          handleApiScan();
+    void          handleApiStatus();
+    void          handleApiParams();
+    void          handleApiSave();
+    void          writeScanJson(PageWriter& page);
+    boolean       applySubmittedParams(boolean clearMissing);
+    void          acceptCredentials(const String& ssid, const String& pass);
+    int           getScanOrder(int *indices);
+    void          writePageHead(PageWriter& page, const char* title);
+
+    String        _apName                 = "no-net";
+    String        _apPassword             = "";
     String        _ssid                   = "";
     String        _pass                   = "";
     unsigned long _configPortalTimeout    = 0;
     unsigned long _connectTimeout         = 60000;
     unsigned long _configPortalStart      = 0;
+    unsigned long _processBudget          = 0;
+    PortalState   _portalState            = PORTAL_IDLE;
+    unsigned long _portalStateChange      = 0;
+    unsigned long _connectStart           = 0;
+    unsigned long _connectAttemptTimeout  = 0;
+    unsigned long _lastConnectTime        = 0;
+    boolean       _lastConnectFast        = false;
+    boolean       _fastReconnect          = true;
+
+    // Set from the WiFi event task, waited on by the connect functions
+    EventGroupHandle_t _connectEvents     = NULL;
+    wifi_event_id_t _eventHandlerId       = 0;
+    volatile uint8_t _lastDisconnectReason = 0;
+    uint8_t       _handshakeTimeouts      = 0;    // of the current attempt, counted in onWiFiEvent()
+    wm_connect_result_t _lastConnectResult = WM_CONNECT_SKIPPED;
+    // Station config from before an attempt with unverified credentials
+    wifi_config_t _stationConf;
+    boolean       _stationConfPending     = false;
+
+    TaskHandle_t  _supervisorTask         = NULL;
+    volatile boolean _supervisorStop      = false;
+    std::atomic<uint32_t> _supervisorStatus;
+    // Serialises the portal between the supervisor and the sketch's loop;
+    // created with the supervisor
+    SemaphoreHandle_t _portalLock         = NULL;
+    unsigned long _portalAfterOutage      = 0;
+    unsigned long _backoffMin             = 1000;
+    unsigned long _backoffMax             = 60000;
+    boolean       _leaseCache             = false;
+    unsigned long _leaseSeconds           = 3600;
+    boolean       _leaseApplied           = false;
 
     IPAddress     _ap_static_ip;
     IPAddress     _ap_static_gw;
@@ -117,18 +352,35 @@ class SimpleWiFiManager
     IPAddress     _sta_static_gw;
     IPAddress     _sta_static_sn;
 
-    int           _paramsCount            = 0;
     int           _minimumQuality         = -1;
     boolean       _removeDuplicateAPs     = true;
     boolean       _shouldBreakAfterConfig = false;
     boolean       _tryWPS                 = false;
 
     const char*   _customHeadElement      = "";
-    const char*   _webUITitle             = "SimpleWiFiManager";
+    WiFiSettingsStore _settings;
 
     int           status = WL_IDLE_STATUS;
-    int           connectWifi(String ssid, String pass);
-    uint8_t       waitForConnectResult();
+    wm_connect_result_t connectWifi(String ssid, String pass);
+    void          beginConnect(String ssid, String pass, boolean keepAP = false);
+    void          settleStationConfig(boolean connected);
+    wm_connect_result_t checkConnectResult();
+    wm_connect_result_t waitForConnectResult();
+    void          registerEventHandler();
+    void          onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info);
+    static void   supervisorTask(void *arg);
+    void          runSupervisor();
+    unsigned long backoffDelay(uint8_t attempts);
+    void          setSupervisorStatus(uint8_t state, uint8_t attempts, wm_connect_result_t result);
+    wm_connect_result_t tryFastReconnect(wifi_config_t *conf);
+    void          clearBssidPin();
+    void          saveFastConnectInfo();
+    wm_connect_result_t connectKnownNetworks();
+    void          rememberNetwork();
+    boolean       applyCachedLease();
+    void          dropCachedLease();
+    void          saveLeaseInfo();
+    boolean       gatewayResponds();
 
     boolean       captivePortal();
     boolean       configPortalHasTimeout();
@@ -136,26 +388,43 @@ class SimpleWiFiManager
     const byte    DNS_PORT = 53;
 
     int           getRSSIasQuality(int RSSI);
-    boolean       isIp(String str);
-    String        toStringIp(IPAddress ip);
+    static boolean isIp(const char* str);
+    static size_t  formatIp(const IPAddress& ip, char* buf);
 
-    boolean       connect;
-    boolean       _debug = true;
+    boolean       connect                 = false;
 
     void (*_apcallback)(SimpleWiFiManager*) = NULL;
     void (*_savecallback)(void) = NULL;
 
-    WiFiManagerParameter* _params[WIFI_MANAGER_MAX_PARAMS];
-
-    template <typename Generic>
-    void          DEBUG_WM(Generic text);
+    void          bindStoredParameters();
+    char*         paramArenaAlloc(size_t size);
+    boolean       buildParamSlots();
+    int           findParamSlot(const char* id);
+
+    // Parameter values are copied into a chain of arena blocks owned by the manager
+    struct ParamArenaBlock {
+      ParamArenaBlock* next;
+      size_t           size;
+      size_t           used;
+    };
+
+    WiFiManagerParameter** _params        = NULL;
+    int           _paramsCapacity         = 0;
+    ParamArenaBlock* _paramArena          = NULL;
+    // Open-addressed id -> index table for handleWifiSave(), rebuilt after addParameter()
+    int16_t*      _paramSlots             = NULL;
+    int           _paramSlotsMask         = 0;
+    boolean       _paramSlotsStale        = true;
+    int           _paramsCount            = 0;
+    WiFiParameterStore _paramStore;
+    boolean       _persistParams          = false;
 
     template <class T>
     auto optionalIPFromString(T *obj, const char *s) -> decltype(  obj->fromString(s)  ) {
       return  obj->fromString(s);
     }
     auto optionalIPFromString(...) -> bool {
-      DEBUG_WM("NO fromString METHOD ON IPAddress, you need a core new enough for Custom IP configuration to work.");
+      WM_LOG_W("NO fromString METHOD ON IPAddress, you need a core new enough for Custom IP configuration to work.");
       return false;
     }
 };
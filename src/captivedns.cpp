@@ -0,0 +1,137 @@
+#include "captivedns.h"
+#include "wifimetrics.h"
+
+#define DNS_HEADER_SIZE 12
+#define DNS_TYPE_A      1
+#define DNS_TYPE_ANY    255
+#define DNS_CLASS_IN    1
+#define DNS_ANSWER_TTL  60
+
+CaptiveDNSServer::CaptiveDNSServer() : _running(false), _recentNext(0), _answered(0), _dropped(0) {
+    memset(_recent, 0, sizeof(_recent));
+}
+
+bool CaptiveDNSServer::start(uint16_t port, const IPAddress& ip) {
+    // Name pointer to the question at offset 12, type A, class IN, TTL, 4 byte address
+    const uint8_t answer[16] = {
+        0xC0, 0x0C,
+        0x00, DNS_TYPE_A,
+        0x00, DNS_CLASS_IN,
+        0x00, 0x00, 0x00, DNS_ANSWER_TTL,
+        0x00, 0x04,
+        ip[0], ip[1], ip[2], ip[3]
+    };
+    memcpy(_answer, answer, sizeof(_answer));
+    memset(_recent, 0, sizeof(_recent));
+
+    _running = _udp.begin(port) == 1;
+    return _running;
+}
+
+void CaptiveDNSServer::stop() {
+    if (_running) {
+        _udp.stop();
+        _running = false;
+    }
+}
+
+int CaptiveDNSServer::processRequests(int maxPackets) {
+    if (!_running) {
+        return 0;
+    }
+    int handled = 0;
+    while (handled < maxPackets) {
+        int len = _udp.parsePacket();
+        if (len <= 0) {
+            break;
+        }
+        handlePacket(len);
+        handled++;
+    }
+    return handled;
+}
+
+bool CaptiveDNSServer::isRetransmission(uint32_t ip, uint16_t port, uint16_t id) {
+    unsigned long now = millis();
+    for (int i = 0; i < 8; i++) {
+        const RecentQuery& q = _recent[i];
+        if (q.ip == ip && q.port == port && q.id == id && now - q.time < WM_DNS_DUP_WINDOW) {
+            return true;
+        }
+    }
+    RecentQuery& q = _recent[_recentNext];
+    _recentNext = (_recentNext + 1) & 7;
+    q.ip = ip;
+    q.port = port;
+    q.id = id;
+    q.time = now;
+    return false;
+}
+
+void CaptiveDNSServer::handlePacket(int len) {
+    WM_METRIC_SCOPE(WM_METRIC_DNS);
+    if (len > WM_DNS_MAX_PACKET || len < DNS_HEADER_SIZE) {
+        _udp.flush();
+        _dropped++;
+        return;
+    }
+    _udp.read(_packet, len);
+
+    // Standard queries with exactly one question only
+    uint8_t* p = _packet;
+    bool isQuery = (p[2] & 0x80) == 0 && ((p[2] >> 3) & 0x0F) == 0;
+    if (!isQuery || p[4] != 0 || p[5] != 1) {
+        _dropped++;
+        return;
+    }
+
+    // Walk the question name to find where the question ends
+    int pos = DNS_HEADER_SIZE;
+    while (pos < len && p[pos] != 0) {
+        if ((p[pos] & 0xC0) != 0) {
+            _dropped++;
+            return;
+        }
+        pos += p[pos] + 1;
+    }
+    pos++;
+    if (pos + 4 > len) {
+        _dropped++;
+        return;
+    }
+    uint16_t type = (p[pos] << 8) | p[pos + 1];
+    pos += 4;
+
+    // Only a query that would be answered is remembered, so a malformed
+    // packet cannot shadow a valid one with the same id
+    uint16_t id = (p[0] << 8) | p[1];
+    if (isRetransmission((uint32_t)_udp.remoteIP(), _udp.remotePort(), id)) {
+        _dropped++;
+        return;
+    }
+
+    // Reuse the query as the reply: header, question, then the prebuilt answer
+    bool answer = (type == DNS_TYPE_A || type == DNS_TYPE_ANY);
+    p[2] = 0x80 | (p[2] & 0x01);   // QR, keep RD
+    p[3] = 0x80;                    // RA, NOERROR
+    p[6] = 0;
+    p[7] = answer ? 1 : 0;
+    p[8] = p[9] = p[10] = p[11] = 0;
+
+    _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+    _udp.write(p, pos);
+    if (answer) {
+        _udp.write(_answer, sizeof(_answer));
+    }
+    _udp.endPacket();
+    _answered++;
+    WM_METRIC_BYTES(pos + (answer ? sizeof(_answer) : 0));
+}
+
+uint32_t CaptiveDNSServer::getAnswered() {
+    return _answered;
+}
+
+uint32_t CaptiveDNSServer::getDropped() {
+    return _dropped;
+}
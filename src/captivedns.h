@@ -0,0 +1,55 @@
+#ifndef CaptiveDNSServer_h
+#define CaptiveDNSServer_h
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+// Packets answered per processRequests() call
+#ifndef WM_DNS_BATCH
+#define WM_DNS_BATCH 16
+#endif
+
+// A query with the same client, port and id within this window is a retransmission
+#ifndef WM_DNS_DUP_WINDOW
+#define WM_DNS_DUP_WINDOW 200
+#endif
+
+#define WM_DNS_MAX_PACKET 512
+
+// Captive portal DNS responder. Every A query is answered with the portal IP
+// from a prebuilt answer record, other query types get an empty NOERROR reply.
+class CaptiveDNSServer {
+public:
+    CaptiveDNSServer();
+
+    bool   start(uint16_t port, const IPAddress& ip);
+    void   stop();
+
+    // Drains up to maxPackets queued queries. Returns the number handled.
+    int    processRequests(int maxPackets = WM_DNS_BATCH);
+
+    uint32_t getAnswered();
+    uint32_t getDropped();
+
+private:
+    struct RecentQuery {
+        uint32_t      ip;
+        uint16_t      port;
+        uint16_t      id;
+        unsigned long time;
+    };
+
+    bool   isRetransmission(uint32_t ip, uint16_t port, uint16_t id);
+    void   handlePacket(int len);
+
+    WiFiUDP     _udp;
+    bool        _running;
+    uint8_t     _answer[16];
+    uint8_t     _packet[WM_DNS_MAX_PACKET];
+    RecentQuery _recent[8];
+    uint8_t     _recentNext;
+    uint32_t    _answered;
+    uint32_t    _dropped;
+};
+
+#endif
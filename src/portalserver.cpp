@@ -0,0 +1,241 @@
+#include "portalserver.h"
+#include "wifimetrics.h"
+#include <lwip/sockets.h>
+
+// FNV-1a, evaluated at compile time for the table below
+static constexpr uint32_t probeHash(const char* s, uint32_t hash = 2166136261UL) {
+    return *s ? probeHash(s + 1, (hash ^ (uint8_t)*s) * 16777619UL) : hash;
+}
+
+struct ProbePath {
+    uint32_t    hash;
+    const char* path;
+    uint8_t     family;
+};
+
+#define WM_PROBE(path, family) { probeHash(path), path, family }
+
+static const ProbePath PROBES[] = {
+    WM_PROBE("/generate_204",               WM_PROBE_ANDROID),
+    WM_PROBE("/gen_204",                    WM_PROBE_ANDROID),
+    WM_PROBE("/hotspot-detect.html",        WM_PROBE_APPLE),
+    WM_PROBE("/library/test/success.html",  WM_PROBE_APPLE),
+    WM_PROBE("/connecttest.txt",            WM_PROBE_WINDOWS),
+    WM_PROBE("/ncsi.txt",                   WM_PROBE_WINDOWS),
+    WM_PROBE("/redirect",                   WM_PROBE_WINDOWS),
+    WM_PROBE("/success.txt",                WM_PROBE_OTHER),
+    WM_PROBE("/canonical.html",             WM_PROBE_OTHER),
+    WM_PROBE("/check_network_status.txt",   WM_PROBE_OTHER),
+    WM_PROBE("/kindle-wifi/wifistub.html",  WM_PROBE_OTHER),
+};
+
+PortalServer::PortalServer(int port) : WebServer(port), _next(0), _keepAlive(false) {
+    for (uint8_t i = 0; i < WM_PORTAL_CLIENTS; i++) {
+        _slots[i].since = 0;
+        _slots[i].requests = 0;
+        _slots[i].pending = false;
+    }
+    _probeReplyLength[0] = 0;
+    _probeReplyLength[1] = 0;
+}
+
+PortalServer::~PortalServer() {
+    for (uint8_t i = 0; i < WM_PORTAL_CLIENTS; i++) {
+        release(_slots[i]);
+    }
+}
+
+void PortalServer::close() {
+    for (uint8_t i = 0; i < WM_PORTAL_CLIENTS; i++) {
+        release(_slots[i]);
+    }
+    WebServer::close();
+}
+
+void PortalServer::handleClient() {
+    acceptClients();
+
+    unsigned long now = millis();
+    for (uint8_t n = 0; n < WM_PORTAL_CLIENTS; n++) {
+        Slot& slot = _slots[(_next + n) % WM_PORTAL_CLIENTS];
+        if (!slot.client) {
+            continue;
+        }
+        if (requestReady(slot)) {
+            serve(slot);
+            now = millis();
+        } else {
+            // A new connection gets the core's full wait for its first request
+            unsigned long limit = slot.requests ? WM_PORTAL_KEEPALIVE_TIMEOUT : HTTP_MAX_DATA_WAIT;
+            if (!slot.client.connected() || now - slot.since > limit) {
+                release(slot);
+            }
+        }
+    }
+    _next = (_next + 1) % WM_PORTAL_CLIENTS;
+    // Unlike WebServer::handleClient() there is no delay(1) when idle: the
+    // caller's loop decides how long to sleep between slices
+}
+
+void PortalServer::acceptClients() {
+    for (uint8_t i = 0; i < WM_PORTAL_CLIENTS; i++) {
+        Slot& slot = _slots[i];
+        if (slot.client) {
+            continue;
+        }
+        WiFiClient client = _server.available();
+        if (!client) {
+            return;
+        }
+        slot.client = client;
+        slot.since = millis();
+        slot.requests = 0;
+        slot.pending = false;
+    }
+}
+
+// True once the request head ends within the peeked bytes, followed by its
+// Content-Length of body
+static bool requestComplete(const char* buf, int len) {
+    for (int i = 3; i < len; i++) {
+        if (buf[i] != '\n' || buf[i - 1] != '\r' || buf[i - 2] != '\n' || buf[i - 3] != '\r') {
+            continue;
+        }
+        int head = i + 1;
+        long body = 0;
+        for (int j = 0; j + 16 < head; j++) {
+            if (buf[j] == '\n' && strncasecmp(buf + j + 1, "Content-Length:", 15) == 0) {
+                body = strtol(buf + j + 16, NULL, 10);
+                break;
+            }
+        }
+        return body >= 0 && body <= len - head;
+    }
+    return false;
+}
+
+// Looks at the socket without reading from it. available() would move the
+// bytes into the client object, where a later peek can no longer see them.
+bool PortalServer::requestReady(Slot& slot) {
+    if (slot.pending) {
+        return true;
+    }
+    char buf[WM_PORTAL_PEEK_SIZE];
+    int n = recv(slot.client.fd(), buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT);
+    if (n <= 0) {
+        return false;
+    }
+    // A request that fills the whole window is left to the parser
+    return n == (int)sizeof(buf) || requestComplete(buf, n);
+}
+
+// Mirrors the HC_WAIT_READ step of WebServer::handleClient() for one pooled client
+void PortalServer::serve(Slot& slot) {
+    _currentClient = slot.client;
+    _currentStatus = HC_WAIT_READ;
+    _statusChange = millis();
+    _keepAlive = false;
+
+#ifdef WM_METRICS
+    uint32_t start = micros();
+#endif
+    if (_parseRequest(_currentClient)) {
+        _currentClient.setTimeout(HTTP_MAX_SEND_WAIT / 1000);
+        int probe = _probeReplyLength[0] ? findProbe(_currentUri.c_str()) : -1;
+        if (probe >= 0) {
+            _keepAlive = wantsKeepAlive();
+            _currentClient.write((const uint8_t*)_probeReply[_keepAlive], _probeReplyLength[_keepAlive]);
+            _currentUri = "";
+            WM_METRIC_RECORD((wm_metric_t)(WM_METRIC_PROBE_ANDROID + probe), micros() - start);
+        } else {
+            _contentLength = CONTENT_LENGTH_NOT_SET;
+            _handleRequest();
+        }
+    }
+
+    if (_keepAlive && _currentClient.connected()) {
+        slot.since = millis();
+        slot.requests++;
+        // A pipelined request may already sit in the client's buffer
+        slot.pending = _currentClient.available() > 0;
+    } else {
+        release(slot);
+    }
+
+    _currentClient = WiFiClient();
+    _currentStatus = HC_NONE;
+    _currentUpload.reset();
+}
+
+void PortalServer::release(Slot& slot) {
+    if (slot.client) {
+        slot.client.stop();
+    }
+    slot.client = WiFiClient();
+    slot.requests = 0;
+    slot.pending = false;
+}
+
+// Reads the collected headers in place; header() would copy the value
+bool PortalServer::wantsKeepAlive() {
+    if (_currentVersion != 1) {
+        return false;
+    }
+    for (int i = 0; i < _headerKeysCount; i++) {
+        if (strcasecmp(_currentHeaders[i].key.c_str(), "Connection") == 0) {
+            return strcasecmp(_currentHeaders[i].value.c_str(), "close") != 0;
+        }
+    }
+    return true;
+}
+
+void PortalServer::sendRedirect(const char* location) {
+    _keepAlive = wantsKeepAlive();
+
+    char head[192];
+    int len = snprintf(head, sizeof(head),
+                       "HTTP/1.%u 302 Found\r\nLocation: %s\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+                       (unsigned)_currentVersion, location, _keepAlive ? "keep-alive" : "close");
+    if (len < 0 || len >= (int)sizeof(head)) {
+        // Unusually long location: let the regular path build it
+        _keepAlive = false;
+        sendHeader("Location", location, true);
+        send(302, "text/plain", "");
+        return;
+    }
+    _currentClient.write((const uint8_t*)head, len);
+}
+
+uint8_t PortalServer::openClients() {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < WM_PORTAL_CLIENTS; i++) {
+        if (_slots[i].client) {
+            n++;
+        }
+    }
+    return n;
+}
+
+void PortalServer::setProbeRedirect(const IPAddress& ip) {
+    for (int keepAlive = 0; keepAlive < 2; keepAlive++) {
+        int len = snprintf(_probeReply[keepAlive], WM_PROBE_REPLY_SIZE,
+                           "HTTP/1.1 302 Found\r\nLocation: http://%u.%u.%u.%u/\r\n"
+                           "Cache-Control: no-store\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+                           ip[0], ip[1], ip[2], ip[3], keepAlive ? "keep-alive" : "close");
+        _probeReplyLength[keepAlive] = (len > 0 && len < WM_PROBE_REPLY_SIZE) ? len : 0;
+    }
+}
+
+int PortalServer::findProbe(const char* path) {
+    // Same hash as probeHash(), without recursion on long request paths
+    uint32_t hash = 2166136261UL;
+    for (const char* p = path; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619UL;
+    }
+    for (size_t i = 0; i < sizeof(PROBES) / sizeof(PROBES[0]); i++) {
+        if (PROBES[i].hash == hash && strcmp(PROBES[i].path, path) == 0) {
+            return PROBES[i].family;
+        }
+    }
+    return -1;
+}
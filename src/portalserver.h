@@ -0,0 +1,89 @@
+#ifndef PortalServer_h
+#define PortalServer_h
+
+#include <WebServer.h>
+
+// Client connections served side by side. Further connections wait in the
+// listen backlog until a slot frees up.
+#ifndef WM_PORTAL_CLIENTS
+#define WM_PORTAL_CLIENTS 4
+#endif
+
+// How long a kept-alive connection may sit idle before it is closed
+#ifndef WM_PORTAL_KEEPALIVE_TIMEOUT
+#define WM_PORTAL_KEEPALIVE_TIMEOUT 2000
+#endif
+
+// Bytes peeked from a connection to see whether its request has fully arrived
+#ifndef WM_PORTAL_PEEK_SIZE
+#define WM_PORTAL_PEEK_SIZE 1024
+#endif
+
+#define WM_PROBE_REPLY_SIZE 128
+
+// Probe families, used to label the probe latency metrics
+#define WM_PROBE_ANDROID 0
+#define WM_PROBE_APPLE   1
+#define WM_PROBE_WINDOWS 2
+#define WM_PROBE_OTHER   3
+
+// WebServer that holds a small pool of client connections instead of one.
+// Each handleClient() call serves at most one request per connection, starting
+// from a rotating slot. A connection is only handed to the core's parser once
+// its request head, and a body of up to WM_PORTAL_PEEK_SIZE bytes, has arrived,
+// so a slow client no longer holds up the others. Larger bodies are still read
+// by the parser with its own timeout. Responses written with sendRedirect() keep
+// the connection open for further requests; everything sent through the regular
+// send() path still carries the core's "Connection: close".
+//
+// Once setProbeRedirect() was called, requests for the connectivity check
+// paths of common operating systems (/generate_204, /hotspot-detect.html,
+// /connecttest.txt, ...) are answered with a prebuilt redirect before the
+// handler chain runs, so the phone shows the portal sheet straight away.
+class PortalServer : public WebServer {
+public:
+    PortalServer(int port = 80);
+    virtual ~PortalServer();
+
+    virtual void handleClient() override;
+    virtual void close() override;
+
+    // Writes a bodyless 302 directly to the client. The connection is kept
+    // open when the request was HTTP/1.1 without "Connection: close".
+    void sendRedirect(const char* location);
+
+    // Prebuilds the redirect to http://ip/ sent for OS connectivity probes
+    void setProbeRedirect(const IPAddress& ip);
+
+    // Family of a known probe path, or -1
+    static int findProbe(const char* path);
+
+    // Host header of the current request, without copying it
+    const char* hostName() { return _hostHeader.c_str(); }
+
+    uint8_t openClients();
+
+private:
+    struct Slot {
+        WiFiClient    client;
+        unsigned long since;      // accept time or end of the last response
+        uint16_t      requests;
+        bool          pending;    // bytes already buffered by the client object
+    };
+
+    void acceptClients();
+    bool requestReady(Slot& slot);
+    void serve(Slot& slot);
+    void release(Slot& slot);
+    bool wantsKeepAlive();
+
+    Slot    _slots[WM_PORTAL_CLIENTS];
+    uint8_t _next;
+    bool    _keepAlive;
+
+    // [0] closes the connection, [1] keeps it alive
+    char    _probeReply[2][WM_PROBE_REPLY_SIZE];
+    uint8_t _probeReplyLength[2];
+};
+
+#endif
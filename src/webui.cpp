@@ -1,28 +1,55 @@
 #include "webui.h"
+#include "wififeatures.h"
 #include <WiFi.h>
-#include <Preferences.h>
+#include "wifimetrics.h"
 
-// HTML content strings
-const char WebUI::LIGHT_BACKGROUND_COLOR[] PROGMEM = "#FFFFFF";
-const char WebUI::LIGHT_TEXT_COLOR[] PROGMEM = "#333333";
-const char WebUI::LIGHT_BUTTON_COLOR[] PROGMEM = "#1fa3ec";
-const char WebUI::LIGHT_BUTTON_TEXT_COLOR[] PROGMEM = "#fff";
+// Theme colors, compiled into the stylesheets by tools/build_assets.py
+#define WM_LIGHT_BACKGROUND_COLOR   "#FFFFFF"
+#define WM_LIGHT_TEXT_COLOR         "#333333"
+#define WM_LIGHT_BUTTON_COLOR       "#1fa3ec"
+#define WM_LIGHT_BUTTON_TEXT_COLOR  "#fff"
+#define WM_LIGHT_SLIDER_COLOR       "#ccc"
+#define WM_LIGHT_SLIDER_ON_COLOR    "#28a745"
+
+#define WM_DARK_BACKGROUND_COLOR    "#2c3e50"
+#define WM_DARK_TEXT_COLOR          "#ecf0f1"
+#define WM_DARK_BUTTON_COLOR        "#3498db"
+#define WM_DARK_BUTTON_TEXT_COLOR   "#fff"
+#define WM_DARK_SLIDER_COLOR        "#555"
+#define WM_DARK_SLIDER_ON_COLOR     "#e74c3c"
+
+// Minified stylesheets, script and icon from assets/, regenerated with
+// tools/build_assets.py (which also reads the colors above)
+#include "webui_assets.h"
+
+const char WebUI::HTTP_STYLE_LIGHT[] PROGMEM = WM_ASSET_STYLE_LIGHT;
+#if WM_FEATURE_THEMES
+const char WebUI::HTTP_STYLE_DARK[] PROGMEM  = WM_ASSET_STYLE_DARK;
+#endif
 
-const char WebUI::DARK_BACKGROUND_COLOR[] PROGMEM = "#2c3e50";
-const char WebUI::DARK_TEXT_COLOR[] PROGMEM = "#ecf0f1";
-const char WebUI::DARK_BUTTON_COLOR[] PROGMEM = "#3498db";
-const char WebUI::DARK_BUTTON_TEXT_COLOR[] PROGMEM = "#fff";
+// The theme and content hash are part of the URL so toggling fetches the other
+// variant once, both stay cached, and a new build is fetched fresh
+const char WebUI::HTTP_STYLE_LINK_LIGHT[] PROGMEM = "<link rel=\"stylesheet\" href=\"/style.css?t=0&v=" WM_ASSET_STYLE_LIGHT_VERSION "\">";
+static const char STYLE_ETAG_LIGHT[] PROGMEM = "\"wm-style-0-" WM_ASSET_STYLE_LIGHT_VERSION "\"";
+#if WM_FEATURE_THEMES
+const char WebUI::HTTP_STYLE_LINK_DARK[] PROGMEM  = "<link rel=\"stylesheet\" href=\"/style.css?t=1&v=" WM_ASSET_STYLE_DARK_VERSION "\">";
+static const char STYLE_ETAG_DARK[] PROGMEM  = "\"wm-style-1-" WM_ASSET_STYLE_DARK_VERSION "\"";
+#endif
+static const char SCRIPT_ETAG[] PROGMEM      = "\"wm-script-" WM_ASSET_SCRIPT_VERSION "\"";
+static const char LOCK_ETAG[] PROGMEM        = "\"wm-lock-" WM_ASSET_LOCK_PNG_VERSION "\"";
 
 // HTML content strings
 const char WebUI::HTTP_HEAD_START[] PROGMEM      = "<!DOCTYPE html><html lang=\"en\"><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/><title>{v}</title>";
 
 
 
-const char WebUI::HTTP_SCRIPT[] PROGMEM          = "<script>function c(l){document.getElementById('s').value=l.innerText||l.textContent;document.getElementById('p').focus();} function toggleTheme(){fetch('/theme-toggle',{method:'POST'}).then(()=>{location.reload();});}</script>";
+const char WebUI::HTTP_SCRIPT[] PROGMEM          = "<script src=\"/wm.js?v=" WM_ASSET_SCRIPT_VERSION "\"></script>";
 const char WebUI::HTTP_HEAD_END[] PROGMEM        = "</head><body><div style=\'text-align:center;display:inline-block;min-width:260px;\'>";
 const char WebUI::HTTP_PORTAL_OPTIONS[] PROGMEM  = "<form action=\"/wifi\" method=\"get\"><button>Configure WiFi</button></form><br/><form action=\"/0wifi\" method=\"get\"><button>Configure WiFi (No Scan)</button></form><br/>";
 
+#if WM_FEATURE_THEMES
 const char WebUI::HTTP_THEME_TOGGLE[] PROGMEM    = "<div class=\"theme-toggle\"><span class=\"theme-label\">Light</span><label class=\"switch\"><input type=\"checkbox\" {c} onchange=\"toggleTheme()\"><span class=\"slider\"></span></label><span class=\"theme-label\">Dark</span></div>";
+#endif
 
 const char WebUI::HTTP_ITEM[] PROGMEM            = "<div><a href='#p' onclick='c(this)'>{v}</a>&nbsp;<span class='q {i}'>{r}%</span></div>";
 
@@ -32,89 +59,352 @@ const char WebUI::HTTP_FORM_PARAM[] PROGMEM      = "<br/><input id='{i}' name='{
 
 const char WebUI::HTTP_FORM_END[] PROGMEM        = "<br/><button type='submit'>save</button></form>";
 
+const char WebUI::HTTP_SCAN_LIST_START[] PROGMEM = "<div id='aps'>";
+
+const char WebUI::HTTP_SCAN_LIST_END[] PROGMEM   = "</div><br/>";
+
+// Polls /scan.json and redraws the list while a scan is running
+const char WebUI::HTTP_SCAN_POLL[] PROGMEM       = "<script>setTimeout(r,2000);</script>";
+
 const char WebUI::HTTP_SCAN_LINK[] PROGMEM       = "<br/><div class=\"c\"><a href=\"/wifi\">Scan</a></div>";
 
-const char WebUI::HTTP_SAVED[] PROGMEM           = "<div>Your Wi-Fi connection information has been saved.<br />This device will connect to the selected SSID.<br />If the connection fails, reboot and try again.</div>";
+#if WM_FEATURE_JSON_API
+// The portal stays up during the attempt; w() polls /api/status and reports the outcome
+const char WebUI::HTTP_SAVED[] PROGMEM           = "<div>Your Wi-Fi connection information has been saved.<br />This device is now connecting to the selected SSID.</div><br/><div id=\"st\">Connecting...</div><script>w()</script>";
+#else
+const char WebUI::HTTP_SAVED[] PROGMEM           = "<div>Your Wi-Fi connection information has been saved.<br />This device is now connecting to the selected SSID.<br />If this page is still reachable in a minute, the connection failed.</div>";
+#endif
 
 const char WebUI::HTTP_END[] PROGMEM             = "</div></body></html>";
 
-WebUI::WebUI(WebServer* server, DNSServer* dnsServer) : _server(server), _dnsServer(dnsServer) {
-    // Preferencesからテーマ設定を読み込み
-    Preferences preferences;
-    preferences.begin("webui", false);
-    _currentTheme = preferences.getInt("theme", WM_WEBUI_THEME_DARK); // デフォルトはダークモード
-    preferences.end();
+WebUI::WebUI(WebServer* server, CaptiveDNSServer* dnsServer, WiFiSettingsStore* settings)
+    : _server(server), _dnsServer(dnsServer), _settings(settings) {
 }
 
 void WebUI::setupHandlers(std::function<void(void)> handleRootCb, 
                            std::function<void(bool)> handleWifiCb, 
                            std::function<void(void)> handleWifiSaveCb, 
-                           std::function<void(void)> handleInfoCb, 
-                           std::function<void(void)> handleResetCb, 
                            std::function<void(void)> handleNotFoundCb, 
                            std::function<bool(void)> captivePortalCb,
-                           std::function<void(void)> handleThemeToggleCb) {
+                           std::function<void(void)> handleScanJsonCb) {
     _server->on("/", handleRootCb);
     _server->on("/wifi", std::bind(handleWifiCb, true));
     _server->on("/0wifi", std::bind(handleWifiCb, false));
     _server->on("/wifisave", handleWifiSaveCb);
-    _server->on("/i", handleInfoCb);
-    _server->on("/r", handleResetCb);
-    _server->on("/theme-toggle", HTTP_POST, handleThemeToggleCb);
+    _server->on("/scan.json", handleScanJsonCb);
+    _server->on("/style.css", HTTP_GET, std::bind(&WebUI::handleStyle, this));
+    _server->on("/wm.js", HTTP_GET, std::bind(&WebUI::handleScript, this));
+    _server->on("/lock.png", HTTP_GET, std::bind(&WebUI::handleLock, this));
     _server->onNotFound(handleNotFoundCb);
+
+    const char* headerKeys[] = { "If-None-Match", "Accept-Encoding", "Connection" };
+    _server->collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
     _server->begin();
 }
 
 void WebUI::startDNSServer() {
-    _dnsServer->setErrorReplyCode(DNSReplyCode::NoError);
-    _dnsServer->start(53, "*", WiFi.softAPIP());
+    _dnsServer->start(53, WiFi.softAPIP());
 }
 
+// Answers every query that has queued up, so bursts of connectivity checks
+// from a phone joining the AP do not wait for later loop iterations
 void WebUI::processDNSRequest() {
-    _dnsServer->processNextRequest();
+    _dnsServer->processRequests();
 }
 
 void WebUI::handleClient() {
     _server->handleClient();
 }
 
+// 保存はWiFiSettingsStoreがまとめて行う
 void WebUI::setTheme(int theme) {
-    _currentTheme = theme;
-    
-    // Preferencesにテーマ設定を保存
-    Preferences preferences;
-    preferences.begin("webui", false);
-    preferences.putInt("theme", _currentTheme);
-    preferences.end();
+    _settings->setTheme(theme);
 }
 
+// Without WM_FEATURE_THEMES only the light theme is built in
 int WebUI::getTheme() {
-    return _currentTheme;
+#if WM_FEATURE_THEMES
+    return _settings->getTheme();
+#else
+    return WM_WEBUI_THEME_LIGHT;
+#endif
+}
+
+const char* WebUI::getStyleLink() {
+#if WM_FEATURE_THEMES
+    return (getTheme() == WM_WEBUI_THEME_LIGHT) ? HTTP_STYLE_LINK_LIGHT : HTTP_STYLE_LINK_DARK;
+#else
+    return HTTP_STYLE_LINK_LIGHT;
+#endif
+}
+
+void WebUI::handleStyle() {
+#if WM_FEATURE_THEMES
+    int theme = getTheme();
+    if (_server->hasArg("t")) {
+        theme = (_server->arg("t") == "0") ? WM_WEBUI_THEME_LIGHT : WM_WEBUI_THEME_DARK;
+    }
+    if (theme != WM_WEBUI_THEME_LIGHT) {
+        sendAsset("text/css", STYLE_ETAG_DARK, WM_ASSET_STYLE_DARK_GZ, sizeof(WM_ASSET_STYLE_DARK_GZ),
+                  (const uint8_t*)HTTP_STYLE_DARK, sizeof(HTTP_STYLE_DARK) - 1);
+        return;
+    }
+#endif
+    sendAsset("text/css", STYLE_ETAG_LIGHT, WM_ASSET_STYLE_LIGHT_GZ, sizeof(WM_ASSET_STYLE_LIGHT_GZ),
+              (const uint8_t*)HTTP_STYLE_LIGHT, sizeof(HTTP_STYLE_LIGHT) - 1);
+}
+
+void WebUI::handleScript() {
+    static const char script[] PROGMEM = WM_ASSET_SCRIPT;
+    sendAsset("application/javascript", SCRIPT_ETAG, WM_ASSET_SCRIPT_GZ, sizeof(WM_ASSET_SCRIPT_GZ),
+              (const uint8_t*)script, sizeof(script) - 1);
+}
+
+void WebUI::handleLock() {
+    sendAsset("image/png", LOCK_ETAG, NULL, 0, WM_ASSET_LOCK_PNG, sizeof(WM_ASSET_LOCK_PNG));
+}
+
+// Sends a flash-resident asset, gzipped when the client accepts it. Assets are
+// versioned by content hash, so they can be cached for a day and revalidated by ETag.
+void WebUI::sendAsset(const char* contentType, const char* etag,
+                      const uint8_t* gz, size_t gzLength,
+                      const uint8_t* plain, size_t plainLength) {
+    _server->sendHeader("Cache-Control", "max-age=86400");
+    _server->sendHeader("ETag", etag);
+    if (gz != NULL) {
+        _server->sendHeader("Vary", "Accept-Encoding");
+    }
+    if (_server->header("If-None-Match") == etag) {
+        _server->send(304);
+        return;
+    }
+    if (gz != NULL && _server->header("Accept-Encoding").indexOf("gzip") >= 0) {
+        _server->sendHeader("Content-Encoding", "gzip");
+        _server->send_P(200, contentType, (PGM_P)gz, gzLength);
+        WM_METRIC_BYTES(gzLength);
+    } else {
+        _server->send_P(200, contentType, (PGM_P)plain, plainLength);
+        WM_METRIC_BYTES(plainLength);
+    }
+}
+
+
+
+char*  PageWriter::_sharedBuffer = NULL;
+size_t PageWriter::_sharedSize = 0;
+
+void PageWriter::setSharedBuffer(char* buffer, size_t size) {
+    _sharedBuffer = buffer;
+    _sharedSize = size;
+}
+
+PageWriter::PageWriter(WebServer* server) : _server(server), _length(0), _total(0), _started(false) {
+    if (_sharedBuffer != NULL) {
+        _buffer = _sharedBuffer;
+        _capacity = _sharedSize;
+    } else {
+        _buffer = _local;
+        _capacity = sizeof(_local);
+    }
 }
 
-const char* WebUI::getCurrentStyle() {
-    String style = "<style>.c{text-align: center;} div,input{padding:5px;font-size:1em;} input{width:95%;} body{text-align: center;font-family:verdana;background-color:" + String(getCurrentBackgroundColor()) + ";color:" + String(getCurrentTextColor()) + ";} button{border:0;border-radius:0.3rem;background-color:" + String(getCurrentButtonColor()) + ";color:" + String(getCurrentButtonTextColor()) + ";line-height:2.4rem;font-size:1.2rem;width:100%;} .q{float: right;width: 64px;text-align: right;} .l{background: url(\"data:image/png;base64,iVBORw0KGgoAAAANSUhEUgAAACAAAAAgCAMAAABEpIrGAAAAZElEQVQ4je2NSw7AIAhEBamKn97/uMXEGBvozkWb9I2Zx4xzWykBhFAeYp9gkLyZE0zIMno9n4g19hmdY39scwqVkOXaxph0ZCXQcqxSpgQpONa59wkRDOL93eAXvimwlbPbwwVAegLS1HGfZAAAAABJRU5ErkJggg==\") no-repeat left center;background-size: 1em;} a{color:" + String(getCurrentTextColor()) + ";text-decoration:none;} a:hover{color:" + String(getCurrentButtonColor()) + ";} .theme-toggle{margin:10px 0;display:flex;align-items:center;justify-content:flex-end;gap:8px;} .theme-label{font-size:0.8rem;color:" + String(getCurrentTextColor()) + ";} .switch{position:relative;display:inline-block;width:40px;height:22px;} .switch input{opacity:0;width:0;height:0;} .slider{position:absolute;cursor:pointer;top:0;left:0;right:0;bottom:0;background-color:" + String((_currentTheme == WM_WEBUI_THEME_LIGHT) ? "#ccc" : "#555") + ";transition:.4s;border-radius:22px;} .slider:before{position:absolute;content:\"\";height:18px;width:18px;left:2px;bottom:2px;background-color:white;transition:.4s;border-radius:50%;} input:checked + .slider{background-color:" + String((_currentTheme == WM_WEBUI_THEME_LIGHT) ? "#28a745" : "#e74c3c") + ";} input:checked + .slider:before{transform:translateX(18px);}</style>";
-    static char styleBuffer[2048]; // Adjust size as needed
-    style.toCharArray(styleBuffer, sizeof(styleBuffer));
-    return styleBuffer;
+PageWriter::~PageWriter() {
+    end();
 }
 
+void PageWriter::begin(int code, const char* contentType) {
+    _server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server->send(code, contentType, "");
+    _length = 0;
+    _total = 0;
+    _started = true;
+}
+
+void PageWriter::end() {
+    if (!_started) {
+        return;
+    }
+    flush();
+    // A zero-length chunk terminates the chunked response
+    _server->sendContent("", 0);
+    _started = false;
+    WM_METRIC_BYTES(_total);
+}
 
+void PageWriter::flush() {
+    if (_length > 0) {
+        _server->sendContent(_buffer, _length);
+        _length = 0;
+    }
+}
 
-const char* WebUI::getCurrentBackgroundColor() {
-    return (_currentTheme == WM_WEBUI_THEME_LIGHT) ? LIGHT_BACKGROUND_COLOR : DARK_BACKGROUND_COLOR;
+void PageWriter::write(const char* str) {
+    if (str != NULL) {
+        write(str, strlen(str));
+    }
 }
 
-const char* WebUI::getCurrentTextColor() {
-    return (_currentTheme == WM_WEBUI_THEME_LIGHT) ? LIGHT_TEXT_COLOR : DARK_TEXT_COLOR;
+void PageWriter::write(const char* str, size_t length) {
+    _total += length;
+    while (length > 0) {
+        size_t room = _capacity - _length;
+        if (room == 0) {
+            flush();
+            room = _capacity;
+        }
+        size_t n = (length < room) ? length : room;
+        memcpy(_buffer + _length, str, n);
+        _length += n;
+        str += n;
+        length -= n;
+    }
 }
 
-const char* WebUI::getCurrentButtonColor() {
-    return (_currentTheme == WM_WEBUI_THEME_LIGHT) ? LIGHT_BUTTON_COLOR : DARK_BUTTON_COLOR;
+void PageWriter::write(const String& str) {
+    write(str.c_str(), str.length());
 }
 
-const char* WebUI::getCurrentButtonTextColor() {
-    return (_currentTheme == WM_WEBUI_THEME_LIGHT) ? LIGHT_BUTTON_TEXT_COLOR : DARK_BUTTON_TEXT_COLOR;
+void PageWriter::write(const __FlashStringHelper* str) {
+    write_P(reinterpret_cast<PGM_P>(str));
 }
 
+void PageWriter::write(int32_t value) {
+    char num[12];
+    int n = snprintf(num, sizeof(num), "%d", (int)value);
+    write(num, n);
+}
+
+void PageWriter::write(uint32_t value) {
+    char num[11];
+    int n = snprintf(num, sizeof(num), "%u", (unsigned)value);
+    write(num, n);
+}
+
+void PageWriter::write(uint64_t value) {
+    char num[21];
+    int n = snprintf(num, sizeof(num), "%llu", (unsigned long long)value);
+    write(num, n);
+}
+
+void PageWriter::write_P(PGM_P str) {
+    write_P(str, strlen_P(str));
+}
+
+void PageWriter::write_P(PGM_P str, size_t length) {
+    _total += length;
+    while (length > 0) {
+        size_t room = _capacity - _length;
+        if (room == 0) {
+            flush();
+            room = _capacity;
+        }
+        // Once the buffer is flushed, whatever would fill it again goes out
+        // straight from flash; everything else is copied, so every chunk but
+        // the last leaves full
+        if (_length == 0 && length >= _capacity) {
+            _server->sendContent_P(str, length);
+            return;
+        }
+        size_t n = (length < room) ? length : room;
+        memcpy_P(_buffer + _length, str, n);
+        _length += n;
+        str += n;
+        length -= n;
+    }
+}
 
+void PageWriter::writeEscaped(const char* str) {
+    if (str == NULL) {
+        return;
+    }
+    const char* run = str;
+    for (; *str; str++) {
+        const char* entity;
+        switch (*str) {
+            case '&':  entity = "&amp;";  break;
+            case '<':  entity = "&lt;";   break;
+            case '>':  entity = "&gt;";   break;
+            case '"':  entity = "&quot;"; break;
+            case '\'': entity = "&#39;";  break;
+            default:   continue;
+        }
+        write(run, str - run);
+        write(entity);
+        run = str + 1;
+    }
+    write(run, str - run);
+}
+
+void PageWriter::writeJsonEscaped(const char* str) {
+    if (str == NULL) {
+        return;
+    }
+    const char* run = str;
+    for (; *str; str++) {
+        unsigned char ch = *str;
+        if (ch >= 0x20 && ch != '"' && ch != '\\') {
+            continue;
+        }
+        write(run, str - run);
+        if (ch == '"' || ch == '\\') {
+            char esc[2] = { '\\', (char)ch };
+            write(esc, 2);
+        } else {
+            char esc[7];
+            snprintf(esc, sizeof(esc), "\\u%04x", ch);
+            write(esc, 6);
+        }
+        run = str + 1;
+    }
+    write(run, str - run);
+}
+
+size_t PageWriter::bytesWritten() {
+    return _total;
+}
+
+WebTemplate::WebTemplate(PGM_P tpl, const char* keys) : _tpl(tpl), _keys(keys), _count(0), _compiled(false) {
+}
+
+void WebTemplate::compile() {
+    size_t length = strlen_P(_tpl);
+    size_t literalStart = 0;
+    _count = 0;
+
+    // Leave room for a literal, a slot and the trailing literal
+    for (size_t i = 0; i + 2 < length && _count + 3 <= WM_TEMPLATE_MAX_SEGMENTS; i++) {
+        if (_tpl[i] != '{' || _tpl[i + 2] != '}') {
+            continue;
+        }
+        const char* key = strchr(_keys, _tpl[i + 1]);
+        if (key == NULL) {
+            continue;
+        }
+        if (i > literalStart) {
+            _segments[_count++] = { (uint16_t)literalStart, (uint16_t)(i - literalStart), -1 };
+        }
+        _segments[_count++] = { 0, 0, (int8_t)(key - _keys) };
+        literalStart = i + 3;
+        i += 2;
+    }
+    if (literalStart < length && _count < WM_TEMPLATE_MAX_SEGMENTS) {
+        _segments[_count++] = { (uint16_t)literalStart, (uint16_t)(length - literalStart), -1 };
+    }
+    _compiled = true;
+}
+
+void WebTemplate::render(PageWriter& out, const char* const values[], uint32_t rawMask) {
+    if (!_compiled) {
+        compile();
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+        const Segment& seg = _segments[i];
+        if (seg.slot < 0) {
+            out.write_P(_tpl + seg.offset, seg.length);
+        } else if (rawMask & (1UL << seg.slot)) {
+            out.write(values[seg.slot]);
+        } else {
+            out.writeEscaped(values[seg.slot]);
+        }
+    }
+}
@@ -2,24 +2,103 @@
 #define WebUI_h
 
 #include <WebServer.h>
-#include <DNSServer.h>
+#include "captivedns.h"
 #include <functional>
+#include "wifisettings.h"
 
-#define WM_WEBUI_THEME_LIGHT 0
-#define WM_WEBUI_THEME_DARK 1
+// Staging buffer used by PageWriter before a chunk is handed to the server
+#ifndef WM_PAGE_BUFFER_SIZE
+#define WM_PAGE_BUFFER_SIZE 256
+#endif
+
+// Streams a response with chunked transfer encoding through a small fixed buffer.
+// Flash-resident fragments top up the buffer first; a remainder of at least a
+// whole buffer is then sent in place instead of being copied.
+class PageWriter {
+public:
+    PageWriter(WebServer* server);
+    ~PageWriter();
+
+    // Buffer used by every writer instead of its own, e.g. one reserved with the
+    // portal. Pages are rendered one at a time, so a single buffer suffices.
+    static void setSharedBuffer(char* buffer, size_t size);
+
+    void begin(int code, const char* contentType);
+    void end();
+
+    void write(const char* str);
+    void write(const char* str, size_t length);
+    void write(const String& str);
+    void write(const __FlashStringHelper* str);
+    void write(int32_t value);
+    void write(uint32_t value);
+    void write(uint64_t value);
+    void write_P(PGM_P str);
+    void write_P(PGM_P str, size_t length);
+
+    // Writes str with HTML special characters replaced by entities
+    void writeEscaped(const char* str);
+    // Writes str escaped for use inside a JSON string literal
+    void writeJsonEscaped(const char* str);
+
+    size_t bytesWritten();
+
+private:
+    void flush();
+
+    WebServer* _server;
+    char*      _buffer;
+    size_t     _capacity;
+    char       _local[WM_PAGE_BUFFER_SIZE];
+    size_t     _length;
+    size_t     _total;
+    bool       _started;
+
+    static char*  _sharedBuffer;
+    static size_t _sharedSize;
+};
+
+#ifndef WM_TEMPLATE_MAX_SEGMENTS
+#define WM_TEMPLATE_MAX_SEGMENTS 16
+#endif
+
+// Flash template with {x} slots. The template is split into literal and slot
+// segments on first use; rendering then writes straight into a PageWriter.
+class WebTemplate {
+public:
+    // keys lists the slot names in the order their values are passed to render()
+    WebTemplate(PGM_P tpl, const char* keys);
+
+    // Slot values are HTML-escaped unless their bit is set in rawMask
+    void render(PageWriter& out, const char* const values[], uint32_t rawMask = 0);
+
+private:
+    struct Segment {
+        uint16_t offset;
+        uint16_t length;
+        int8_t   slot;      // -1 for literal text
+    };
+
+    void compile();
+
+    PGM_P       _tpl;
+    const char* _keys;
+    Segment     _segments[WM_TEMPLATE_MAX_SEGMENTS];
+    uint8_t     _count;
+    bool        _compiled;
+};
 
 class WebUI {
 public:
-    WebUI(WebServer* server, DNSServer* dnsServer);
+    WebUI(WebServer* server, CaptiveDNSServer* dnsServer, WiFiSettingsStore* settings);
 
+    // Optional pages (info, reset, theme toggle, /api) are registered by the manager
     void setupHandlers(std::function<void(void)> handleRootCb, 
                        std::function<void(bool)> handleWifiCb, 
                        std::function<void(void)> handleWifiSaveCb, 
-                       std::function<void(void)> handleInfoCb, 
-                       std::function<void(void)> handleResetCb, 
                        std::function<void(void)> handleNotFoundCb, 
                        std::function<bool(void)> captivePortalCb,
-                       std::function<void(void)> handleThemeToggleCb);
+                       std::function<void(void)> handleScanJsonCb);
 
     void startDNSServer();
     void processDNSRequest();
@@ -40,33 +119,34 @@ public:
     static const char HTTP_FORM_START[];
     static const char HTTP_FORM_PARAM[];
     static const char HTTP_FORM_END[];
+    static const char HTTP_SCAN_LIST_START[];
+    static const char HTTP_SCAN_LIST_END[];
+    static const char HTTP_SCAN_POLL[];
     static const char HTTP_SCAN_LINK[];
     static const char HTTP_SAVED[];
     static const char HTTP_END[];
 
-    // 現在のテーマに応じたスタイルを取得
-    const char* getCurrentStyle();
-
-    // Color definitions
-    static const char LIGHT_BACKGROUND_COLOR[];
-    static const char LIGHT_TEXT_COLOR[];
-    static const char LIGHT_BUTTON_COLOR[];
-    static const char LIGHT_BUTTON_TEXT_COLOR[];
-    static const char DARK_BACKGROUND_COLOR[];
-    static const char DARK_TEXT_COLOR[];
-    static const char DARK_BUTTON_COLOR[];
-    static const char DARK_BUTTON_TEXT_COLOR[];
-
-    // Functions to get current colors based on theme
-    const char* getCurrentBackgroundColor();
-    const char* getCurrentTextColor();
-    const char* getCurrentButtonColor();
-    const char* getCurrentButtonTextColor();
+    // Stylesheets for each theme, served from /style.css (gzipped when accepted).
+    // The dark variants and HTTP_THEME_TOGGLE are only defined with WM_FEATURE_THEMES.
+    static const char HTTP_STYLE_LIGHT[];
+    static const char HTTP_STYLE_LINK_LIGHT[];
+    static const char HTTP_STYLE_DARK[];
+    static const char HTTP_STYLE_LINK_DARK[];
+
+    // 現在のテーマのスタイルシートを参照する<link>タグ
+    const char* getStyleLink();
 
 private:
+    void handleStyle();
+    void handleScript();
+    void handleLock();
+    void sendAsset(const char* contentType, const char* etag,
+                   const uint8_t* gz, size_t gzLength,
+                   const uint8_t* plain, size_t plainLength);
+
     WebServer* _server;
-    DNSServer* _dnsServer;
-    int _currentTheme;
+    CaptiveDNSServer* _dnsServer;
+    WiFiSettingsStore* _settings;
 };
 
 #endif
@@ -0,0 +1,141 @@
+// Generated by tools/build_assets.py from assets/. Do not edit.
+#ifndef WebUIAssets_h
+#define WebUIAssets_h
+
+#define WM_ASSET_STYLE_LIGHT_VERSION "0d1fcbda"
+#define WM_ASSET_STYLE_LIGHT ".c{text-align:center}div,input{padding:5px;font-size:1em}input{width:95%}body{text-align:center;font-family:verdana;background-color:#FFFFFF;color:#333333}button{border:0;border-radius:0.3rem;background-color:#1fa3ec;color:#fff;line-height:2.4rem;font-size:1.2rem;width:100%}.q{float:right;width:64px;text-align:right}.l{background:url(/lock.png) no-repeat left center;background-size:1em}a{color:#333333;text-decoration:none}a:hover{color:#1fa3ec}.theme-toggle{margin:10px 0;display:flex;align-items:center;justify-content:flex-end;gap:8px}.theme-label{font-size:0.8rem;color:#333333}.switch{position:relative;display:inline-block;width:40px;height:22px}.switch input{opacity:0;width:0;height:0}.slider{position:absolute;cursor:pointer;top:0;left:0;right:0;bottom:0;background-color:#ccc;transition:.4s;border-radius:22px}.slider:before{position:absolute;content:\"\";height:18px;width:18px;left:2px;bottom:2px;background-color:white;transition:.4s;border-radius:50%}input:checked+.slider{background-color:#28a745}input:checked+.slider:before{transform:translateX(18px)}"
+static const uint8_t WM_ASSET_STYLE_LIGHT_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7d, 0x52, 0xdb, 0x72, 0xdb, 0x20,
+    0x10, 0xfd, 0x15, 0x4f, 0x3a, 0x99, 0x49, 0xa6, 0x15, 0x95, 0x6f, 0x8d, 0x0b, 0xef, 0xfd, 0x86,
+    0xbe, 0x22, 0x58, 0x24, 0x6a, 0x04, 0x04, 0xad, 0x7c, 0xa9, 0x46, 0xff, 0x5e, 0x84, 0xa4, 0xd8,
+    0x8e, 0x3d, 0xe5, 0x45, 0x8b, 0xd8, 0xcb, 0xb9, 0x2c, 0x11, 0x1d, 0xc2, 0x09, 0x33, 0x6e, 0x74,
+    0x69, 0xa9, 0x00, 0x8b, 0x10, 0x7a, 0xa9, 0x0f, 0xdf, 0xb4, 0xf5, 0x2d, 0x76, 0x9e, 0x4b, 0xa9,
+    0x6d, 0x49, 0xb7, 0xfe, 0xc4, 0x94, 0xb3, 0x98, 0x35, 0xfa, 0x2f, 0xd0, 0x25, 0xd4, 0xfd, 0xf8,
+    0x7e, 0xd4, 0x12, 0x2b, 0xfa, 0x73, 0xfb, 0xdc, 0x17, 0x4e, 0x9e, 0xef, 0x5b, 0x8d, 0x45, 0x8a,
+    0xd7, 0xda, 0x9c, 0xe9, 0x01, 0x82, 0xe4, 0x96, 0xb3, 0x82, 0x8b, 0x7d, 0x19, 0x5c, 0x6b, 0x65,
+    0x26, 0x9c, 0x71, 0x81, 0x7e, 0xf9, 0x95, 0x0e, 0x9b, 0x6e, 0xeb, 0x74, 0xfa, 0xa2, 0x45, 0x74,
+    0xb6, 0x2b, 0x5c, 0x90, 0x10, 0x68, 0xce, 0xc6, 0x20, 0x0b, 0x5c, 0xea, 0xb6, 0xa1, 0x39, 0x59,
+    0x07, 0xa8, 0x1f, 0xf4, 0x5a, 0x2a, 0xbe, 0x06, 0x31, 0xf7, 0x52, 0x4a, 0x31, 0xa3, 0x2d, 0x64,
+    0x15, 0xe8, 0xb2, 0x42, 0xba, 0x22, 0x9b, 0xa1, 0xec, 0x8a, 0x0b, 0x59, 0x0d, 0x3f, 0x46, 0x22,
+    0xcb, 0x3c, 0x7f, 0xee, 0xc9, 0x7b, 0xa7, 0x8c, 0xe3, 0x48, 0xc3, 0x50, 0x31, 0xbd, 0xfc, 0xd8,
+    0x44, 0x05, 0xae, 0xe8, 0xa5, 0xb7, 0x9e, 0x98, 0xee, 0x02, 0x80, 0xb6, 0xc1, 0xbc, 0x7c, 0x37,
+    0x4e, 0xec, 0x89, 0xb7, 0xe5, 0xeb, 0xc2, 0xba, 0x2c, 0x80, 0x07, 0x8e, 0x0b, 0x03, 0x0a, 0x17,
+    0x93, 0x20, 0x57, 0x80, 0x3f, 0xb4, 0xe4, 0xdd, 0x0d, 0xf3, 0x71, 0x8e, 0x04, 0xe1, 0x02, 0x47,
+    0xed, 0x2c, 0xb5, 0xce, 0x42, 0xcf, 0x69, 0xe5, 0xa2, 0x82, 0xdd, 0x0d, 0xcd, 0x9e, 0x60, 0x05,
+    0x35, 0x64, 0xe8, 0xca, 0xd2, 0x40, 0x57, 0xf3, 0x50, 0x6a, 0x1b, 0x69, 0xf8, 0xd3, 0x22, 0x67,
+    0x52, 0x37, 0xde, 0xf0, 0x33, 0x55, 0x06, 0x4e, 0x2c, 0xc1, 0xce, 0x34, 0x42, 0xdd, 0xcc, 0xde,
+    0xfc, 0x69, 0x1b, 0xd4, 0xea, 0x1c, 0x85, 0x8b, 0x57, 0x8b, 0x29, 0x2f, 0x03, 0x2b, 0x59, 0xc9,
+    0x3d, 0xdd, 0xf9, 0xd3, 0xdc, 0xdc, 0xf0, 0x02, 0x4c, 0x77, 0x91, 0x2c, 0x27, 0xbb, 0x41, 0xb2,
+    0x5b, 0xb7, 0x48, 0x73, 0xd4, 0x28, 0xaa, 0xce, 0xbb, 0x46, 0x27, 0xd0, 0x01, 0x4c, 0x44, 0x7f,
+    0x80, 0x0f, 0x18, 0xda, 0x26, 0x23, 0x8a, 0x41, 0xa1, 0x49, 0xd5, 0x4d, 0x04, 0xca, 0x66, 0x67,
+    0x56, 0xc3, 0xc4, 0xb1, 0xcb, 0x62, 0xdc, 0x2e, 0xe7, 0xb9, 0xd0, 0x78, 0x8e, 0xde, 0x8f, 0xe9,
+    0xf9, 0x9c, 0x9b, 0xc7, 0x44, 0xa3, 0xe3, 0x36, 0x5c, 0xc6, 0xf1, 0xa2, 0x71, 0xa6, 0x45, 0x60,
+    0xa2, 0x0d, 0x4d, 0xc4, 0xe5, 0x9d, 0x4e, 0x24, 0xd1, 0xf9, 0x58, 0x37, 0x38, 0x10, 0x3f, 0x61,
+    0xac, 0x8e, 0xab, 0x14, 0x57, 0xab, 0x1e, 0x82, 0xbb, 0xf5, 0x11, 0x42, 0x30, 0x0c, 0xdc, 0x4e,
+    0x6d, 0xc9, 0xa6, 0xf9, 0xb4, 0x78, 0x13, 0xce, 0x34, 0x9e, 0x16, 0xa0, 0x5c, 0x80, 0x47, 0x28,
+    0x26, 0x4d, 0x9f, 0x9e, 0x66, 0xcc, 0xcb, 0xa8, 0xe8, 0xbc, 0x66, 0x43, 0x98, 0x20, 0xc5, 0x5e,
+    0x33, 0x98, 0x14, 0x7e, 0x86, 0x73, 0xac, 0xa2, 0x63, 0xff, 0xc7, 0xb3, 0x8d, 0x2b, 0x9b, 0xe4,
+    0xa2, 0xa2, 0x02, 0xb1, 0x07, 0xf9, 0x75, 0xd6, 0xe6, 0x9e, 0xdc, 0x6a, 0xc7, 0xdf, 0x36, 0xdb,
+    0xc7, 0xe9, 0x33, 0x97, 0x34, 0x2c, 0x46, 0x35, 0x4d, 0x51, 0x34, 0x11, 0x7e, 0xbf, 0x0c, 0x88,
+    0x5f, 0xfb, 0x7f, 0x54, 0x8d, 0x2a, 0x6f, 0x2d, 0x04, 0x00, 0x00,
+};
+
+#define WM_ASSET_STYLE_DARK_VERSION "6ec80eef"
+#define WM_ASSET_STYLE_DARK ".c{text-align:center}div,input{padding:5px;font-size:1em}input{width:95%}body{text-align:center;font-family:verdana;background-color:#2c3e50;color:#ecf0f1}button{border:0;border-radius:0.3rem;background-color:#3498db;color:#fff;line-height:2.4rem;font-size:1.2rem;width:100%}.q{float:right;width:64px;text-align:right}.l{background:url(/lock.png) no-repeat left center;background-size:1em}a{color:#ecf0f1;text-decoration:none}a:hover{color:#3498db}.theme-toggle{margin:10px 0;display:flex;align-items:center;justify-content:flex-end;gap:8px}.theme-label{font-size:0.8rem;color:#ecf0f1}.switch{position:relative;display:inline-block;width:40px;height:22px}.switch input{opacity:0;width:0;height:0}.slider{position:absolute;cursor:pointer;top:0;left:0;right:0;bottom:0;background-color:#555;transition:.4s;border-radius:22px}.slider:before{position:absolute;content:\"\";height:18px;width:18px;left:2px;bottom:2px;background-color:white;transition:.4s;border-radius:50%}input:checked+.slider{background-color:#e74c3c}input:checked+.slider:before{transform:translateX(18px)}"
+static const uint8_t WM_ASSET_STYLE_DARK_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7d, 0x52, 0xdb, 0x72, 0x9b, 0x30,
+    0x10, 0xfd, 0x15, 0x4f, 0x3a, 0x99, 0x49, 0xa6, 0x85, 0x62, 0x1b, 0x1a, 0x47, 0xfa, 0x91, 0xbe,
+    0x0a, 0x69, 0x05, 0xaa, 0x85, 0xa4, 0x88, 0xc5, 0x97, 0x32, 0xfc, 0x7b, 0x85, 0x80, 0xd8, 0x8e,
+    0x3d, 0x7d, 0xf2, 0x62, 0xed, 0xe5, 0xdc, 0x52, 0xde, 0x23, 0x9c, 0x30, 0x61, 0x5a, 0x55, 0x86,
+    0x70, 0x30, 0x08, 0x7e, 0x10, 0xea, 0xf0, 0x43, 0x19, 0xd7, 0x61, 0xef, 0x98, 0x10, 0xca, 0x54,
+    0xa4, 0x70, 0x27, 0x2a, 0xad, 0xc1, 0xa4, 0x55, 0x7f, 0x81, 0xac, 0xa1, 0x19, 0xa6, 0xf7, 0xa3,
+    0x12, 0x58, 0x93, 0xf7, 0xe2, 0x79, 0x28, 0xad, 0x38, 0xdf, 0xaf, 0x9a, 0x86, 0x24, 0x6b, 0x94,
+    0x3e, 0x93, 0x03, 0x78, 0xc1, 0x0c, 0xa3, 0x25, 0xe3, 0xfb, 0xca, 0xdb, 0xce, 0x88, 0x84, 0x5b,
+    0x6d, 0x3d, 0xf9, 0xb6, 0xe1, 0x5b, 0x28, 0x32, 0x3a, 0x7f, 0x01, 0x97, 0x99, 0x5c, 0x0f, 0x65,
+    0x87, 0x68, 0x4d, 0x5f, 0x5a, 0x2f, 0xc0, 0x93, 0x8c, 0x4e, 0x45, 0xe2, 0x99, 0x50, 0x5d, 0x4b,
+    0xb2, 0x74, 0xeb, 0xa1, 0x79, 0xb0, 0x6b, 0x9b, 0xbf, 0xef, 0x44, 0xb9, 0xec, 0x92, 0x52, 0x52,
+    0xad, 0x0c, 0x24, 0x35, 0xa8, 0xaa, 0x46, 0xb2, 0x49, 0xf3, 0x71, 0xec, 0x8a, 0x4b, 0xba, 0x19,
+    0xff, 0x98, 0x88, 0xac, 0xb3, 0xec, 0x79, 0x48, 0x3f, 0x7a, 0xa9, 0x2d, 0x43, 0xe2, 0xc7, 0x89,
+    0xf9, 0xe5, 0x57, 0x1e, 0x14, 0xb8, 0xa2, 0x17, 0xdf, 0x86, 0x54, 0xf7, 0x17, 0x00, 0xa4, 0xf3,
+    0xfa, 0xe5, 0xa7, 0xb6, 0x7c, 0x9f, 0x3a, 0x53, 0xbd, 0xae, 0x8c, 0x4d, 0x3c, 0x38, 0x60, 0xb8,
+    0xd2, 0x20, 0x71, 0x35, 0x0b, 0x72, 0x05, 0xf8, 0x53, 0x4b, 0xd6, 0xdf, 0x30, 0x9f, 0xee, 0x08,
+    0xe0, 0xd6, 0x33, 0x54, 0xd6, 0x10, 0x63, 0x0d, 0x0c, 0x8c, 0xd4, 0x36, 0x28, 0xd8, 0xdf, 0xd0,
+    0x1c, 0x52, 0xac, 0xa1, 0x81, 0x04, 0x6d, 0x55, 0x69, 0xe8, 0x1b, 0xe6, 0x2b, 0x65, 0x02, 0x0d,
+    0x77, 0x5a, 0x65, 0x54, 0xa8, 0xd6, 0x69, 0x76, 0x26, 0x52, 0xc3, 0x89, 0x46, 0xd8, 0x89, 0x42,
+    0x68, 0xda, 0xc5, 0x9b, 0x3f, 0x5d, 0x8b, 0x4a, 0x9e, 0x83, 0x70, 0xe1, 0xd3, 0x60, 0xec, 0x4b,
+    0xc0, 0x08, 0x5a, 0x31, 0x47, 0x76, 0xee, 0xb4, 0x2c, 0xd7, 0xac, 0x04, 0xdd, 0x5f, 0x24, 0xcb,
+    0xd2, 0xdd, 0x28, 0xd9, 0xad, 0x5b, 0x69, 0x7b, 0x54, 0xc8, 0xeb, 0xde, 0xd9, 0x56, 0x45, 0xd0,
+    0x1e, 0x74, 0x40, 0x7f, 0x80, 0x4f, 0x18, 0xca, 0x44, 0x23, 0xca, 0x51, 0xa1, 0x59, 0xd5, 0x3c,
+    0x00, 0xa5, 0x8b, 0x33, 0x9b, 0xf1, 0xe2, 0xb4, 0x65, 0x35, 0xa5, 0xcb, 0x3a, 0xc6, 0x15, 0x9e,
+    0x83, 0xf7, 0x53, 0x7b, 0xb6, 0xf4, 0x66, 0xa1, 0x51, 0xab, 0x90, 0x86, 0xcb, 0x39, 0x56, 0xb6,
+    0x56, 0x77, 0x08, 0x94, 0x77, 0xbe, 0x0d, 0xb8, 0x9c, 0x55, 0x91, 0x24, 0x5a, 0x17, 0xe6, 0x46,
+    0x07, 0xc2, 0x8f, 0x9f, 0xa6, 0x43, 0x94, 0x42, 0xb4, 0x9a, 0xb1, 0xb8, 0x8b, 0x4f, 0x51, 0x14,
+    0x14, 0x3d, 0x33, 0xf3, 0xda, 0x34, 0x6f, 0xbf, 0x04, 0x6f, 0xc6, 0x19, 0xcf, 0x93, 0x12, 0xa4,
+    0xf5, 0xf0, 0x08, 0xc5, 0xac, 0xe9, 0xd3, 0xd3, 0x82, 0x79, 0x1d, 0x14, 0x5d, 0x62, 0x36, 0x96,
+    0x11, 0x52, 0xd8, 0xb5, 0x80, 0x89, 0xe5, 0x57, 0x38, 0xc7, 0x3a, 0x38, 0xf6, 0x7f, 0x3c, 0x45,
+    0x88, 0x6c, 0x94, 0x8b, 0xf0, 0x1a, 0xf8, 0x1e, 0xc4, 0xf7, 0x45, 0x9b, 0x7b, 0x72, 0xf0, 0x96,
+    0xf3, 0x2d, 0x7f, 0xdc, 0xbe, 0x70, 0x89, 0xc7, 0x42, 0xd5, 0x90, 0x58, 0x05, 0x13, 0xe1, 0xf7,
+    0xcb, 0x88, 0xf8, 0x75, 0xf8, 0x07, 0xda, 0xda, 0x76, 0xec, 0x2d, 0x04, 0x00, 0x00,
+};
+
+#define WM_ASSET_SCRIPT_VERSION "5e82a835"
+#define WM_ASSET_SCRIPT "function c(l){document.getElementById('s').value=l.innerText||l.textContent;document.getElementById('p').focus();}function toggleTheme(){fetch('/theme-toggle',{method:'POST'}).then(()=>{location.reload();});}function r(){fetch('/scan.json').then(x=>x.json()).then(d=>{var e=document.getElementById('aps');if(!e)return;if(d.aps.length||!d.scanning){e.innerHTML='';d.aps.forEach(a=>{var v=document.createElement('div'),l=document.createElement('a'),q=document.createElement('span');l.href='#p';l.onclick=function(){c(this);};l.textContent=a.ssid;q.className='q'+(a.auth?' l':'');q.textContent=a.q+'%';v.appendChild(l);v.append('\\u00a0');v.appendChild(q);e.appendChild(v);});if(!d.aps.length)e.textContent='No networks found. Refresh to scan again.';}if(d.scanning)setTimeout(r,2000);});}function w(){fetch('/api/status').then(x=>x.json()).then(d=>{var e=document.getElementById('st');if(d.result<0){setTimeout(w,1000);return;}if(d.result==0){e.textContent='Connected to '+d.ssid+' with address '+d.ip+'. The setup network will now close.';}else{var m=['','The connection timed out.','Wrong password.','Network not found.','The connection failed.','No connection was attempted.'][d.result];e.innerHTML=(m||'The connection failed.')+' <a href=\"/wifi\">Try again</a>';}}).catch(()=>{setTimeout(w,1000);});}"
+static const uint8_t WM_ASSET_SCRIPT_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa5, 0x54, 0xdf, 0x6f, 0xd3, 0x30,
+    0x10, 0xfe, 0x57, 0x3c, 0x10, 0x3a, 0x5b, 0x2d, 0x6e, 0xe0, 0x71, 0x59, 0x8a, 0xc4, 0x34, 0x09,
+    0x24, 0x18, 0x08, 0x2a, 0xf1, 0x30, 0xf6, 0x60, 0xc5, 0x97, 0xc6, 0xcc, 0xb5, 0xd3, 0xd8, 0x69,
+    0x37, 0xb5, 0xfb, 0xdf, 0x39, 0xa7, 0xed, 0x48, 0x07, 0x7d, 0xe2, 0x29, 0xce, 0xfd, 0xf8, 0xee,
+    0xee, 0xbb, 0xcf, 0xae, 0x3a, 0x57, 0x46, 0xe3, 0x1d, 0x2b, 0xb9, 0x15, 0x1b, 0xed, 0xcb, 0x6e,
+    0x81, 0x2e, 0xca, 0x39, 0xc6, 0x2b, 0x8b, 0xe9, 0xf8, 0xfe, 0xe1, 0xa3, 0xe6, 0x10, 0x40, 0xc8,
+    0x95, 0xb2, 0x1d, 0x16, 0x56, 0x1a, 0xe7, 0xb0, 0x9d, 0xe1, 0x7d, 0xdc, 0x6e, 0xad, 0x8c, 0xf4,
+    0xbd, 0xf4, 0x2e, 0x52, 0x64, 0x7e, 0x32, 0xbb, 0xa1, 0xec, 0x8a, 0x9c, 0x81, 0x8b, 0xfc, 0xb1,
+    0x3a, 0x54, 0x8c, 0x7e, 0x3e, 0xb7, 0x38, 0xab, 0x29, 0x90, 0x8b, 0x4d, 0x85, 0xb1, 0xac, 0x39,
+    0x4c, 0x62, 0xfa, 0x7f, 0xbd, 0xf3, 0xc1, 0x78, 0xb3, 0xc0, 0x58, 0x7b, 0x7d, 0x0e, 0x5f, 0xbf,
+    0x7c, 0x9f, 0xc1, 0xa3, 0x90, 0xe4, 0x76, 0x9c, 0x8b, 0x62, 0xba, 0xb1, 0xbe, 0x54, 0x09, 0x47,
+    0xb6, 0x68, 0xbd, 0xd2, 0x09, 0x7a, 0x88, 0xde, 0x0e, 0x30, 0x43, 0xa9, 0x9c, 0xfc, 0x15, 0xbc,
+    0x83, 0x3d, 0xc0, 0x7d, 0x31, 0xbd, 0xef, 0x0d, 0x5c, 0xec, 0x2d, 0x9a, 0x10, 0x57, 0xaa, 0x65,
+    0x58, 0x9c, 0x9c, 0x42, 0x35, 0xc4, 0x42, 0x6e, 0x2a, 0x7e, 0x86, 0xa2, 0xc5, 0xd8, 0xb5, 0x2e,
+    0xfd, 0x68, 0x49, 0x76, 0x69, 0xd1, 0xcd, 0x63, 0xbd, 0xdd, 0x9e, 0x69, 0x99, 0x8a, 0x39, 0xe3,
+    0xe6, 0x62, 0x83, 0x3b, 0xaa, 0x3e, 0xcc, 0x3e, 0x7f, 0x2a, 0x00, 0xf2, 0x5d, 0x64, 0xe5, 0xdb,
+    0x2b, 0x45, 0x5d, 0xa9, 0x7d, 0xc1, 0xd5, 0x9f, 0x82, 0x65, 0x8b, 0x2a, 0xe2, 0xbe, 0x26, 0x07,
+    0x6d, 0x56, 0x20, 0xc6, 0xf6, 0xa4, 0x5f, 0x91, 0x77, 0x79, 0xd2, 0x1b, 0x1a, 0x45, 0xe3, 0xe6,
+    0x56, 0xd6, 0x2d, 0x56, 0x05, 0xbc, 0x6c, 0x80, 0xce, 0xde, 0x95, 0xd6, 0x94, 0x77, 0xc5, 0x81,
+    0x25, 0xe2, 0xa8, 0xe4, 0xb1, 0x36, 0x81, 0x98, 0xcb, 0x8f, 0x96, 0x59, 0x28, 0x19, 0x82, 0xd1,
+    0xf9, 0x52, 0x96, 0x56, 0x85, 0x70, 0xad, 0x16, 0x58, 0xc0, 0x12, 0x46, 0x5c, 0x49, 0xd5, 0xc5,
+    0xfa, 0x1d, 0x30, 0x0b, 0xe7, 0x40, 0x05, 0x96, 0xcf, 0xb2, 0x96, 0x23, 0x78, 0x05, 0xf9, 0x8a,
+    0x66, 0x6d, 0xd0, 0xe9, 0xcb, 0xda, 0x58, 0x4d, 0xca, 0x7a, 0x32, 0x70, 0xf8, 0xd9, 0x65, 0x99,
+    0xca, 0x40, 0x3c, 0x8b, 0x59, 0x8a, 0x1c, 0x8f, 0x0c, 0xab, 0x7e, 0xa1, 0x89, 0xee, 0x21, 0xc5,
+    0x02, 0x8f, 0xea, 0xc1, 0xb5, 0x67, 0x0e, 0xe3, 0xda, 0xb7, 0x77, 0x81, 0x55, 0xbe, 0x73, 0x5a,
+    0xb2, 0x6f, 0x58, 0xb5, 0x18, 0x6a, 0xd2, 0x17, 0x4b, 0xbb, 0x60, 0x6a, 0xae, 0x8c, 0x93, 0x90,
+    0x3f, 0xf6, 0xdb, 0x7a, 0x5a, 0x4f, 0xc0, 0x38, 0x33, 0x0b, 0xf4, 0x5d, 0xe4, 0xed, 0xf8, 0x6d,
+    0x96, 0x65, 0xcf, 0x04, 0xb4, 0x1e, 0x08, 0x48, 0x35, 0x66, 0x12, 0xa2, 0x8a, 0x5d, 0xf8, 0x2f,
+    0x05, 0x85, 0xb8, 0x13, 0x90, 0x26, 0xcd, 0x86, 0xce, 0xc6, 0x8b, 0x4c, 0x6c, 0x06, 0x6d, 0xac,
+    0xc7, 0x6f, 0xfa, 0x36, 0xf6, 0xe2, 0x7a, 0x1c, 0x44, 0x16, 0x45, 0x96, 0xf4, 0x74, 0x34, 0x3a,
+    0x1d, 0x1c, 0x96, 0x11, 0x75, 0x9a, 0x14, 0x46, 0xba, 0x5f, 0xd8, 0x08, 0xd8, 0xda, 0xc4, 0x9a,
+    0x29, 0xad, 0x29, 0x33, 0xf4, 0x76, 0xd3, 0x8c, 0x40, 0x32, 0xba, 0x68, 0x8c, 0x8a, 0x75, 0xcd,
+    0x81, 0x30, 0x0a, 0xb4, 0x96, 0x39, 0xbf, 0x66, 0xa5, 0xf5, 0x01, 0x13, 0x43, 0x68, 0x03, 0xf6,
+    0x43, 0x2c, 0x8a, 0x1b, 0x80, 0x31, 0xa4, 0x9c, 0x72, 0x57, 0xa6, 0xbf, 0xb1, 0xd4, 0xa8, 0x66,
+    0xd4, 0xaa, 0x24, 0xdf, 0x8f, 0xd6, 0xbb, 0x39, 0x6b, 0x48, 0x1c, 0x04, 0xa6, 0x93, 0xe5, 0x7a,
+    0x8f, 0xeb, 0x7c, 0xdc, 0xef, 0xe2, 0x6f, 0x88, 0x4a, 0x19, 0x8b, 0xbb, 0x68, 0x3f, 0xb4, 0xaf,
+    0x55, 0x60, 0x2a, 0x46, 0x5c, 0x34, 0x31, 0xb9, 0x6f, 0x6f, 0x0e, 0x93, 0xdf, 0xe6, 0xc3, 0x6b,
+    0xc4, 0x17, 0xdb, 0xed, 0x29, 0x48, 0x41, 0xb3, 0x5f, 0x28, 0xd6, 0xeb, 0xfd, 0xc5, 0x64, 0x6d,
+    0x2a, 0xf3, 0x62, 0x3a, 0x6b, 0x1f, 0x76, 0xfb, 0xbf, 0x98, 0xa8, 0x29, 0x0d, 0x48, 0x2f, 0x08,
+    0xbd, 0x1a, 0xb4, 0xd3, 0xfe, 0x09, 0xf9, 0x07, 0xf7, 0x49, 0x02, 0xbf, 0x01, 0xd1, 0xb2, 0x24,
+    0x32, 0x14, 0x05, 0x00, 0x00,
+};
+
+#define WM_ASSET_LOCK_PNG_VERSION "3894a110"
+static const uint8_t WM_ASSET_LOCK_PNG[] PROGMEM = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+    0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x20, 0x08, 0x03, 0x00, 0x00, 0x00, 0x44, 0xa4, 0x8a,
+    0xc6, 0x00, 0x00, 0x00, 0x64, 0x49, 0x44, 0x41, 0x54, 0x38, 0x8d, 0xed, 0x8d, 0x4b, 0x0e, 0xc0,
+    0x20, 0x08, 0x44, 0x05, 0xa9, 0x8a, 0x9f, 0xde, 0xff, 0xb8, 0xc5, 0xc4, 0x18, 0x1b, 0xe8, 0xce,
+    0x45, 0x9b, 0xf4, 0x8d, 0x99, 0xc7, 0x8c, 0x73, 0x5b, 0x29, 0x01, 0x84, 0x50, 0x1e, 0x62, 0x9f,
+    0x60, 0x90, 0xbc, 0x99, 0x13, 0x4c, 0xc8, 0x32, 0x7a, 0x3d, 0x9f, 0x88, 0x35, 0xf6, 0x19, 0x9d,
+    0x63, 0x7f, 0x6c, 0x73, 0x0a, 0x95, 0x90, 0xe5, 0xda, 0xc6, 0x98, 0x74, 0x64, 0x25, 0xd0, 0x72,
+    0xac, 0x52, 0xa6, 0x04, 0x29, 0x38, 0xd6, 0xb9, 0xf7, 0x09, 0x11, 0x0c, 0xe2, 0xfd, 0xdd, 0xe0,
+    0x17, 0xbe, 0x29, 0xb0, 0x95, 0xb3, 0xdb, 0xc3, 0x05, 0x40, 0x7a, 0x02, 0xd2, 0xd4, 0x71, 0x9f,
+    0x64, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "wificredentials.h"
+#include <Preferences.h>
+
+#define WM_CREDENTIALS_VERSION 1
+
+WiFiCredentialStore::WiFiCredentialStore() : _loaded(false), _dirty(false) {
+    memset(&_blob, 0, sizeof(_blob));
+}
+
+void WiFiCredentialStore::load() {
+    if (_loaded) {
+        return;
+    }
+    _loaded = true;
+
+    Preferences preferences;
+    if (preferences.begin("wm", true)) {
+        size_t len = preferences.getBytes("creds", &_blob, sizeof(_blob));
+        preferences.end();
+        if (len == sizeof(_blob) && _blob.version == WM_CREDENTIALS_VERSION &&
+            _blob.count <= WIFI_MANAGER_MAX_NETWORKS) {
+            return;
+        }
+    }
+    memset(&_blob, 0, sizeof(_blob));
+    _blob.version = WM_CREDENTIALS_VERSION;
+}
+
+void WiFiCredentialStore::save() {
+    if (!_dirty) {
+        return;
+    }
+    Preferences preferences;
+    preferences.begin("wm", false);
+    preferences.putBytes("creds", &_blob, sizeof(_blob));
+    preferences.end();
+    _dirty = false;
+}
+
+int WiFiCredentialStore::count() {
+    load();
+    return _blob.count;
+}
+
+const StoredNetwork& WiFiCredentialStore::get(int i) {
+    load();
+    return _blob.networks[i];
+}
+
+int WiFiCredentialStore::find(const char* ssid) {
+    load();
+    for (int i = 0; i < _blob.count; i++) {
+        if (strcmp(_blob.networks[i].ssid, ssid) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void WiFiCredentialStore::add(const char* ssid, const char* pass) {
+    if (ssid == NULL || ssid[0] == 0) {
+        return;
+    }
+
+    int i = find(ssid);
+    if (i >= 0) {
+        StoredNetwork& net = _blob.networks[i];
+        if (strcmp(net.pass, pass) == 0) {
+            return;
+        }
+        strncpy(net.pass, pass, sizeof(net.pass) - 1);
+        net.pass[sizeof(net.pass) - 1] = 0;
+        net.failures = 0;
+        _dirty = true;
+        return;
+    }
+
+    if (_blob.count < WIFI_MANAGER_MAX_NETWORKS) {
+        i = _blob.count++;
+    } else {
+        // Replace the entry that has been least useful
+        i = 0;
+        for (int j = 1; j < _blob.count; j++) {
+            if (score(j, -100) < score(i, -100)) {
+                i = j;
+            }
+        }
+    }
+
+    StoredNetwork& net = _blob.networks[i];
+    memset(&net, 0, sizeof(net));
+    strncpy(net.ssid, ssid, sizeof(net.ssid) - 1);
+    strncpy(net.pass, pass, sizeof(net.pass) - 1);
+    net.lastRSSI = -100;
+    _dirty = true;
+}
+
+void WiFiCredentialStore::clear() {
+    load();
+    if (_blob.count == 0) {
+        return;
+    }
+    memset(_blob.networks, 0, sizeof(_blob.networks));
+    _blob.count = 0;
+    _blob.sequence = 0;
+    _dirty = true;
+}
+
+void WiFiCredentialStore::recordSuccess(int i, int8_t rssi) {
+    StoredNetwork& net = _blob.networks[i];
+    net.lastRSSI = rssi;
+    // Reconnecting to the most recent network changes nothing worth a flash write
+    if (net.lastSuccess != 0 && net.lastSuccess == _blob.sequence && net.failures == 0) {
+        return;
+    }
+    net.lastSuccess = ++_blob.sequence;
+    net.failures = 0;
+    _dirty = true;
+}
+
+void WiFiCredentialStore::recordFailure(int i, int8_t rssi) {
+    StoredNetwork& net = _blob.networks[i];
+    net.lastRSSI = rssi;
+    if (net.failures < 255) {
+        net.failures++;
+    }
+    _dirty = true;
+}
+
+int WiFiCredentialStore::score(int i, int8_t rssi) {
+    const StoredNetwork& net = _blob.networks[i];
+    int score = rssi;
+    if (net.lastSuccess != 0) {
+        score += 10;
+        if (net.lastSuccess == _blob.sequence) {
+            score += 15;
+        }
+    }
+    score -= 10 * ((net.failures < 5) ? net.failures : 5);
+    return score;
+}
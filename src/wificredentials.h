@@ -0,0 +1,58 @@
+#ifndef WiFiCredentialStore_h
+#define WiFiCredentialStore_h
+
+#include <Arduino.h>
+
+#ifndef WIFI_MANAGER_MAX_NETWORKS
+#define WIFI_MANAGER_MAX_NETWORKS 4
+#endif
+
+// One remembered network. lastSuccess is a counter value rather than a time
+// so ordering works without a real-time clock.
+struct StoredNetwork {
+    char     ssid[33];
+    char     pass[65];
+    uint32_t lastSuccess;   // 0 = never connected
+    uint8_t  failures;
+    int8_t   lastRSSI;
+};
+
+// Credentials for up to WIFI_MANAGER_MAX_NETWORKS networks, kept in NVS as a
+// single fixed-size blob and loaded on first use.
+class WiFiCredentialStore {
+public:
+    WiFiCredentialStore();
+
+    int  count();
+    const StoredNetwork& get(int i);
+    int  find(const char* ssid);
+
+    // Adds or updates a network. When full, the lowest ranked entry is replaced.
+    void add(const char* ssid, const char* pass);
+    void clear();
+
+    void recordSuccess(int i, int8_t rssi);
+    void recordFailure(int i, int8_t rssi);
+
+    // Higher is better; visible networks only
+    int  score(int i, int8_t rssi);
+
+    // Writes the blob if anything changed since it was loaded
+    void save();
+
+private:
+    struct Blob {
+        uint8_t       version;
+        uint8_t       count;
+        uint32_t      sequence;
+        StoredNetwork networks[WIFI_MANAGER_MAX_NETWORKS];
+    };
+
+    void load();
+
+    Blob _blob;
+    bool _loaded;
+    bool _dirty;
+};
+
+#endif
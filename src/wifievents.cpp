@@ -0,0 +1,42 @@
+#include "wifievents.h"
+#include <esp_wifi.h>
+
+uint32_t WiFiConnectEvents::bitsForDisconnect(uint8_t reason, uint8_t& handshakeTimeouts) {
+    switch (reason) {
+        case WIFI_REASON_AUTH_FAIL:
+            return WM_EVENT_AUTH_FAILED;
+        case WIFI_REASON_AUTH_EXPIRE:
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:
+            // Also seen with a weak link or a busy AP; only a repeat within the
+            // same attempt points at the password
+            if (handshakeTimeouts < 255) {
+                handshakeTimeouts++;
+            }
+            return (handshakeTimeouts >= WM_HANDSHAKE_TIMEOUT_LIMIT) ? WM_EVENT_AUTH_FAILED : 0;
+        case WIFI_REASON_NO_AP_FOUND:
+            return WM_EVENT_NO_AP_FOUND;
+        case WIFI_REASON_ASSOC_FAIL:
+        case WIFI_REASON_CONNECTION_FAIL:
+            return WM_EVENT_FAILED;
+        default:
+            // Leaving a previous AP and similar reasons are not a verdict on this attempt
+            return 0;
+    }
+}
+
+wm_connect_result_t WiFiConnectEvents::resultFromBits(uint32_t bits) {
+    if (bits & WM_EVENT_GOT_IP) {
+        return WM_CONNECT_OK;
+    }
+    if (bits & WM_EVENT_AUTH_FAILED) {
+        return WM_CONNECT_AUTH_FAILED;
+    }
+    if (bits & WM_EVENT_NO_AP_FOUND) {
+        return WM_CONNECT_NO_AP_FOUND;
+    }
+    if (bits & WM_EVENT_FAILED) {
+        return WM_CONNECT_FAILED;
+    }
+    return WM_CONNECT_PENDING;
+}
@@ -0,0 +1,43 @@
+#ifndef WiFiConnectEvents_h
+#define WiFiConnectEvents_h
+
+#include <Arduino.h>
+
+// Connect outcome bits, set from WiFi events and waited on by the connect functions
+#define WM_EVENT_GOT_IP         (1 << 0)
+#define WM_EVENT_AUTH_FAILED    (1 << 1)
+#define WM_EVENT_NO_AP_FOUND    (1 << 2)
+#define WM_EVENT_FAILED         (1 << 3)
+#define WM_CONNECT_EVENT_BITS   (WM_EVENT_GOT_IP | WM_EVENT_AUTH_FAILED | WM_EVENT_NO_AP_FOUND | WM_EVENT_FAILED)
+
+// Handshake timeouts within one attempt after which the password is taken to be
+// wrong. A single timeout is usually a weak link and the driver retries it.
+#ifndef WM_HANDSHAKE_TIMEOUT_LIMIT
+#define WM_HANDSHAKE_TIMEOUT_LIMIT 3
+#endif
+
+// Outcome of a connection attempt
+typedef enum {
+  WM_CONNECT_PENDING    = -1,   // still waiting for the driver
+  WM_CONNECT_OK         = 0,    // associated and got an IP address
+  WM_CONNECT_TIMEOUT,           // no definitive answer within the connect timeout
+  WM_CONNECT_AUTH_FAILED,       // wrong password or handshake failure
+  WM_CONNECT_NO_AP_FOUND,       // the network is not in range
+  WM_CONNECT_FAILED,            // other driver failure
+  WM_CONNECT_SKIPPED            // nothing was attempted
+} wm_connect_result_t;
+
+// Pure mapping between driver disconnect reasons, outcome bits and results,
+// kept apart from the event task so it can be checked on its own.
+class WiFiConnectEvents {
+public:
+    // Outcome bits for a station disconnect reason, 0 if the reason is not a
+    // verdict on the attempt. handshakeTimeouts counts the handshake timeouts
+    // of the current attempt and must be reset when an attempt starts.
+    static uint32_t bitsForDisconnect(uint8_t reason, uint8_t& handshakeTimeouts);
+
+    // Result for a set of outcome bits, WM_CONNECT_PENDING if none is set
+    static wm_connect_result_t resultFromBits(uint32_t bits);
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef WiFiManagerFeatures_h
+#define WiFiManagerFeatures_h
+
+// Optional parts of the portal. Each defaults to 1; build with e.g.
+// -DWM_FEATURE_THEMES=0 to leave that part and its strings out of the image.
+// These must be global build flags: the sketch and the library have to see the
+// same values, which a #define in the sketch cannot achieve.
+// Logging is trimmed separately with WM_LOG_LEVEL (0 removes every message),
+// and the parameter capacity with WIFI_MANAGER_MAX_PARAMS/WIFI_MANAGER_FIXED_PARAMS.
+
+// Dark stylesheet, theme toggle and setWebUITheme()/getWebUITheme()
+#ifndef WM_FEATURE_THEMES
+#define WM_FEATURE_THEMES 1
+#endif
+
+// Info page at /i
+#ifndef WM_FEATURE_INFO
+#define WM_FEATURE_INFO 1
+#endif
+
+// Reset page at /r
+#ifndef WM_FEATURE_RESET
+#define WM_FEATURE_RESET 1
+#endif
+
+// Custom parameters: addParameter(), the form fields and their NVS blob
+#ifndef WM_FEATURE_PARAMS
+#define WM_FEATURE_PARAMS 1
+#endif
+
+// JSON provisioning API under /api. Without it the "saved" page cannot show
+// the outcome of the connection attempt.
+#ifndef WM_FEATURE_JSON_API
+#define WM_FEATURE_JSON_API 1
+#endif
+
+#if (WM_FEATURE_THEMES != 0 && WM_FEATURE_THEMES != 1) || (WM_FEATURE_INFO != 0 && WM_FEATURE_INFO != 1) || \
+    (WM_FEATURE_RESET != 0 && WM_FEATURE_RESET != 1) || (WM_FEATURE_PARAMS != 0 && WM_FEATURE_PARAMS != 1) || \
+    (WM_FEATURE_JSON_API != 0 && WM_FEATURE_JSON_API != 1)
+#error "WM_FEATURE_* flags must be 0 or 1"
+#endif
+
+// The library defines one symbol named after its flags, and every manager the
+// sketch constructs refers to the one named after the sketch's. Built with other
+// values, the sketch fails to link with an undefined reference to e.g.
+// wm_config_THEMES_1_INFO_1_RESET_1_PARAMS_0_JSON_API_1.
+#define WM_CONFIG_NAME2(t, i, r, p, j) wm_config_THEMES_##t##_INFO_##i##_RESET_##r##_PARAMS_##p##_JSON_API_##j
+#define WM_CONFIG_NAME(t, i, r, p, j)  WM_CONFIG_NAME2(t, i, r, p, j)
+#define WM_CONFIG_SYMBOL WM_CONFIG_NAME(WM_FEATURE_THEMES, WM_FEATURE_INFO, WM_FEATURE_RESET, \
+                                        WM_FEATURE_PARAMS, WM_FEATURE_JSON_API)
+extern "C" const char WM_CONFIG_SYMBOL;
+
+#endif
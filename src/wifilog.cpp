@@ -0,0 +1,166 @@
+#include "wifilog.h"
+
+static_assert((WM_LOG_SLOTS & (WM_LOG_SLOTS - 1)) == 0, "WM_LOG_SLOTS must be a power of two");
+
+WiFiManagerLog::Record        WiFiManagerLog::_ring[WM_LOG_SLOTS];
+std::atomic<uint32_t>         WiFiManagerLog::_head(0);
+uint32_t                      WiFiManagerLog::_tail = 0;
+std::atomic<uint32_t>         WiFiManagerLog::_dropped(0);
+volatile bool                 WiFiManagerLog::_enabled = true;
+TaskHandle_t                  WiFiManagerLog::_task = NULL;
+
+uint32_t                      WiFiManagerLog::_droppedReported = 0;
+std::atomic_flag              WiFiManagerLog::_draining = ATOMIC_FLAG_INIT;
+
+// Bounded MPSC queue: a producer owns the slot for position p when its
+// sequence is p, the consumer when it is p + 1. Sequences are stored minus the
+// slot index so the zero-initialised ring starts out valid.
+#define SLOT_SEQ(r, index) ((r).seq.load(std::memory_order_acquire) + (index))
+
+void WiFiManagerLog::setEnabled(bool enabled) {
+    _enabled = enabled;
+}
+
+WiFiManagerLog::Record* WiFiManagerLog::reserve(uint8_t level, const char* msg, Kind kind) {
+    uint32_t pos = _head.load(std::memory_order_relaxed);
+    Record* r;
+    for (;;) {
+        r = &_ring[pos & (WM_LOG_SLOTS - 1)];
+        int32_t diff = (int32_t)(SLOT_SEQ(*r, pos & (WM_LOG_SLOTS - 1)) - pos);
+        if (diff == 0) {
+            if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        } else {
+            pos = _head.load(std::memory_order_relaxed);
+        }
+    }
+    r->time = millis();
+    r->msg = msg;
+    r->level = level;
+    r->kind = kind;
+    return r;
+}
+
+void WiFiManagerLog::commit(Record* r) {
+    r->seq.fetch_add(1, std::memory_order_release);
+    if (_task != NULL) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+void WiFiManagerLog::log(uint8_t level, const char* msg) {
+    Record* r = reserve(level, msg, KIND_NONE);
+    if (r != NULL) {
+        commit(r);
+    }
+}
+
+void WiFiManagerLog::log(uint8_t level, const char* msg, int32_t value) {
+    Record* r = reserve(level, msg, KIND_INT);
+    if (r != NULL) {
+        r->value = value;
+        commit(r);
+    }
+}
+
+void WiFiManagerLog::log(uint8_t level, const char* msg, const char* text) {
+    Record* r = reserve(level, msg, KIND_TEXT);
+    if (r != NULL) {
+        strncpy(r->text, (text != NULL) ? text : "", WM_LOG_TEXT_LEN - 1);
+        r->text[WM_LOG_TEXT_LEN - 1] = 0;
+        commit(r);
+    }
+}
+
+void WiFiManagerLog::log(uint8_t level, const char* msg, const String& text) {
+    log(level, msg, text.c_str());
+}
+
+void WiFiManagerLog::log(uint8_t level, const char* msg, const IPAddress& ip) {
+    Record* r = reserve(level, msg, KIND_IP);
+    if (r != NULL) {
+        r->value = (int32_t)(uint32_t)ip;
+        commit(r);
+    }
+}
+
+void WiFiManagerLog::logSecret(uint8_t level, const char* msg) {
+    Record* r = reserve(level, msg, KIND_SECRET);
+    if (r != NULL) {
+        commit(r);
+    }
+}
+
+void WiFiManagerLog::print(const Record& r) {
+    static const char LEVELS[] = "-EWID";
+    Serial.print("*WM: [");
+    Serial.print(LEVELS[r.level]);
+    Serial.print("] ");
+    Serial.print(r.msg);
+    switch (r.kind) {
+        case KIND_INT:
+            Serial.print(' ');
+            Serial.print(r.value);
+            break;
+        case KIND_TEXT:
+            Serial.print(' ');
+            Serial.print(r.text);
+            break;
+        case KIND_IP: {
+            IPAddress ip((uint32_t)r.value);
+            for (int i = 0; i < 4; i++) {
+                Serial.print((i == 0) ? ' ' : '.');
+                Serial.print(ip[i]);
+            }
+            break;
+        }
+        case KIND_SECRET:
+            Serial.print(" <redacted>");
+            break;
+        default:
+            break;
+    }
+    Serial.println();
+}
+
+void WiFiManagerLog::flush() {
+    // Single consumer: a flush already running elsewhere drains for us
+    if (_draining.test_and_set(std::memory_order_acquire)) {
+        return;
+    }
+    for (;;) {
+        uint32_t index = _tail & (WM_LOG_SLOTS - 1);
+        Record& r = _ring[index];
+        if (SLOT_SEQ(r, index) != _tail + 1) {
+            break;
+        }
+        print(r);
+        r.seq.fetch_add(WM_LOG_SLOTS - 1, std::memory_order_release);
+        _tail++;
+    }
+    uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _droppedReported) {
+        Serial.print("*WM: [W] log records dropped: ");
+        Serial.println(dropped - _droppedReported);
+        _droppedReported = dropped;
+    }
+    _draining.clear(std::memory_order_release);
+}
+
+void WiFiManagerLog::taskLoop(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        flush();
+    }
+}
+
+bool WiFiManagerLog::startTask(UBaseType_t priority, BaseType_t core) {
+    if (_task != NULL) {
+        return true;
+    }
+    return xTaskCreatePinnedToCore(taskLoop, "wm_log", 3072, NULL, priority, &_task, core) == pdPASS;
+}
@@ -0,0 +1,112 @@
+#ifndef WiFiManagerLog_h
+#define WiFiManagerLog_h
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define WM_LOG_LEVEL_NONE  0
+#define WM_LOG_LEVEL_ERROR 1
+#define WM_LOG_LEVEL_WARN  2
+#define WM_LOG_LEVEL_INFO  3
+#define WM_LOG_LEVEL_DEBUG 4
+
+// Messages above this level are removed at compile time, arguments included
+#ifndef WM_LOG_LEVEL
+#define WM_LOG_LEVEL WM_LOG_LEVEL_INFO
+#endif
+
+// Ring capacity in records, a power of two
+#ifndef WM_LOG_SLOTS
+#define WM_LOG_SLOTS 32
+#endif
+
+// Longest string argument kept per record
+#ifndef WM_LOG_TEXT_LEN
+#define WM_LOG_TEXT_LEN 33
+#endif
+
+// Log records are queued in a fixed lock-free ring as a message pointer plus
+// one typed argument, and printed to Serial later by flush() or a background
+// task. Messages must be string literals. A full ring drops new records.
+class WiFiManagerLog {
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return _enabled; }
+
+    static void log(uint8_t level, const char* msg);
+    static void log(uint8_t level, const char* msg, int32_t value);
+    static void log(uint8_t level, const char* msg, const char* text);
+    static void log(uint8_t level, const char* msg, const String& text);
+    static void log(uint8_t level, const char* msg, const IPAddress& ip);
+    // Records that a secret was handled without storing its value
+    static void logSecret(uint8_t level, const char* msg);
+
+    // Prints every queued record; returns at once if another task is already draining
+    static void flush();
+    // Drains the ring from a task instead of flush() calls
+    static bool startTask(UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY);
+    static bool hasTask() { return _task != NULL; }
+    // flush() unless the task owns draining
+    static void poll() { if (_task == NULL) flush(); }
+
+    // Records lost to a full ring since boot
+    static uint32_t getDropped() { return _dropped; }
+
+private:
+    enum Kind : uint8_t { KIND_NONE, KIND_INT, KIND_TEXT, KIND_IP, KIND_SECRET };
+
+    struct Record {
+        std::atomic<uint32_t> seq;
+        uint32_t    time;
+        const char* msg;
+        int32_t     value;
+        uint8_t     level;
+        Kind        kind;
+        char        text[WM_LOG_TEXT_LEN];
+    };
+
+    static Record* reserve(uint8_t level, const char* msg, Kind kind);
+    static void    commit(Record* r);
+    static void    print(const Record& r);
+    static void    taskLoop(void* arg);
+
+    static Record                 _ring[WM_LOG_SLOTS];
+    static std::atomic<uint32_t>  _head;
+    static uint32_t               _tail;
+    static std::atomic<uint32_t>  _dropped;
+    static uint32_t               _droppedReported;
+    static std::atomic_flag       _draining;
+    static volatile bool          _enabled;
+    static TaskHandle_t           _task;
+};
+
+#if WM_LOG_LEVEL >= WM_LOG_LEVEL_ERROR
+#define WM_LOG_E(...) do { if (WiFiManagerLog::isEnabled()) WiFiManagerLog::log(WM_LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#else
+#define WM_LOG_E(...) do {} while (0)
+#endif
+
+#if WM_LOG_LEVEL >= WM_LOG_LEVEL_WARN
+#define WM_LOG_W(...) do { if (WiFiManagerLog::isEnabled()) WiFiManagerLog::log(WM_LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#else
+#define WM_LOG_W(...) do {} while (0)
+#endif
+
+#if WM_LOG_LEVEL >= WM_LOG_LEVEL_INFO
+#define WM_LOG_I(...) do { if (WiFiManagerLog::isEnabled()) WiFiManagerLog::log(WM_LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#define WM_LOG_SECRET(msg) do { if (WiFiManagerLog::isEnabled()) WiFiManagerLog::logSecret(WM_LOG_LEVEL_INFO, msg); } while (0)
+#else
+#define WM_LOG_I(...) do {} while (0)
+#define WM_LOG_SECRET(msg) do {} while (0)
+#endif
+
+#if WM_LOG_LEVEL >= WM_LOG_LEVEL_DEBUG
+#define WM_LOG_D(...) do { if (WiFiManagerLog::isEnabled()) WiFiManagerLog::log(WM_LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#else
+#define WM_LOG_D(...) do {} while (0)
+#endif
+
+#endif
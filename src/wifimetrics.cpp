@@ -0,0 +1,118 @@
+#include "wifimetrics.h"
+
+#ifdef WM_METRICS
+
+#include "webui.h"
+
+static const uint32_t BUCKET_BOUNDS[WM_METRIC_BUCKETS] = {
+    1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000, 10000000
+};
+
+static const char* const BUCKET_LABELS[WM_METRIC_BUCKETS + 1] = {
+    "0.001", "0.005", "0.01", "0.05", "0.1", "0.5", "1", "5", "10", "+Inf"
+};
+
+// Label values, in wm_metric_t order
+static const char* const METRIC_NAMES[WM_METRIC_COUNT] = {
+    "root", "wifi", "wifi_noscan", "wifisave", "info", "reset", "theme_toggle",
+    "scan_json", "not_found", "captive_redirect", "scan", "connect", "dns", "api",
+    "probe_android", "probe_apple", "probe_windows", "probe_other"
+};
+
+wm_metric_stats_t WiFiManagerMetrics::_stats[WM_METRIC_COUNT];
+uint32_t          WiFiManagerMetrics::_bytes = 0;
+thread_local WiFiManagerMetrics::Scope* WiFiManagerMetrics::_current = NULL;
+
+void WiFiManagerMetrics::record(wm_metric_t id, uint32_t micros, uint32_t bytes, uint32_t heapDrop) {
+    wm_metric_stats_t& s = _stats[id];
+    s.count++;
+    s.totalMicros += micros;
+    s.bytes += bytes;
+    if (heapDrop > s.maxHeapDrop) {
+        s.maxHeapDrop = heapDrop;
+    }
+    int b = 0;
+    while (b < WM_METRIC_BUCKETS && micros > BUCKET_BOUNDS[b]) {
+        b++;
+    }
+    s.buckets[b]++;
+}
+
+const wm_metric_stats_t& WiFiManagerMetrics::get(wm_metric_t id) {
+    return _stats[id];
+}
+
+void WiFiManagerMetrics::reset() {
+    memset(_stats, 0, sizeof(_stats));
+}
+
+// Writes "<name>{handler="<label>"" and leaves the label set open
+static void writeSeries(PageWriter& page, const char* name, int id) {
+    page.write(name);
+    page.write("{handler=\"");
+    page.write(METRIC_NAMES[id]);
+    page.write("\"");
+}
+
+static void writeSeconds(PageWriter& page, uint64_t micros) {
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%llu.%06u",
+                                      (unsigned long long)(micros / 1000000), (unsigned)(micros % 1000000));
+    page.write(num, n);
+}
+
+void WiFiManagerMetrics::write(PageWriter& page) {
+    page.write("# TYPE wm_requests_total counter\n");
+    for (int i = 0; i < WM_METRIC_COUNT; i++) {
+        writeSeries(page, "wm_requests_total", i);
+        page.write("} ");
+        page.write(_stats[i].count);
+        page.write("\n");
+    }
+
+    page.write("# TYPE wm_latency_seconds histogram\n");
+    for (int i = 0; i < WM_METRIC_COUNT; i++) {
+        uint32_t cumulative = 0;
+        for (int b = 0; b <= WM_METRIC_BUCKETS; b++) {
+            cumulative += _stats[i].buckets[b];
+            writeSeries(page, "wm_latency_seconds_bucket", i);
+            page.write(",le=\"");
+            page.write(BUCKET_LABELS[b]);
+            page.write("\"} ");
+            page.write(cumulative);
+            page.write("\n");
+        }
+        writeSeries(page, "wm_latency_seconds_sum", i);
+        page.write("} ");
+        writeSeconds(page, _stats[i].totalMicros);
+        page.write("\n");
+        writeSeries(page, "wm_latency_seconds_count", i);
+        page.write("} ");
+        page.write(_stats[i].count);
+        page.write("\n");
+    }
+
+    page.write("# TYPE wm_response_bytes_total counter\n");
+    for (int i = 0; i < WM_METRIC_COUNT; i++) {
+        writeSeries(page, "wm_response_bytes_total", i);
+        page.write("} ");
+        page.write(_stats[i].bytes);
+        page.write("\n");
+    }
+
+    page.write("# TYPE wm_heap_min_free_drop_bytes gauge\n");
+    for (int i = 0; i < WM_METRIC_COUNT; i++) {
+        writeSeries(page, "wm_heap_min_free_drop_bytes", i);
+        page.write("} ");
+        page.write(_stats[i].maxHeapDrop);
+        page.write("\n");
+    }
+
+    page.write("# TYPE wm_heap_free_bytes gauge\nwm_heap_free_bytes ");
+    page.write((uint32_t)ESP.getFreeHeap());
+    page.write("\n# TYPE wm_heap_min_free_bytes gauge\nwm_heap_min_free_bytes ");
+    page.write((uint32_t)ESP.getMinFreeHeap());
+    page.write("\n");
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef WiFiManagerMetrics_h
+#define WiFiManagerMetrics_h
+
+#include <Arduino.h>
+
+// Build with -DWM_METRICS to record per-handler latency, response bytes and
+// heap low-water drops, served at /metrics. Without it the hooks below expand
+// to nothing.
+#ifdef WM_METRICS
+
+typedef enum {
+    WM_METRIC_ROOT = 0,
+    WM_METRIC_WIFI,
+    WM_METRIC_WIFI_NOSCAN,
+    WM_METRIC_WIFISAVE,
+    WM_METRIC_INFO,
+    WM_METRIC_RESET,
+    WM_METRIC_THEME,
+    WM_METRIC_SCAN_JSON,
+    WM_METRIC_NOT_FOUND,
+    WM_METRIC_CAPTIVE,
+    WM_METRIC_SCAN,
+    WM_METRIC_CONNECT,
+    WM_METRIC_DNS,
+    WM_METRIC_API,
+    WM_METRIC_PROBE_ANDROID,    // OS connectivity checks answered by PortalServer,
+    WM_METRIC_PROBE_APPLE,      // measured from the start of request parsing
+    WM_METRIC_PROBE_WINDOWS,
+    WM_METRIC_PROBE_OTHER,
+    WM_METRIC_COUNT
+} wm_metric_t;
+
+// Upper bounds of the latency buckets in microseconds; one more bucket counts the rest
+#define WM_METRIC_BUCKETS 9
+
+typedef struct {
+    uint32_t count;
+    uint64_t totalMicros;
+    uint32_t buckets[WM_METRIC_BUCKETS + 1];
+    uint64_t bytes;
+    uint32_t maxHeapDrop;   // largest fall of the minimum free heap during one call
+} wm_metric_stats_t;
+
+class PageWriter;
+
+class WiFiManagerMetrics {
+public:
+    static void record(wm_metric_t id, uint32_t micros, uint32_t bytes = 0, uint32_t heapDrop = 0);
+    static void addBytes(size_t n) { _bytes += n; }
+
+    static const wm_metric_stats_t& get(wm_metric_t id);
+    static void reset();
+
+    // Prometheus text exposition format
+    static void write(PageWriter& page);
+
+    // Measures the enclosing block. Time and bytes of a scope nested inside it
+    // (a handler that ends in a captive redirect) are left to the inner one, so
+    // each microsecond is counted once.
+    class Scope {
+    public:
+        Scope(wm_metric_t id)
+            : _id(id), _parent(_current), _start(micros()), _bytes(WiFiManagerMetrics::_bytes),
+              _minHeap(ESP.getMinFreeHeap()), _nestedMicros(0), _nestedBytes(0) {
+            _current = this;
+        }
+        ~Scope() {
+            uint32_t elapsed = micros() - _start;
+            uint32_t bytes = WiFiManagerMetrics::_bytes - _bytes;
+            uint32_t minHeap = ESP.getMinFreeHeap();
+            _current = _parent;
+            if (_parent != NULL) {
+                _parent->_nestedMicros += elapsed;
+                _parent->_nestedBytes += bytes;
+            }
+            WiFiManagerMetrics::record(_id, elapsed - _nestedMicros, bytes - _nestedBytes,
+                                       (minHeap < _minHeap) ? _minHeap - minHeap : 0);
+        }
+    private:
+        wm_metric_t _id;
+        Scope*      _parent;
+        uint32_t    _start;
+        uint32_t    _bytes;
+        uint32_t    _minHeap;
+        uint32_t    _nestedMicros;
+        uint32_t    _nestedBytes;
+    };
+
+private:
+    static wm_metric_stats_t _stats[WM_METRIC_COUNT];
+    static uint32_t          _bytes;
+    // Innermost open scope of the calling task. The reconnect supervisor opens
+    // scopes from its own task, so each task keeps its own chain.
+    static thread_local Scope* _current;
+};
+
+#define WM_METRIC_SCOPE(id)           WiFiManagerMetrics::Scope _wmMetricScope(id)
+#define WM_METRIC_RECORD(id, micros)  WiFiManagerMetrics::record(id, micros)
+#define WM_METRIC_BYTES(n)            WiFiManagerMetrics::addBytes(n)
+
+#else
+
+#define WM_METRIC_SCOPE(id)
+#define WM_METRIC_RECORD(id, micros)
+#define WM_METRIC_BYTES(n)
+
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+#include "wifiparams.h"
+#include "SimpleWiFiManager.h"
+#include <Preferences.h>
+
+#define WM_PARAMS_VERSION 1
+
+static uint32_t paramsCrc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+WiFiParameterStore::WiFiParameterStore() : _buffer(NULL), _size(0), _loaded(false) {
+}
+
+WiFiParameterStore::~WiFiParameterStore() {
+    free(_buffer);
+}
+
+// Checks the header, the CRC and that every entry lies inside the buffer
+bool WiFiParameterStore::valid(const uint8_t* buf, size_t len) {
+    if (len < sizeof(Header)) {
+        return false;
+    }
+    Header header;
+    memcpy(&header, buf, sizeof(header));
+    if (header.version != WM_PARAMS_VERSION || header.size != len - sizeof(Header) ||
+        header.crc != paramsCrc32(buf + sizeof(Header), header.size)) {
+        return false;
+    }
+
+    size_t pos = sizeof(Header);
+    for (int i = 0; i < header.count; i++) {
+        if (pos + 1 > len) {
+            return false;
+        }
+        pos += 1 + buf[pos];
+        if (pos + 2 > len) {
+            return false;
+        }
+        size_t valueLen = buf[pos] | (buf[pos + 1] << 8);
+        pos += 2 + valueLen + 1;
+        if (pos > len || buf[pos - 1] != 0) {
+            return false;
+        }
+    }
+    return pos == len;
+}
+
+void WiFiParameterStore::load() {
+    if (_loaded) {
+        return;
+    }
+    _loaded = true;
+
+    Preferences preferences;
+    if (!preferences.begin("wm", true)) {
+        return;
+    }
+    size_t len = preferences.getBytesLength("params");
+    if (len > 0 && len <= sizeof(Header) + 0xFFFF) {
+        _buffer = (uint8_t*)malloc(len);
+        if (_buffer != NULL) {
+            if (preferences.getBytes("params", _buffer, len) == len && valid(_buffer, len)) {
+                _size = len;
+            } else {
+                free(_buffer);
+                _buffer = NULL;
+            }
+        }
+    }
+    preferences.end();
+}
+
+const char* WiFiParameterStore::find(const char* id) {
+    load();
+    if (_buffer == NULL || id == NULL) {
+        return NULL;
+    }
+
+    Header header;
+    memcpy(&header, _buffer, sizeof(header));
+    size_t idLen = strlen(id);
+    size_t pos = sizeof(Header);
+    for (int i = 0; i < header.count; i++) {
+        size_t len = _buffer[pos];
+        const char* entryId = (const char*)&_buffer[pos + 1];
+        pos += 1 + len;
+        size_t valueLen = _buffer[pos] | (_buffer[pos + 1] << 8);
+        pos += 2;
+        if (len == idLen && memcmp(entryId, id, len) == 0) {
+            return (const char*)&_buffer[pos];
+        }
+        pos += valueLen + 1;
+    }
+    return NULL;
+}
+
+bool WiFiParameterStore::save(WiFiManagerParameter** params, int count) {
+    load();
+
+    size_t len = sizeof(Header);
+    int stored = 0;
+    for (int i = 0; i < count; i++) {
+        const char* id = params[i]->getID();
+        if (id == NULL || strlen(id) > 255) {
+            continue;
+        }
+        len += 1 + strlen(id) + 2 + strlen(params[i]->getValue()) + 1;
+        stored++;
+    }
+    if (len > sizeof(Header) + 0xFFFF || stored > 255) {
+        return false;
+    }
+
+    uint8_t* buf = (uint8_t*)malloc(len);
+    if (buf == NULL) {
+        return false;
+    }
+    size_t pos = sizeof(Header);
+    for (int i = 0; i < count; i++) {
+        const char* id = params[i]->getID();
+        if (id == NULL || strlen(id) > 255) {
+            continue;
+        }
+        size_t idLen = strlen(id);
+        size_t valueLen = strlen(params[i]->getValue());
+        buf[pos++] = idLen;
+        memcpy(&buf[pos], id, idLen);
+        pos += idLen;
+        buf[pos++] = valueLen & 0xFF;
+        buf[pos++] = valueLen >> 8;
+        memcpy(&buf[pos], params[i]->getValue(), valueLen + 1);
+        pos += valueLen + 1;
+    }
+
+    Header header;
+    header.version = WM_PARAMS_VERSION;
+    header.count = stored;
+    header.size = len - sizeof(Header);
+    header.crc = paramsCrc32(buf + sizeof(Header), header.size);
+    memcpy(buf, &header, sizeof(header));
+
+    if (_buffer != NULL && _size == len && memcmp(_buffer, buf, len) == 0) {
+        free(buf);
+        return false;
+    }
+
+    Preferences preferences;
+    preferences.begin("wm", false);
+    preferences.putBytes("params", buf, len);
+    preferences.end();
+
+    free(_buffer);
+    _buffer = buf;
+    _size = len;
+    return true;
+}
+
+void WiFiParameterStore::clear() {
+    Preferences preferences;
+    preferences.begin("wm", false);
+    preferences.remove("params");
+    preferences.end();
+
+    free(_buffer);
+    _buffer = NULL;
+    _size = 0;
+    _loaded = true;
+}
+
+size_t WiFiParameterStore::size() {
+    load();
+    return _size;
+}
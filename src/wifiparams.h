@@ -0,0 +1,43 @@
+#ifndef WiFiParameterStore_h
+#define WiFiParameterStore_h
+
+#include <Arduino.h>
+
+class WiFiManagerParameter;
+
+// Custom parameter values kept in NVS as one CRC-checked blob:
+//   header | idLen(1) id | valueLen(2) value '\0' | ...
+// The blob is loaded into a single buffer and find() returns pointers into it,
+// so values need no per-parameter copies.
+class WiFiParameterStore {
+public:
+    WiFiParameterStore();
+    ~WiFiParameterStore();
+
+    // Value stored for id, or NULL. Valid until the next save() or clear().
+    const char* find(const char* id);
+
+    // Rebuilds the blob from the parameters' current values and writes it
+    // when it differs from what is stored. Returns true if NVS was written.
+    bool        save(WiFiManagerParameter** params, int count);
+    void        clear();
+
+    size_t      size();
+
+private:
+    struct Header {
+        uint8_t  version;
+        uint8_t  count;
+        uint16_t size;      // bytes after the header
+        uint32_t crc;
+    };
+
+    void load();
+    bool valid(const uint8_t* buf, size_t len);
+
+    uint8_t* _buffer;
+    size_t   _size;
+    bool     _loaded;
+};
+
+#endif
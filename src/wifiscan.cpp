@@ -0,0 +1,228 @@
+#include "wifiscan.h"
+#include <algorithm>
+#include "wifimetrics.h"
+
+WiFiScanCache::WiFiScanCache()
+    : _count(0), _capacity(0), _maxRecords(0), _active(false), _scanning(false), _abandoned(false), _hasResults(false),
+      _refreshRequested(false), _ttl(60000), _lastScan(0), _scanStart(0) {
+}
+
+void WiFiScanCache::begin() {
+    _active = true;
+    if (abandonedScanRunning()) {
+        // Still running from the previous portal: taken over instead of started again
+        _abandoned = false;
+        _scanning = true;
+        _scanStart = millis();
+        return;
+    }
+    // A recent snapshot, e.g. from autoConnect(), is shown until the first scan completes
+    if (!_hasResults || millis() - _lastScan >= WM_SCAN_MIN_INTERVAL) {
+        startScan();
+    }
+}
+
+void WiFiScanCache::end() {
+    // Not waited for: called from process(), which must not block. The results
+    // of a running scan are dropped when it is next polled.
+    _abandoned = _abandoned || _scanning;
+    WiFi.scanDelete();
+    _active = false;
+    _scanning = false;
+    release();
+}
+
+// Polls a scan left running by end(), and drops its results once it is done
+bool WiFiScanCache::abandonedScanRunning() {
+    if (!_abandoned) {
+        return false;
+    }
+    if (WiFi.scanComplete() == WIFI_SCAN_RUNNING) {
+        return true;
+    }
+    WiFi.scanDelete();
+    _abandoned = false;
+    return false;
+}
+
+bool WiFiScanCache::scanNow() {
+    WM_METRIC_SCOPE(WM_METRIC_SCAN);
+    // The driver refuses a new scan while one is running; this call blocks anyway
+    while (abandonedScanRunning()) {
+        delay(10);
+    }
+    int16_t n = WiFi.scanNetworks();
+    _lastScan = millis();
+    if (n < 0) {
+        WiFi.scanDelete();
+        return false;
+    }
+    copyResults(n);
+    WiFi.scanDelete();
+    return true;
+}
+
+void WiFiScanCache::release() {
+    _records.reset();
+    _capacity = 0;
+    _count = 0;
+    _hasResults = false;
+}
+
+void WiFiScanCache::loop(bool allowScan) {
+    if (!_active) {
+        return;
+    }
+
+    if (_scanning) {
+        int16_t n = WiFi.scanComplete();
+        if (n == WIFI_SCAN_RUNNING) {
+            return;
+        }
+        _scanning = false;
+        WM_METRIC_RECORD(WM_METRIC_SCAN, (millis() - _scanStart) * 1000);
+        _lastScan = millis();
+        if (n >= 0) {
+            copyResults(n);
+        }
+        WiFi.scanDelete();
+        return;
+    }
+
+    if (!allowScan) {
+        return;
+    }
+    unsigned long age = millis() - _lastScan;
+    if ((_refreshRequested && age >= WM_SCAN_MIN_INTERVAL) || (_ttl > 0 && age >= _ttl)) {
+        startScan();
+    }
+}
+
+void WiFiScanCache::requestRefresh() {
+    _refreshRequested = true;
+}
+
+void WiFiScanCache::setTTL(unsigned long milliseconds) {
+    _ttl = milliseconds;
+}
+
+void WiFiScanCache::setMaxRecords(int max) {
+    _maxRecords = max;
+}
+
+bool WiFiScanCache::isScanning() {
+    return _scanning;
+}
+
+bool WiFiScanCache::hasResults() {
+    return _hasResults;
+}
+
+int WiFiScanCache::count() {
+    return _count;
+}
+
+const ScanRecord& WiFiScanCache::get(int i) {
+    return _records[i];
+}
+
+int WiFiScanCache::find(const char* ssid) {
+    // Records are sorted strongest first
+    for (int i = 0; i < _count; i++) {
+        if (strcmp(_records[i].ssid, ssid) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void WiFiScanCache::startScan() {
+    _refreshRequested = false;
+    _scanStart = millis();
+    _scanning = WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING;
+    if (!_scanning) {
+        _lastScan = millis();
+    }
+}
+
+void WiFiScanCache::copyResults(int n) {
+    int keep = (_maxRecords > 0 && n > _maxRecords) ? _maxRecords : n;
+    if (keep > _capacity) {
+        _records.reset(new ScanRecord[keep]);
+        _capacity = keep;
+    }
+
+    _count = 0;
+    for (int i = 0; i < n; i++) {
+        wifi_ap_record_t* ap = (wifi_ap_record_t*)WiFi.getScanInfoByIndex(i);
+        if (ap == NULL) {
+            continue;
+        }
+        int slot = _count;
+        if (_count == keep) {
+            // Full: this one replaces the weakest record if it is stronger
+            slot = 0;
+            for (int j = 1; j < _count; j++) {
+                if (_records[j].rssi < _records[slot].rssi) {
+                    slot = j;
+                }
+            }
+            if (ap->rssi <= _records[slot].rssi) {
+                continue;
+            }
+        } else {
+            _count++;
+        }
+        ScanRecord& r = _records[slot];
+        memcpy(r.ssid, ap->ssid, sizeof(r.ssid) - 1);
+        r.ssid[sizeof(r.ssid) - 1] = 0;
+        r.rssi = ap->rssi;
+        r.auth = ap->authmode;
+        r.channel = ap->primary;
+        memcpy(r.bssid, ap->bssid, sizeof(r.bssid));
+        r.duplicate = false;
+    }
+
+    std::sort(_records.get(), _records.get() + _count, [](const ScanRecord& a, const ScanRecord& b) {
+        return a.rssi > b.rssi;
+    });
+    markDuplicates();
+    _hasResults = true;
+}
+
+static uint32_t hashSSID(const char* ssid) {
+    // FNV-1a
+    uint32_t hash = 2166136261UL;
+    while (*ssid) {
+        hash ^= (uint8_t)*ssid++;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+void WiFiScanCache::markDuplicates() {
+    if (_count < 2) {
+        return;
+    }
+
+    // Open addressing set of record indices (+1, 0 = empty), at most half full
+    size_t size = 4;
+    while (size < (size_t)_count * 2) {
+        size <<= 1;
+    }
+    std::unique_ptr<uint16_t[]> slots(new uint16_t[size]());
+
+    for (int i = 0; i < _count; i++) {
+        size_t pos = hashSSID(_records[i].ssid) & (size - 1);
+        while (slots[pos] != 0) {
+            if (strcmp(_records[slots[pos] - 1].ssid, _records[i].ssid) == 0) {
+                _records[i].duplicate = true;
+                break;
+            }
+            pos = (pos + 1) & (size - 1);
+        }
+        if (!_records[i].duplicate) {
+            slots[pos] = i + 1;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef WiFiScanCache_h
+#define WiFiScanCache_h
+
+#include <WiFi.h>
+#include <memory>
+
+// Minimum age of the snapshot before an on-demand refresh starts a new scan
+#ifndef WM_SCAN_MIN_INTERVAL
+#define WM_SCAN_MIN_INTERVAL 10000
+#endif
+
+// One access point copied out of the driver's scan list
+struct ScanRecord {
+    char    ssid[33];
+    int8_t  rssi;
+    uint8_t auth;
+    uint8_t channel;
+    uint8_t bssid[6];
+    bool    duplicate;  // a stronger record with the same SSID comes earlier
+};
+
+// Runs WiFi scans asynchronously and keeps a snapshot of the last results,
+// so pages can be rendered without waiting for the radio. The snapshot is
+// sorted strongest first and duplicate SSIDs are flagged once per scan.
+class WiFiScanCache {
+public:
+    WiFiScanCache();
+
+    void begin();
+    // Returns at once; a scan still running is left to the driver (see _abandoned)
+    void end();
+
+    // Scans synchronously and replaces the snapshot, for use outside the portal
+    bool scanNow();
+
+    // Polls the running scan and starts a new one when the snapshot expires.
+    // New scans are only started while allowScan is true.
+    void loop(bool allowScan = true);
+
+    // Starts a scan on the next loop() unless the snapshot is still fresh
+    void requestRefresh();
+    void setTTL(unsigned long milliseconds);
+    // Keeps only the strongest max records of each scan; 0 keeps all
+    void setMaxRecords(int max);
+
+    bool isScanning();
+    bool hasResults();
+    int  count();
+    const ScanRecord& get(int i);
+    // Index of the strongest record with this SSID, or -1
+    int  find(const char* ssid);
+
+private:
+    void startScan();
+    void copyResults(int n);
+    void release();
+    void markDuplicates();
+    bool abandonedScanRunning();
+
+    std::unique_ptr<ScanRecord[]> _records;
+    int           _count;
+    int           _capacity;
+    int           _maxRecords;
+    bool          _active;
+    bool          _scanning;
+    bool          _abandoned;     // scan left running by end(), not polled since
+    bool          _hasResults;
+    bool          _refreshRequested;
+    unsigned long _ttl;
+    unsigned long _lastScan;
+    unsigned long _scanStart;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "wifisettings.h"
+#include <Preferences.h>
+
+#define WM_SETTINGS_VERSION 1
+
+WiFiSettingsStore::WiFiSettingsStore()
+    : _loaded(false), _dirty(false), _changedAt(0), _changes(0), _writes(0) {
+    memset(&_blob, 0, sizeof(_blob));
+}
+
+void WiFiSettingsStore::load() {
+    if (_loaded) {
+        return;
+    }
+    _loaded = true;
+
+    memset(&_blob, 0, sizeof(_blob));
+    _blob.version = WM_SETTINGS_VERSION;
+    _blob.theme = WM_WEBUI_THEME_DARK; // デフォルトはダークモード
+    strcpy(_blob.title, "SimpleWiFiManager");
+
+    Preferences preferences;
+    if (!preferences.begin("webui", true)) {
+        return;
+    }
+    Blob stored;
+    size_t len = preferences.getBytes("settings", &stored, sizeof(stored));
+    if (len == sizeof(stored) && stored.version == WM_SETTINGS_VERSION) {
+        stored.title[WM_SETTINGS_TITLE_LEN - 1] = 0;
+        _blob = stored;
+    } else {
+        // Theme saved by earlier versions
+        _blob.theme = preferences.getInt("theme", WM_WEBUI_THEME_DARK);
+    }
+    preferences.end();
+}
+
+void WiFiSettingsStore::touch() {
+    _changes++;
+    _dirty = true;
+    _changedAt = millis();
+}
+
+int WiFiSettingsStore::getTheme() {
+    load();
+    return _blob.theme;
+}
+
+void WiFiSettingsStore::setTheme(int theme) {
+    load();
+    if (_blob.theme == theme) {
+        _changes++;
+        return;
+    }
+    _blob.theme = theme;
+    touch();
+}
+
+const char* WiFiSettingsStore::getTitle() {
+    load();
+    return _blob.title;
+}
+
+void WiFiSettingsStore::setTitle(const char* title) {
+    load();
+    if (title == NULL || strncmp(_blob.title, title, WM_SETTINGS_TITLE_LEN - 1) == 0) {
+        _changes++;
+        return;
+    }
+    strncpy(_blob.title, title, WM_SETTINGS_TITLE_LEN - 1);
+    _blob.title[WM_SETTINGS_TITLE_LEN - 1] = 0;
+    touch();
+}
+
+void WiFiSettingsStore::loop() {
+    if (_dirty && millis() - _changedAt >= WM_SETTINGS_FLUSH_DELAY) {
+        flush();
+    }
+}
+
+void WiFiSettingsStore::flush() {
+    if (!_dirty) {
+        return;
+    }
+    Preferences preferences;
+    if (preferences.begin("webui", false)) {
+        preferences.putBytes("settings", &_blob, sizeof(_blob));
+        preferences.end();
+        _writes++;
+    }
+    _dirty = false;
+}
+
+bool WiFiSettingsStore::isDirty() {
+    return _dirty;
+}
+
+uint32_t WiFiSettingsStore::getWriteCount() {
+    return _writes;
+}
+
+uint32_t WiFiSettingsStore::getAvoidedWriteCount() {
+    return _changes > _writes ? _changes - _writes : 0;
+}
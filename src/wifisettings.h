@@ -0,0 +1,58 @@
+#ifndef WiFiSettingsStore_h
+#define WiFiSettingsStore_h
+
+#include <Arduino.h>
+
+// Delay after the last change before the snapshot is written to NVS
+#ifndef WM_SETTINGS_FLUSH_DELAY
+#define WM_SETTINGS_FLUSH_DELAY 5000
+#endif
+
+#define WM_SETTINGS_TITLE_LEN 64
+
+// WebUI Theme constants
+#define WM_WEBUI_THEME_LIGHT 0
+#define WM_WEBUI_THEME_DARK  1
+
+// In-RAM snapshot of the user settings (theme, title). Changes only mark it
+// dirty. loop() writes the blob once changes have settled and flush() writes
+// it at once. The manager runs loop() only from process(), so it also calls
+// flush() when the portal closes, on resetSettings() and in its destructor.
+class WiFiSettingsStore {
+public:
+    WiFiSettingsStore();
+
+    int         getTheme();
+    void        setTheme(int theme);
+    const char* getTitle();
+    void        setTitle(const char* title);
+
+    // Writes the snapshot once WM_SETTINGS_FLUSH_DELAY has passed since the last change
+    void        loop();
+    // Writes the snapshot now if anything changed
+    void        flush();
+    bool        isDirty();
+
+    // NVS writes performed, and setter calls that did not cause one
+    uint32_t    getWriteCount();
+    uint32_t    getAvoidedWriteCount();
+
+private:
+    struct Blob {
+        uint8_t version;
+        int8_t  theme;
+        char    title[WM_SETTINGS_TITLE_LEN];
+    };
+
+    void load();
+    void touch();
+
+    Blob          _blob;
+    bool          _loaded;
+    bool          _dirty;
+    unsigned long _changedAt;
+    uint32_t      _changes;
+    uint32_t      _writes;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Minifies and gzips the portal assets in assets/ into src/webui_assets.h.
+
+Run from the repository root after editing anything in assets/ or the
+WM_LIGHT_* / WM_DARK_* colors in src/webui.cpp:
+
+    python3 tools/build_assets.py
+
+The generated header holds, for each asset, the minified text as a string
+macro (sent to clients without gzip support) and a gzipped PROGMEM array.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+ASSETS = os.path.join(ROOT, "assets")
+OUTPUT = os.path.join(ROOT, "src", "webui_assets.h")
+
+# Placeholder in style.css -> suffix of the color macro in webui.cpp
+COLOR_KEYS = {
+    "bg": "BACKGROUND_COLOR",
+    "text": "TEXT_COLOR",
+    "button": "BUTTON_COLOR",
+    "buttonText": "BUTTON_TEXT_COLOR",
+    "slider": "SLIDER_COLOR",
+    "sliderOn": "SLIDER_ON_COLOR",
+}
+
+
+def read(name, mode="r"):
+    with open(os.path.join(ASSETS, name), mode) as f:
+        return f.read()
+
+
+def theme_colors(prefix):
+    with open(os.path.join(ROOT, "src", "webui.cpp")) as f:
+        source = f.read()
+    colors = {}
+    for key, suffix in COLOR_KEYS.items():
+        m = re.search(r'#define\s+WM_%s_%s\s+"([^"]*)"' % (prefix, suffix), source)
+        if not m:
+            sys.exit("WM_%s_%s not found in src/webui.cpp" % (prefix, suffix))
+        colors[key] = m.group(1)
+    return colors
+
+
+def split_strings(text):
+    """Yields (is_string, chunk) so minifiers leave quoted text alone."""
+    for part in re.split(r"""('(?:\\.|[^'\\])*'|"(?:\\.|[^"\\])*")""", text):
+        if part:
+            yield part[0] in "'\"", part
+
+
+def minify_css(css):
+    css = re.sub(r"/\*.*?\*/", "", css, flags=re.S)
+    out = []
+    for is_string, chunk in split_strings(css):
+        if not is_string:
+            chunk = re.sub(r"\s+", " ", chunk)
+            chunk = re.sub(r"\s*([{};,>+])\s*", r"\1", chunk)
+            chunk = re.sub(r":\s+", ":", chunk)
+            chunk = chunk.replace(";}", "}")
+        out.append(chunk)
+    return "".join(out).strip()
+
+
+def minify_js(js):
+    # Whole-line comments only; the source keeps a ';' at the end of every statement
+    lines = [l.strip() for l in js.splitlines()]
+    js = "".join(l for l in lines if l and not l.startswith("//"))
+    out = []
+    for is_string, chunk in split_strings(js):
+        if not is_string:
+            chunk = re.sub(r"\s*([{}()\[\];,=+:?|&<>!])\s*", r"\1", chunk)
+        out.append(chunk)
+    return "".join(out)
+
+
+def c_string(data):
+    text = data.decode("utf-8")
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def c_bytes(data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(rows)
+
+
+def main():
+    assets = []
+    for name, prefix in (("STYLE_LIGHT", "LIGHT"), ("STYLE_DARK", "DARK")):
+        css = read("style.css")
+        for key, value in theme_colors(prefix).items():
+            css = css.replace("{%s}" % key, value)
+        raw = css.encode("utf-8")
+        assets.append((name, raw, minify_css(css).encode("utf-8"), True))
+    js = read("portal.js")
+    assets.append(("SCRIPT", js.encode("utf-8"), minify_js(js).encode("utf-8"), True))
+    png = read("lock.png", "rb")
+    # PNG data is already deflated
+    assets.append(("LOCK_PNG", png, png, False))
+
+    out = [
+        "// Generated by tools/build_assets.py from assets/. Do not edit.",
+        "#ifndef WebUIAssets_h",
+        "#define WebUIAssets_h",
+        "",
+    ]
+    print("%-12s %8s %10s %8s" % ("asset", "source", "minified", "gzip"))
+    for name, raw, data, compress in assets:
+        etag = hashlib.sha1(data).hexdigest()[:8]
+        out.append('#define WM_ASSET_%s_VERSION "%s"' % (name, etag))
+        if compress:
+            gz = gzip.compress(data, compresslevel=9, mtime=0)
+            out.append("#define WM_ASSET_%s %s" % (name, c_string(data)))
+            out.append("static const uint8_t WM_ASSET_%s_GZ[] PROGMEM = {" % name)
+            out.append(c_bytes(gz))
+            out.append("};")
+            print("%-12s %8d %10d %8d" % (name, len(raw), len(data), len(gz)))
+        else:
+            out.append("static const uint8_t WM_ASSET_%s[] PROGMEM = {" % name)
+            out.append(c_bytes(data))
+            out.append("};")
+            print("%-12s %8d %10d %8s" % (name, len(raw), len(data), "-"))
+        out.append("")
+    out.append("#endif")
+
+    with open(OUTPUT, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()